@@ -1,7 +1,72 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
+#include <util/MemoryLiterals.hpp>
 
 static constexpr bool enableDebugUtils = true;
 static constexpr bool enableValidation = false;
-static constexpr uint32_t frameInFlightCount = 3;
\ No newline at end of file
+static constexpr uint32_t frameInFlightCount = 3;
+// processed scenes are cached in this directory, keyed by a hash of all input files
+static constexpr bool enableSceneCache = true;
+static constexpr const char* sceneCacheDirectory = "scene-cache";
+// the compacted triangle BLASes are serialized into the scene cache directory as well and restored on later runs with
+// the same scene, BLAS partitioning, device and driver
+static constexpr bool enableAccelerationStructureCache = true;
+// block compresses textures on load (BC7 for albedo, BC5 for normal maps, BC1 for everything else) if the device
+// supports it, the compressed textures are stored in the scene cache. Lossy, so off unless opted into.
+static constexpr bool compressTextures = false;
+// textures are uploaded through a staging ring of this size, split into slots that are filled on the CPU while the
+// GPU copies from the others. A slot grows to the largest image if that doesn't fit otherwise.
+static constexpr size_t imageStagingRingSize = 128_MiB;
+static constexpr size_t imageStagingSlotCount = 4;
+// Merges vertices that are identical in all attributes and reorders triangles and vertices along a Morton curve for
+// locality of the hit shader fetches. Only the first texture coordinate set is kept, the result is cached.
+static constexpr bool weldVertices = false;
+// stores normals and tangents octahedral-encoded and texture coordinates as half floats, set by the
+// COMPACT_VERTEX_ATTRIBUTES CMake option since the shaders need to be compiled to match
+#ifdef COMPACT_VERTEX_ATTRIBUTES
+static constexpr bool compactVertexAttributes = true;
+#else
+static constexpr bool compactVertexAttributes = false;
+#endif
+// Interleaves normals, tangents and the first texture coordinate set into one record per vertex (in the normal
+// buffer), so that the closest hit shader fetches one record instead of three streams. Positions stay separate for the
+// acceleration structure builds. Set by the INTERLEAVED_VERTEX_ATTRIBUTES CMake option, see compactVertexAttributes.
+#ifdef INTERLEAVED_VERTEX_ATTRIBUTES
+static constexpr bool interleavedVertexAttributes = true;
+#else
+static constexpr bool interleavedVertexAttributes = false;
+#endif
+// Textures start out as 1x1 placeholders and are only decoded and uploaded once the closest hit shader samples them,
+// from the finest mip level it asked for. Set by the STREAM_TEXTURES CMake option since the shader writes the
+// requests, see ModelLoader::updateStreamedTextures.
+#ifdef STREAM_TEXTURES
+static constexpr bool streamTextures = true;
+#else
+static constexpr bool streamTextures = false;
+#endif
+// streamed images that none of their textures were requested for in this many traced frames go back to their
+// placeholder and their memory is reused for other images, frames of a converged view don't count
+static constexpr uint64_t textureEvictionFrameCount = 256;
+// Geometries that aren't instanced are merged into BLASes that a binned surface area heuristic chooses over their
+// bounds, instead of the model bounds split into 2x2x2 equal cells. The costs are relative to one BVH node visit inside
+// a BLAS, a higher BLAS entry cost merges more geometries into each BLAS.
+static constexpr bool sahBLASPartitioning = true;
+static constexpr size_t blasPartitionBinCount = 16;
+static constexpr float tlasNodeCost = 1.0f;
+static constexpr float blasEntryCost = 4.0f;
+static constexpr float blasNodeCost = 1.0f;
+// BLAS builds share a scratch buffer of this size (or the size of the largest build if that is larger), builds that
+// don't fit into it together run in consecutive batches
+static constexpr size_t blasScratchBudget = 128_MiB;
+// uncompacted BLASes are built in batches that fit into an arena of this size (or the size of the largest BLAS if that
+// is larger), each batch is compacted before the next one is built into the arena
+static constexpr size_t blasBuildBudget = 512_MiB;
+// the TLAS is refit when instances change and rebuilt every this many updates, refits get slower to trace the further
+// the instances moved since the last build
+static constexpr uint32_t tlasUpdatesBeforeRebuild = 32;
+// the light sphere animation (toggled with L) moves each sphere on a circle of this radius around its initial position,
+// taking this many seconds per revolution
+static constexpr float lightAnimationRadius = 1.0f;
+static constexpr double lightAnimationPeriod = 8.0;
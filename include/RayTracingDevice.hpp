@@ -45,6 +45,11 @@ class RayTracingDevice {
 	VkPhysicalDevice physicalDevice() const { return m_physicalDevice; }
 	VkQueue queue() const { return m_queue; }
 	uint32_t queueFamilyIndex() const { return m_queueFamilyIndex; }
+	// the main queue if the device has no transfer-only queue family
+	VkQueue transferQueue() const { return m_transferQueue; }
+	uint32_t transferQueueFamilyIndex() const { return m_transferQueueFamilyIndex; }
+	bool hasDedicatedTransferQueue() const { return m_transferQueueFamilyIndex != m_queueFamilyIndex; }
+	bool supportsTextureCompressionBC() const { return m_supportsTextureCompressionBC; }
 	VkInstance instance() const { return m_instance; }
 
 	uint32_t findBestMemoryIndex(VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred,
@@ -74,6 +79,9 @@ class RayTracingDevice {
 	VkDevice m_device;
 	uint32_t m_queueFamilyIndex;
 	VkQueue m_queue;
+	uint32_t m_transferQueueFamilyIndex;
+	VkQueue m_transferQueue;
+	bool m_supportsTextureCompressionBC;
 
 	VkSurfaceKHR m_surface;
 	VkSwapchainKHR m_swapchain;
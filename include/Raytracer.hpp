@@ -41,6 +41,20 @@ class TriangleMeshRaytracer {
 	float m_exposure = 3.0f;
 
 	double m_accumulatedSampleTime = 0.0f;
+	// whether each frame in flight traced rays in its last use, only those frames wrote texture requests
+	bool m_frameTracedRays[frameInFlightCount] = {};
+
+	// two timestamps around the trace per frame in flight, read back once the frame's fence was waited on
+	VkQueryPool m_traceTimestampPool = VK_NULL_HANDLE;
+	bool m_traceTimestampsWritten[frameInFlightCount] = {};
+	float m_timestampPeriod = 1.0f;
+	double m_accumulatedTraceTime = 0.0;
+	uint32_t m_timedTraceCount = 0;
 	
 	bool m_pressedFullscreenSwitch = false;
+
+	// the light spheres as they were passed in, the animation moves them relative to these
+	std::vector<Sphere> m_initialLightSpheres;
+	bool m_animateLightSpheres = false;
+	bool m_pressedLightAnimationSwitch = false;
 };
\ No newline at end of file
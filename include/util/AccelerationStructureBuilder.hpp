@@ -1,9 +1,13 @@
 #pragma once
 
 #include <RayTracingDevice.hpp>
+#include <util/GeometryPartitioning.hpp>
 #include <util/MemoryAllocator.hpp>
 #include <util/ModelLoader.hpp>
 
+// acceleration structures must start at multiples of this in their buffer
+static constexpr VkDeviceSize uncompactedAccelerationStructureAlignment = 256;
+
 struct Sphere {
 	float position[3];
 	float radius;
@@ -32,7 +36,26 @@ class AccelerationStructureBuilder {
 
 	VkAccelerationStructureKHR tlas() const { return m_tlas; }
 
+	// TLAS instances are the light spheres followed by the triangle instances of each BLAS. Changes are uploaded and
+	// the TLAS is updated by the next updateTLAS.
+	size_t instanceCount() const { return m_tlasInstances.size(); }
+	void setInstanceTransform(size_t instanceIndex, const VkTransformMatrixKHR& transform);
+	void setInstanceMask(size_t instanceIndex, uint8_t mask);
+	// moves the sphere's instance and updates its light data
+	void setLightSphere(size_t sphereIndex, const Sphere& sphere);
+	const std::vector<Sphere>& lightSpheres() const { return m_lightSpheres; }
+
+	// Records the upload of changed instances and the TLAS refit into the frame's command buffer, every
+	// tlasUpdatesBeforeRebuild updates the TLAS is rebuilt instead. Returns whether anything changed.
+	bool updateTLAS(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+	uint32_t tlasRefitCount() const { return m_tlasRefitCount; }
+	uint32_t tlasRebuildCount() const { return m_tlasRebuildCount; }
+
   private:
+	// the model bounds split into equally sized cells, each item goes to the cell chosen by
+	// bestAccelerationStructureIndex and empty cells are dropped
+	std::vector<GeometryPartition> partitionGeometriesInGrid(const std::vector<PartitionItem>& items,
+															 const AABB& modelBounds);
 	size_t bestAccelerationStructureIndex(std::vector<AABB>& asBoundingBoxes, const AABB& modelBounds,
 										  const AABB& geometryBoundingBox, bool resizeBoundingBoxes = true);
 	AccelerationStructureData createAccelerationStructure(
@@ -40,6 +63,19 @@ class AccelerationStructureBuilder {
 														  const std::vector<uint32_t>& maxPrimitiveCounts,
 														  uint32_t scratchBufferAlignment, bool topLevel = false);
 	AccelerationStructureData createAccelerationStructure(uint32_t compactedSize);
+	// uncompacted bottom level acceleration structure in a part of an existing buffer, offset must be a multiple of
+	// uncompactedAccelerationStructureAlignment
+	VkAccelerationStructureKHR createAccelerationStructure(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size);
+	VkAccelerationStructureBuildSizesInfoKHR accelerationStructureBuildSizes(
+		const VkAccelerationStructureBuildGeometryInfoKHR& buildInfo, const std::vector<uint32_t>& maxPrimitiveCounts);
+
+	// device buffer serialized acceleration structures are copied to/from and its staging buffer, returns the mapped
+	// staging buffer
+	void* createSerializationBuffers(VkDeviceSize size, VkBuffer& buffer, VkDeviceAddress& bufferDeviceAddress,
+									 VkBuffer& stagingBuffer);
+	// serializes the compacted triangle BLASes and writes them to the cache file for the key
+	void writeBLASCache(VkQueryPool serializationSizeQueryPool, const std::vector<uint32_t>& compactedSizes,
+						uint64_t cacheKey);
 
 	RayTracingDevice& m_device;
 	MemoryAllocator& m_allocator;
@@ -53,6 +89,21 @@ class AccelerationStructureBuilder {
 
 	VkAccelerationStructureKHR m_tlas;
 	VkBuffer m_tlasBackingBuffer;
+	VkBuffer m_tlasScratchBuffer;
+	VkDeviceAddress m_tlasScratchBufferDeviceAddress;
+
+	std::vector<VkAccelerationStructureInstanceKHR> m_tlasInstances;
+	std::vector<Sphere> m_lightSpheres;
+	VkDeviceSize m_instanceDataSize;
+	VkBuffer m_instanceBuffer;
+	VkDeviceAddress m_instanceBufferDeviceAddress;
+	// instances followed by the light data, written by the frame that uses it
+	VkBuffer m_instanceStagingBuffers[frameInFlightCount];
+	void* m_mappedInstanceStagingBuffers[frameInFlightCount];
+	bool m_instancesChanged = false;
+	uint32_t m_tlasUpdateCount = 0;
+	uint32_t m_tlasRefitCount = 0;
+	uint32_t m_tlasRebuildCount = 0;
 
 	std::vector<VkAccelerationStructureKHR> m_triangleBLASes;
 	std::vector<VkDeviceAddress> m_blasDeviceAddresses;
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <util/MappedFile.hpp>
+#include <vector>
+
+// bump whenever the layout of the file or the way the cached BLASes are built changes
+static constexpr uint32_t accelerationStructureCacheVersion = 2;
+// serialized acceleration structures must start at multiples of this in device memory
+static constexpr uint64_t serializedAccelerationStructureAlignment = 256;
+
+struct AccelerationStructureCacheHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t cacheKey;
+	uint64_t structureCount;
+	uint64_t dataSize;
+};
+
+struct CachedAccelerationStructure {
+	// offset of the serialized data from the start of the data block, aligned to
+	// serializedAccelerationStructureAlignment
+	uint64_t dataOffset;
+	uint64_t serializedSize;
+	// size of the acceleration structure to deserialize into
+	uint64_t structureSize;
+};
+
+std::string accelerationStructureCachePath(uint64_t cacheKey);
+
+// The file holds the header, the structures and the data block, which is the serialized structures laid out the same
+// way they are in device memory. Written to a temporary file first, returns false if anything failed to write.
+bool writeAccelerationStructureCache(const std::string& path, uint64_t cacheKey,
+									 const std::vector<CachedAccelerationStructure>& structures, const void* data,
+									 uint64_t dataSize);
+
+class AccelerationStructureCacheReader {
+  public:
+	// returns false if there is no cache file or it doesn't belong to this version/key
+	bool open(const std::string& path, uint64_t cacheKey);
+
+	size_t structureCount() const { return m_structures.size(); }
+	const CachedAccelerationStructure& structure(size_t index) const { return m_structures[index]; }
+
+	// starts with the version data for vkGetDeviceAccelerationStructureCompatibilityKHR
+	const uint8_t* structureData(size_t index) const { return m_data + m_structures[index].dataOffset; }
+
+	const uint8_t* data() const { return m_data; }
+	uint64_t dataSize() const { return m_dataSize; }
+
+  private:
+	MappedFile m_file;
+	std::vector<CachedAccelerationStructure> m_structures;
+	const uint8_t* m_data = nullptr;
+	uint64_t m_dataSize = 0;
+};
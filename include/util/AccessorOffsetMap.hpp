@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cgltf.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// what an accessor's data is copied as, the same accessor may end up in several streams
+enum class AccessorUsage : uint32_t { Position, Normal, Tangent, TexCoord, Index };
+
+// Open addressing (linear probing) hash map from accessor + usage to the offset its data was copied to.
+// Entries are never removed individually, only the whole map can be cleared.
+class AccessorOffsetMap {
+  public:
+	AccessorOffsetMap(size_t initialCapacity = 1024);
+
+	// returns nullptr if the accessor hasn't been inserted for this usage yet
+	const size_t* find(const cgltf_accessor* accessor, AccessorUsage usage) const;
+	// returns false and keeps the existing offset if the accessor was already inserted for this usage
+	bool insert(const cgltf_accessor* accessor, AccessorUsage usage, size_t offset);
+
+	void clear();
+
+	size_t size() const { return m_entryCount; }
+
+  private:
+	struct Entry {
+		const cgltf_accessor* accessor = nullptr;
+		AccessorUsage usage;
+		size_t offset;
+	};
+
+	size_t slotIndex(const cgltf_accessor* accessor, AccessorUsage usage) const;
+	void grow();
+
+	std::vector<Entry> m_entries;
+	size_t m_entryCount = 0;
+	// log2 of the capacity, the capacity is always a power of two
+	uint32_t m_capacityLog2;
+};
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cgltf.h>
+#include <cstddef>
+#include <cstdint>
+
+// Conversion of glTF accessors to tightly packed vertex attribute and index streams. Attribute accessors may be
+// interleaved with other attributes (any stride), use normalized or unnormalized integer components or be sparse.
+
+// true if the accessor data can be copied as-is, i.e. it is a dense float accessor without padding between elements
+bool isTightlyPackedFloatAccessor(const cgltf_accessor* accessor, size_t componentCount);
+
+// writes accessor->count * componentCount floats, dst may be write-combined staging memory and is never read
+void unpackAccessorFloats(const cgltf_accessor* accessor, size_t componentCount, float* dst);
+
+// index accessors widened to 32 bit or narrowed to 16 bit, narrowing requires every index to be below 65536
+void unpackAccessorIndices(const cgltf_accessor* accessor, uint32_t* dst);
+void unpackAccessorShortIndices(const cgltf_accessor* accessor, uint16_t* dst);
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <util/ModelLoader.hpp>
+#include <vector>
+
+// Costs of tracing a ray through partitioned BLASes, relative to visiting one BVH node inside a BLAS
+struct PartitionCostModel {
+	// one TLAS node above the partitions
+	float tlasNodeCost;
+	// a TLAS leaf, which transforms the ray into the instance and enters the BLAS root
+	float blasEntryCost;
+	// one level of a BLAS, whose BVH is assumed to be log2 of its triangle count deep
+	float blasNodeCost;
+};
+
+struct PartitionItem {
+	AABB bounds;
+	size_t triangleCount;
+};
+
+// the items that are built into one BLAS
+struct GeometryPartition {
+	std::vector<size_t> itemIndices;
+	AABB bounds;
+	size_t triangleCount;
+};
+
+// Expected cost of a ray that hits the scene bounds, by the surface area heuristic. The TLAS over the partitions is
+// taken as a balanced tree, so the costs of different partitionings of the same items can be compared.
+float partitionTraversalCost(const std::vector<GeometryPartition>& partitions, const PartitionCostModel& costModel);
+
+// Splits the items top down with a binned surface area heuristic over their bounds' centroids, for as long as a split
+// is cheaper than building the items into one BLAS. The number of partitions follows from the cost model.
+std::vector<GeometryPartition> partitionGeometries(const std::vector<PartitionItem>& items,
+												   const PartitionCostModel& costModel, size_t binCount);
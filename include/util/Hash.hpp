@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// 64-bit XXH64 hash of a range of memory
+uint64_t hashData(const void* data, size_t size, uint64_t seed = 0);
+
+inline uint64_t hashCombine(uint64_t hash, uint64_t value) {
+	return hashData(&value, sizeof(uint64_t), hash);
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// read-only view of a whole file, mapped where possible and read into memory otherwise
+class MappedFile {
+  public:
+	MappedFile() = default;
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	~MappedFile();
+
+	bool open(const char* path);
+	void close();
+
+	const uint8_t* data() const { return m_data; }
+	size_t size() const { return m_size; }
+
+  private:
+	const uint8_t* m_data = nullptr;
+	size_t m_size = 0;
+
+#ifndef __linux__
+	std::vector<uint8_t> m_readData;
+#endif
+};
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cgltf.h>
+#include <mutex>
+#include <unordered_map>
+
+// Supplies cgltf file callbacks that map .gltf/.glb/.bin files read-only instead of reading them into heap memory,
+// so accessor data is copied straight out of the page cache. Falls back to cgltf's own reader where mapping isn't
+// implemented. Must outlive all cgltf_data loaded with its callbacks, cgltf_free unmaps the files.
+class MappedFileReader {
+  public:
+	MappedFileReader() = default;
+	MappedFileReader(const MappedFileReader&) = delete;
+	MappedFileReader& operator=(const MappedFileReader&) = delete;
+	~MappedFileReader();
+
+	void setFileCallbacks(cgltf_options& options);
+
+	// hints that a range of a mapped file will be read soon, does nothing for unmapped memory
+	static void prefetch(const void* data, size_t size);
+
+  private:
+	cgltf_result mapFile(const char* path, cgltf_size* size, void** data);
+	void unmapFile(const cgltf_memory_options* memoryOptions, void* data);
+
+	std::mutex m_mappingMutex;
+	// mapped pointer -> mapping size
+	std::unordered_map<void*, size_t> m_mappings;
+};
@@ -26,8 +26,23 @@ struct ImageAllocation {
 	VkDeviceSize size;
 };
 
+struct MemoryRange {
+	VkDeviceSize offset;
+	VkDeviceSize size;
+};
+
+// memory that images are suballocated from and freed back into
+struct PooledMemoryBlock {
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	uint32_t memoryTypeIndex;
+	VkDeviceSize size;
+	// sorted by offset, adjacent ranges are merged when freeing
+	std::vector<MemoryRange> freeRanges;
+};
+
 constexpr VkDeviceSize bufferMemorySize = 32_MiB;
 constexpr VkDeviceSize imageMemorySize = 256_MiB;
+constexpr VkDeviceSize readbackMemorySize = 1_MiB;
 
 class MemoryAllocator {
   public:
@@ -38,11 +53,18 @@ class MemoryAllocator {
 	// returns mapped buffer pointer
 	void* bindStagingBuffer(VkBuffer buffer, VkDeviceSize alignment);
 	void bindDeviceBuffer(VkBuffer buffer, VkDeviceSize alignment);
+	// for buffers the GPU copies results into that are read on the host, returns mapped buffer pointer
+	void* bindReadbackBuffer(VkBuffer buffer, VkDeviceSize alignment);
 
 	ImageAllocation bindDeviceImage(VkImage image, VkDeviceSize alignment);
 
 	void freeImage(const ImageAllocation& allocation);
 
+	// Unlike bindDeviceImage, the memory of pooled images is reused once they are freed, for images that are
+	// replaced at runtime. Blocks are released as soon as nothing is allocated from them anymore.
+	ImageAllocation bindPooledImage(VkImage image);
+	void freePooledImage(const ImageAllocation& allocation);
+
   private:
 	// generic function performing allocations and binding resources, returns mapped memory pointer (potentially invalid
 	// if memory was unmapped)
@@ -54,8 +76,10 @@ class MemoryAllocator {
 
 	std::vector<DeviceMemoryAllocation> m_stagingBufferMemoryAllocations;
 	std::vector<DeviceMemoryAllocation> m_deviceBufferMemoryAllocations;
+	std::vector<DeviceMemoryAllocation> m_readbackBufferMemoryAllocations;
 
 	std::vector<DeviceMemoryAllocation> m_deviceImageMemoryAllocations;
+	std::vector<PooledMemoryBlock> m_pooledImageMemoryBlocks;
 
 	RayTracingDevice& m_device;
 };
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cgltf.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// the attribute accessors of a primitive that end up in the vertex streams, all except positions may be nullptr
+struct MeshAttributes {
+	const cgltf_accessor* positions;
+	const cgltf_accessor* normals;
+	const cgltf_accessor* tangents;
+	const cgltf_accessor* texCoords;
+};
+
+// Vertex streams of one set of attribute accessors after welding, shared by all primitives that use these accessors
+// with any of the index accessors. Streams are tightly packed floats and empty if the attribute doesn't exist.
+struct WeldedMesh {
+	size_t vertexCount = 0;
+	std::vector<float> positions;
+	std::vector<float> normals;
+	std::vector<float> tangents;
+	std::vector<float> texCoords;
+	// one index list per index accessor passed to weldMesh
+	std::vector<std::vector<uint32_t>> indices;
+};
+
+// Merges vertices that are identical in all attributes, sorts the triangles of each index list along a Morton curve
+// through their centroids and renumbers the vertices in order of first use. Unreferenced vertices are dropped.
+WeldedMesh weldMesh(const MeshAttributes& attributes, const std::vector<const cgltf_accessor*>& indexAccessors);
@@ -1,10 +1,29 @@
 #pragma once
 
+#include <Config.hpp>
 #include <RayTracingDevice.hpp>
+#include <array>
 #include <cgltf.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
 #include <string_view>
+#include <unordered_map>
+#include <util/AccessorOffsetMap.hpp>
+#include <util/MappedFileReader.hpp>
 #include <util/MemoryAllocator.hpp>
+#include <util/MeshOptimization.hpp>
+#include <util/NodeHierarchy.hpp>
 #include <util/OneTimeDispatcher.hpp>
+#include <util/SceneCache.hpp>
+#include <util/TextureResidency.hpp>
+#include <util/ThreadPool.hpp>
+#include <util/VertexEncoding.hpp>
+#include <thread>
 #include <vector>
 #include <glm/glm.hpp>
 #define GLM_FORCE_QUAT_DATA_XYZW
@@ -43,8 +62,20 @@ struct AABB {
 	bool intersects(const AABB& other) const { return intersectionArea(other) > 0.0f; }
 };
 
+// bytes per vertex in the attribute streams, see util/VertexEncoding.hpp for the compact encodings. Interleaved
+// shading records are all stored in the normal stream, the geometry offsets of all three point to the record.
+static constexpr size_t shadingRecordStride = shadingRecordSize(compactVertexAttributes);
+static constexpr size_t uvStreamStride =
+	interleavedVertexAttributes ? shadingRecordStride : compactVertexAttributes ? sizeof(uint32_t) : 2 * sizeof(float);
+static constexpr size_t normalStreamStride =
+	interleavedVertexAttributes ? shadingRecordStride : compactVertexAttributes ? sizeof(uint32_t) : 3 * sizeof(float);
+static constexpr size_t tangentStreamStride =
+	interleavedVertexAttributes ? shadingRecordStride : compactVertexAttributes ? sizeof(uint32_t) : 4 * sizeof(float);
+
 struct Geometry {
 	bool isAlphaTested;
+	// indices are stored as uint16, only used with compact vertex attributes
+	bool hasShortIndices;
 	float transformMatrix[16];
 	float normalTransformMatrix[16];
 
@@ -70,10 +101,21 @@ struct GPUGeometry {
 	uint32_t indexOffset;
 
 	uint32_t materialIndex;
+	uint32_t hasShortIndices;
+
+	// 0.5 * log2(texture coordinate area / world space area), averaged over the geometry, for the ray cone texture LOD
+	float texelDensityLod;
 
 	float normalTransformMatrix[9];
 };
 
+// a node referencing a mesh, the geometries created for it are consecutive in ModelLoader::geometries()
+struct MeshInstance {
+	uint32_t meshIndex;
+	uint32_t firstGeometryIndex;
+	uint32_t geometryCount;
+};
+
 struct Material {
 	float alphaCutoff;
 
@@ -91,6 +133,9 @@ struct Material {
 	uint16_t metallicRoughnessTextureIndex;
 	uint16_t emissiveTextureIndex;
 	uint16_t normalTextureIndex;
+
+	// 1 if the normal map only stores x and y (BC5), the hit shader reconstructs z for those
+	uint32_t normalMapIsTwoChannel;
 };
 
 struct Texture {
@@ -99,9 +144,82 @@ struct Texture {
 };
 
 struct ImageData {
-	unsigned char* data;
+	// encoded source, either a range inside a loaded glTF buffer or a path to an image file
+	const unsigned char* encodedData;
+	size_t encodedSize;
+	std::string path;
+
+	size_t stagingOffset;
+	// for block compressed formats, the staging slot holds all mip levels
 	size_t size;
 	int width, height;
+	uint32_t mipLevels;
+	VkFormat format;
+};
+
+// consecutive images uploaded through one slot of the staging ring
+struct ImageUploadChunk {
+	size_t firstImageIndex;
+	size_t imageCount;
+	// range in the combined image layout (the same as the cached texel data), including padding to the next chunk
+	size_t stagingOffset;
+	size_t size;
+};
+
+struct BlitImage {
+	VkImage image;
+	int32_t width, height;
+	uint32_t mipLevels;
+	// levels copied from the staging buffer, the remaining ones are blit
+	uint32_t stagedLevels;
+};
+
+static constexpr size_t invalidWeldedMesh = ~size_t{ 0 };
+
+struct WeldedGeometry {
+	size_t meshIndex;
+	// which of the mesh's index lists the geometry uses
+	size_t indexListIndex;
+};
+
+// byte offsets into the respective streams, set when the mesh is first copied
+struct WeldedMeshOffsets {
+	bool isCopied = false;
+	size_t vertexOffset = 0;
+	size_t uvOffset = 0;
+	size_t normalOffset = 0;
+	size_t tangentOffset = 0;
+	// invalidWeldedMesh until the index list is copied
+	std::vector<size_t> indexOffsets;
+};
+
+// finest mip level wanted for an image, read back from the closest hit shader's texture requests
+struct StreamingRequest {
+	uint32_t imageIndex;
+	uint32_t baseLevel;
+};
+
+// levels from baseLevel down to 1x1, decoded on the streaming thread and waiting for an upload
+struct StreamedImageData {
+	uint32_t imageIndex;
+	uint32_t baseLevel;
+	std::vector<unsigned char> texels;
+};
+
+// replaced by a higher resolution version or evicted, destroyed once no frame in flight can sample it anymore
+struct RetiredImage {
+	VkImage image;
+	VkImageView view;
+	ImageAllocation allocation;
+	uint64_t destroyFrame;
+};
+
+enum class PlaceholderTexture { White, Black, FlatNormal, Count };
+
+struct TextureSource {
+	uint32_t imageIndex;
+	// ~0U for the fallback sampler
+	uint32_t samplerIndex;
 };
 
 struct Camera {
@@ -113,23 +231,44 @@ struct Camera {
 	float zfar = 10000.0f;
 };
 
-struct CopiedAccessor {
-	cgltf_accessor* accessor;
-	size_t bufferOffset;
-};
-
 class ModelLoader {
   public:
+	// Buffers and images are uploaded on the transfer dispatcher's queue. Only the geometry upload is submitted when
+	// the constructor returns, textures keep streaming in until finishUploads().
 	ModelLoader(RayTracingDevice& device, MemoryAllocator& allocator, OneTimeDispatcher& dispatcher,
-				const std::vector<std::string_view>& gltfFilenames);
+				OneTimeDispatcher& transferDispatcher, const std::vector<std::string_view>& gltfFilenames);
 	~ModelLoader();
 
+	// waits for the texture upload and transitions all images for sampling, must be called before rendering
+	void finishUploads();
+
+	// With streamTextures, reads back the texture requests of the frame (whose fence must have been waited on),
+	// records uploads of decoded images into its command buffer and points its descriptor set to them. Images that
+	// weren't requested for textureEvictionFrameCount frames are evicted, tracedRays tells whether the frame's last use
+	// traced any rays (and its requests count towards that). Returns true if any texture the frame samples changed.
+	bool updateStreamedTextures(VkCommandBuffer commandBuffer, uint32_t frameIndex, bool tracedRays);
+	// With streamTextures, records the copy of the frame's texture requests into host memory after tracing. The
+	// copy's writes still need to be made available to the host.
+	void copyTextureRequests(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+	// signaled with geometryUploadValue() once all buffers are uploaded, work on the main queue using them needs to
+	// wait for that and record bufferAcquireBarriers() first
+	VkSemaphore uploadSemaphore() const { return m_uploadSemaphore; }
+	uint64_t geometryUploadValue() const { return m_geometryUploadValue; }
+	// queue family ownership transfers to the main queue, empty without a dedicated transfer queue
+	const std::vector<VkBufferMemoryBarrier>& bufferAcquireBarriers() const { return m_bufferAcquireBarriers; }
+
+	// hash of all scene inputs and of the settings the loaded data depends on, false if it couldn't be computed
+	bool hasSceneHash() const { return m_hasSceneHash; }
+	uint64_t sceneHash() const { return m_sceneHash; }
+
 	const AABB& modelBounds() const { return m_modelBounds; }
 
 	VkBuffer vertexBuffer() const { return m_vertexBuffer; }
-	VkBuffer uvBuffer() const { return m_uvBuffer; }
+	// empty or interleaved streams have no buffer of their own, the normal buffer stands in to keep descriptors valid
+	VkBuffer uvBuffer() const { return m_uvBuffer != VK_NULL_HANDLE ? m_uvBuffer : m_normalBuffer; }
 	VkBuffer normalBuffer() const { return m_normalBuffer; }
-	VkBuffer tangentBuffer() const { return m_tangentBuffer; }
+	VkBuffer tangentBuffer() const { return m_tangentBuffer != VK_NULL_HANDLE ? m_tangentBuffer : m_normalBuffer; }
 	VkBuffer indexBuffer() const { return m_indexBuffer; }
 	VkBuffer materialBuffer() const { return m_materialBuffer; }
 	VkBuffer geometryBuffer() const { return m_geometryBuffer; }
@@ -138,40 +277,73 @@ class ModelLoader {
 	VkDeviceAddress indexBufferDeviceAddress() const { return m_indexBufferDeviceAddress; }
 
 	size_t materialCount() const { return m_materials.size(); }
-	size_t uvBufferSize() const { return m_totalUVCount * sizeof(float) * 2; }
-	size_t normalBufferSize() const { return m_totalNormalCount * sizeof(float) * 3; }
-	size_t tangentBufferSize() const { return m_totalTangentCount * sizeof(float) * 4; }
+	size_t uvBufferSize() const { return m_totalUVCount * uvStreamStride; }
+	size_t normalBufferSize() const { return m_totalNormalCount * normalStreamStride; }
+	size_t tangentBufferSize() const { return m_totalTangentCount * tangentStreamStride; }
 	size_t indexBufferSize() const { return m_totalIndexCount * sizeof(uint32_t); }
 
 	const std::vector<Geometry>& geometries() const { return m_geometries; }
+	const std::vector<MeshInstance>& meshInstances() const { return m_meshInstances; }
 
 	const std::vector<VkImage>& textureImages() const { return m_textureImages; }
 	const std::vector<VkSampler>& textureSamplers() const { return m_textureSamplers; }
 	const std::vector<Texture>& textures() const { return m_textures; }
 
-	VkDescriptorSet textureDescriptorSet() const { return m_textureDescriptorSet; }
+	// every frame in flight has its own set when streaming textures, so that they can be updated between frames
+	VkDescriptorSet textureDescriptorSet(uint32_t frameIndex) const {
+		return m_textureDescriptorSets[streamTextures ? frameIndex : 0];
+	}
 	VkDescriptorSetLayout textureDescriptorSetLayout() const { return m_textureDescriptorSetLayout; }
 
 	const Camera& camera() const { return m_camera; }
 
   private:
+	void parseScenes(const std::vector<std::string_view>& gltfFilenames, std::vector<cgltf_data*>& gltfData,
+					 MappedFileReader& fileReader);
+	void copyScenes(const std::vector<std::string_view>& gltfFilenames, const std::vector<cgltf_data*>& gltfData);
+
+	void restoreSceneInfo(const SceneCacheReader& cache);
+	// runs on m_sceneCacheThread, the texel data is appended chunk by chunk as uploadTextures hands it over
+	void writeSceneCache();
+
+	// flattens the scene's node hierarchy into m_sceneNodes and adds its nodes from there
 	void addScene(cgltf_data* data, cgltf_scene* scene);
-	void addNode(cgltf_data* data, cgltf_node* node, glm::vec3& translation, glm::quat& rotation, glm::vec3& scale);
+	void addNode(cgltf_data* data, const FlattenedNode& node);
+	// merges duplicated vertices and reorders each set of vertex streams, see weldMesh
+	void weldGeometries();
+	// world space bounds of every geometry and the whole model from the transformed vertex positions
+	void computeGeometryBounds();
 
-	void copySceneGeometries(cgltf_data* data, cgltf_scene* scene, size_t& currentGeometryIndex);
-	void copyNodeGeometries(cgltf_data* data, cgltf_node* node, size_t& currentGeometryIndex);
+	void copySceneGeometries(cgltf_data* data, const std::vector<FlattenedNode>& nodes, size_t& currentGeometryIndex);
+	void copyNodeGeometries(cgltf_data* data, const cgltf_node* node, size_t& currentGeometryIndex);
+	void copyPrimitiveAccessors(cgltf_primitive* primitive, size_t currentGeometryIndex);
+	void copyWeldedGeometry(size_t currentGeometryIndex);
 
 	void addMaterial(cgltf_data* data, cgltf_material* material);
 
 	void addTexture(cgltf_data* data, cgltf_texture* texture);
 
 	void addImage(cgltf_data* data, cgltf_image* image, const std::string_view& gltfPath);
+	// creates the image and view at m_textureImages[imageIndex], with baseLevel as the base level of the full image
+	void createImage(size_t imageIndex, uint32_t baseLevel = 0);
+	// hands a streamed image over to m_retiredImages and clears its slot
+	void retireImage(size_t imageIndex);
+	// streams all images through the staging ring, runs on m_textureUploadThread with a dedicated transfer queue
+	void uploadTextures();
+
+	void createPlaceholderImages();
+	// decodes requested images until the loader is destroyed, runs on m_textureStreamingThread
+	void decodeStreamedTextures();
+	void writeStreamedTextureDescriptors(uint32_t frameIndex, const std::vector<uint32_t>& imageIndices);
 
 	void addSampler(cgltf_data* data, cgltf_sampler* sampler);
 
 	RayTracingDevice& m_device;
 	MemoryAllocator& m_allocator;
 	OneTimeDispatcher& m_dispatcher;
+	OneTimeDispatcher& m_transferDispatcher;
+
+	ThreadPool m_threadPool;
 
 	Camera m_camera;
 
@@ -179,17 +351,17 @@ class ModelLoader {
 	VkDeviceAddress m_indexBufferDeviceAddress;
 
 	VkBuffer m_vertexBuffer;
-	VkBuffer m_uvBuffer;
+	VkBuffer m_uvBuffer = VK_NULL_HANDLE;
 	VkBuffer m_normalBuffer;
-	VkBuffer m_tangentBuffer;
+	VkBuffer m_tangentBuffer = VK_NULL_HANDLE;
 	VkBuffer m_indexBuffer;
 	VkBuffer m_geometryBuffer;
 	VkBuffer m_materialBuffer;
 
 	VkBuffer m_vertexStagingBuffer;
-	VkBuffer m_uvStagingBuffer;
+	VkBuffer m_uvStagingBuffer = VK_NULL_HANDLE;
 	VkBuffer m_normalStagingBuffer;
-	VkBuffer m_tangentStagingBuffer;
+	VkBuffer m_tangentStagingBuffer = VK_NULL_HANDLE;
 	VkBuffer m_indexStagingBuffer;
 	VkBuffer m_geometryStagingBuffer;
 	VkBuffer m_materialStagingBuffer;
@@ -198,27 +370,124 @@ class ModelLoader {
 
 	std::vector<Geometry> m_geometries;
 	std::vector<GPUGeometry> m_gpuGeometries;
+	std::vector<MeshInstance> m_meshInstances;
 
+	// ring buffer all images are uploaded through, see imageStagingRingSize
 	VkBuffer m_imageStagingBuffer;
+	unsigned char* m_imageStagingData;
+	size_t m_imageStagingSlotSize;
+	size_t m_imageStagingSlotCount;
 	std::vector<VkImage> m_textureImages;
 	std::vector<VkImageView> m_textureImageViews;
 	std::vector<VkSampler> m_textureSamplers;
 	std::vector<Texture> m_textures;
 	std::vector<Material> m_materials;
 	std::vector<bool> m_textureImageNormalUsage;
+	std::vector<bool> m_textureImageAlbedoUsage;
+	bool m_compressTextures;
 
 	VkSampler m_fallbackSampler;
 
 	std::vector<ImageData> m_imageData;
 
 	VkDescriptorPool m_textureDescriptorPool;
-	VkDescriptorSet m_textureDescriptorSet;
+	VkDescriptorSet m_textureDescriptorSets[frameInFlightCount];
 	VkDescriptorSetLayout m_textureDescriptorSetLayout;
 
+	// texture streaming state, only used with streamTextures
+
+	VkImage m_placeholderImages[static_cast<size_t>(PlaceholderTexture::Count)] = {};
+	VkImageView m_placeholderImageViews[static_cast<size_t>(PlaceholderTexture::Count)] = {};
+	// one slot per frame in flight, reused once the frame's fence was waited on
+	VkBuffer m_streamingStagingBuffer = VK_NULL_HANDLE;
+	unsigned char* m_streamingStagingData;
+	size_t m_streamingStagingSlotSize;
+	// finest level requested per texture, written by the closest hit shader and copied to the readback buffers
+	VkBuffer m_textureRequestBuffers[frameInFlightCount] = {};
+	VkBuffer m_textureRequestReadbackBuffers[frameInFlightCount] = {};
+	const uint32_t* m_textureRequestData[frameInFlightCount];
+	// streamed images are allocated from a pool so that replaced and evicted images give their memory back
+	std::vector<ImageAllocation> m_textureImageAllocations;
+	std::vector<PlaceholderTexture> m_texturePlaceholders;
+	// base level of the resident image, or mipLevels while only the placeholder is bound
+	std::vector<uint32_t> m_residentImageLevels;
+	TextureResidency m_textureResidency;
+	// images that were replaced in an earlier frame's set, but not in this frame's set yet
+	std::vector<uint32_t> m_pendingImageUpdates[frameInFlightCount];
+	std::vector<RetiredImage> m_retiredImages;
+	uint64_t m_streamingFrameCount = 0;
+
+	std::thread m_textureStreamingThread;
+	std::mutex m_streamingMutex;
+	std::condition_variable m_streamingCondition;
+	std::vector<StreamingRequest> m_streamingRequests;
+	std::vector<StreamedImageData> m_decodedImages;
+	bool m_stopStreaming = false;
+
+	// upload state, only valid until finishUploads()
+
+	bool m_hasPendingUploads = false;
+	std::chrono::steady_clock::time_point m_loadStartTime;
+
+	VkSemaphore m_uploadSemaphore = VK_NULL_HANDLE;
+	uint64_t m_geometryUploadValue = 0;
+	// each chunk of images signals the next value after the geometry upload
+	uint64_t m_textureUploadValue = 0;
+	std::vector<VkBufferMemoryBarrier> m_bufferAcquireBarriers;
+	std::vector<VkCommandBuffer> m_transferCommandBuffers;
+
+	std::thread m_textureUploadThread;
+	std::vector<ImageUploadChunk> m_imageUploadChunks;
+	std::vector<BlitImage> m_blitImages;
+	std::vector<VkBufferImageCopy> m_imageCopies;
+
+	// image sources, encoded images point into the loaded glTF buffers
+	MappedFileReader m_fileReader;
+	std::vector<cgltf_data*> m_gltfData;
+	bool m_hasSceneHash = false;
+	uint64_t m_sceneHash = 0;
+	bool m_isSceneCached = false;
+	SceneCacheReader m_sceneCache;
+	std::optional<SceneCacheWriter> m_sceneCacheWriter;
+	std::thread m_sceneCacheThread;
+	std::mutex m_sceneCacheMutex;
+	std::condition_variable m_sceneCacheCondition;
+	std::deque<std::vector<unsigned char>> m_cachedTexelChunks;
+	bool m_hasCachedAllTexelChunks = false;
+	// host copies of the vertex streams for the cache writer, only filled while the scene is cached
+	std::vector<float> m_cachedVertices;
+	std::vector<uint8_t> m_cachedUVs;
+	std::vector<uint8_t> m_cachedNormals;
+	std::vector<uint8_t> m_cachedTangents;
+	std::vector<uint32_t> m_cachedIndices;
+
 	// tempoary model loading metadata
 
-	std::vector<CopiedAccessor> m_copiedVertexDataAccessors;
-	std::vector<CopiedAccessor> m_copiedIndexDataAccessors;
+	// for index accessors, the value is 1 if the indices are stored as uint16
+	AccessorOffsetMap m_countedAccessors;
+	// flattened node hierarchy of every added scene in the order they were added, read again when copying
+	std::vector<std::vector<FlattenedNode>> m_sceneNodes;
+	// primitive of each geometry, only kept until the geometries are welded and their bounds are computed
+	std::vector<const cgltf_primitive*> m_geometryPrimitives;
+	// with vertex welding, the welded mesh of each geometry and where each mesh's data was copied to
+	std::vector<WeldedGeometry> m_weldedGeometries;
+	std::vector<WeldedMesh> m_weldedMeshes;
+	std::vector<WeldedMeshOffsets> m_weldedMeshOffsets;
+	// with interleaved vertex attributes, the byte offset of the shading records for each combination of accessors
+	// (see shadingRecordSources), empty until they are copied
+	std::map<std::array<const cgltf_accessor*, 4>, std::optional<size_t>> m_shadingRecordOffsets;
+	// byte offsets into the respective stream
+	AccessorOffsetMap m_copiedAccessors;
+	// texel density terms in object space, keyed by the index accessor
+	std::unordered_map<const cgltf_accessor*, float> m_objectTexelDensityLods;
+	std::vector<TextureSource> m_textureSources;
+	std::vector<VkSamplerCreateInfo> m_samplerCreateInfos;
+	// global glTF image index -> index into m_imageData, duplicate images share one entry
+	std::vector<uint32_t> m_imageIndexRemap;
+	// hash of the encoded source and format -> index into m_imageData
+	std::unordered_map<uint64_t, uint32_t> m_imageIndicesBySource;
+	size_t m_duplicateImageCount = 0;
+	size_t m_duplicateImageSize = 0;
 
 	size_t m_totalVertexCount = 0;
 	size_t m_totalUVCount = 0;
@@ -235,14 +504,16 @@ class ModelLoader {
 	size_t m_combinedImageSize = 0;
 	size_t m_maxImageSize = 0;
 
+	size_t m_globalMeshIndexOffset = 0;
 	size_t m_globalMaterialIndexOffset = 0;
 	size_t m_globalSamplerIndexOffset = 0;
 	size_t m_globalImageIndexOffset = 0;
 	size_t m_globalTextureIndexOffset = 0;
 
+	// point into the mapped staging buffers (or the host copies while caching), only valid while loading
 	float* m_vertexData;
-	float* m_uvData;
-	float* m_normalData;
-	float* m_tangentData;
+	uint8_t* m_uvData = nullptr;
+	uint8_t* m_normalData;
+	uint8_t* m_tangentData = nullptr;
 	uint32_t* m_indexData;
 };
\ No newline at end of file
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cgltf.h>
+#include <cstdint>
+#include <util/ThreadPool.hpp>
+#include <vector>
+
+static constexpr uint32_t noParentNode = ~0U;
+
+// One node of a scene's hierarchy. Nodes are stored in depth-first order, so parents come before their children and
+// every subtree is a contiguous range of the table.
+struct FlattenedNode {
+	const cgltf_node* node;
+	uint32_t parentIndex;
+	// nodes in the subtree including this one, the subtree is [index, index + subtreeSize)
+	uint32_t subtreeSize;
+	// column-major node to scene transform in glTF's coordinate system
+	float worldTransform[16];
+};
+
+// Flattens the node trees of the scene's root nodes in the order a recursive traversal would visit them and computes
+// the world transforms of all nodes. Subtrees that are small enough are transformed in parallel on the thread pool.
+std::vector<FlattenedNode> flattenSceneNodes(const cgltf_scene* scene, ThreadPool& threadPool);
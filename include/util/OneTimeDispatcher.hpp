@@ -3,6 +3,12 @@
 #include <RayTracingDevice.hpp>
 #include <vector>
 
+struct TimelineSemaphoreWait {
+	VkSemaphore semaphore;
+	uint64_t value;
+	VkPipelineStageFlags stageMask;
+};
+
 struct SubmittedCommandBuffer {
 	VkCommandBuffer commandBuffer;
 	VkFence fence;
@@ -10,7 +16,8 @@ struct SubmittedCommandBuffer {
 
 class OneTimeDispatcher {
   public:
-	OneTimeDispatcher(RayTracingDevice& device);
+	// submits to the device's transfer queue instead of the main queue if useTransferQueue is set
+	OneTimeDispatcher(RayTracingDevice& device, bool useTransferQueue = false);
 	OneTimeDispatcher(const OneTimeDispatcher& other) = delete;
 	OneTimeDispatcher& operator=(const OneTimeDispatcher& other) = delete;
 	OneTimeDispatcher(OneTimeDispatcher&& other) = default;
@@ -20,6 +27,11 @@ class OneTimeDispatcher {
 	std::vector<VkCommandBuffer> allocateOneTimeSubmitBuffers(uint32_t count);
 
 	void submit(VkCommandBuffer submitCommandBuffer, const std::vector<VkSemaphore>& signalSemaphores);
+	// signalSemaphore is a timeline semaphore set to signalValue, it may be VK_NULL_HANDLE
+	void submit(VkCommandBuffer submitCommandBuffer, const std::vector<TimelineSemaphoreWait>& waitSemaphores,
+				VkSemaphore signalSemaphore, uint64_t signalValue);
+
+	uint32_t queueFamilyIndex() const { return m_queueFamilyIndex; }
 
 	//true if the fence was signaled
 	bool fenceStatus(VkCommandBuffer commandBuffer);
@@ -28,7 +40,11 @@ class OneTimeDispatcher {
 	bool waitForFence(VkCommandBuffer commandBuffer, uint64_t timeout);
 
   private:
+	void queueSubmit(VkCommandBuffer submitCommandBuffer, const VkSubmitInfo& submitInfo);
+
 	RayTracingDevice& m_device;
+	VkQueue m_queue;
+	uint32_t m_queueFamilyIndex;
 	VkCommandPool m_commandPool;
 
 	std::vector<SubmittedCommandBuffer> m_submittedCommandBuffers;
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <util/MappedFile.hpp>
+#include <util/ThreadPool.hpp>
+#include <vector>
+
+// bump whenever the layout or meaning of any cached data changes
+static constexpr uint32_t sceneCacheVersion = 9;
+
+enum class SceneCacheSection : uint32_t {
+	SceneInfo,
+	Vertices,
+	UVs,
+	Normals,
+	Tangents,
+	Indices,
+	Geometries,
+	GPUGeometries,
+	MeshInstances,
+	Materials,
+	Samplers,
+	Textures,
+	Images,
+	TexelData,
+	Count
+};
+
+struct SceneCacheHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t sceneHash;
+	uint64_t sectionOffsets[static_cast<size_t>(SceneCacheSection::Count)];
+	uint64_t sectionSizes[static_cast<size_t>(SceneCacheSection::Count)];
+};
+
+// Hashes the contents of all glTF files and of all buffers/images they reference, together with the cache version.
+// Returns false if any of the inputs can't be read, the regular loading path reports the error in that case.
+bool hashSceneInputs(const std::vector<std::string_view>& gltfFilenames, ThreadPool& threadPool, uint64_t& hash);
+
+std::string sceneCachePath(uint64_t sceneHash);
+
+class SceneCacheWriter {
+  public:
+	// the cache is written to a temporary file that only replaces the actual file in finish(), so that an aborted
+	// run never leaves a truncated cache behind
+	SceneCacheWriter(const std::string& path, uint64_t sceneHash);
+	SceneCacheWriter(const SceneCacheWriter&) = delete;
+	SceneCacheWriter& operator=(const SceneCacheWriter&) = delete;
+	~SceneCacheWriter();
+
+	void writeSection(SceneCacheSection section, const void* data, size_t size);
+	// for sections that are written piece by piece, the section ends when the next one begins
+	void beginSection(SceneCacheSection section);
+	void appendToSection(const void* data, size_t size);
+	// returns false if anything failed to write
+	bool finish();
+
+	const std::string& path() const { return m_path; }
+
+  private:
+	std::string m_path;
+	std::string m_temporaryPath;
+
+	FILE* m_file = nullptr;
+	SceneCacheHeader m_header = {};
+	SceneCacheSection m_currentSection = SceneCacheSection::Count;
+	uint64_t m_currentOffset;
+	bool m_failed = false;
+};
+
+class SceneCacheReader {
+  public:
+	// returns false if there is no cache file or it doesn't belong to this version/scene
+	bool open(const std::string& path, uint64_t sceneHash);
+
+	const void* section(SceneCacheSection section) const;
+	size_t sectionSize(SceneCacheSection section) const;
+
+	template <typename T> size_t sectionElementCount(SceneCacheSection section) const {
+		return sectionSize(section) / sizeof(T);
+	}
+
+  private:
+	MappedFile m_file;
+	const SceneCacheHeader* m_header = nullptr;
+};
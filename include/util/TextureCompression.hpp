@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// CPU block compressors for tightly packed RGBA8 images. Blocks at the right and bottom edges of images whose
+// dimensions aren't multiples of 4 repeat the edge texels.
+
+// size of one mip level in bytes, blockSize is 8 for BC1 and 16 for BC5 and BC7
+size_t blockCompressedSize(uint32_t width, uint32_t height, size_t blockSize);
+
+// opaque RGB, alpha is ignored
+void compressBC1(const uint8_t* texels, uint32_t width, uint32_t height, uint8_t* dst);
+// red and green channels as two BC4 blocks, used for tangent space normal maps
+void compressBC5(const uint8_t* texels, uint32_t width, uint32_t height, uint8_t* dst);
+// RGBA, only using mode 6 (one subset, 7 bit endpoints with a p-bit each, 4 bit indices)
+void compressBC7(const uint8_t* texels, uint32_t width, uint32_t height, uint8_t* dst);
+
+// 2x2 box filter producing the next mip level. Color channels of sRGB images are averaged in linear space.
+void downsampleImage(const uint8_t* texels, uint32_t width, uint32_t height, uint8_t* dst, bool isSRGB);
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Finest level requested per streamed image and which images to evict because none of their textures were requested
+// in a while. Only frames that traced rays and requested anything count towards eviction: a converged view stops
+// tracing, and evicting everything it shows would restart the accumulation over and over.
+class TextureResidency {
+  public:
+	TextureResidency() = default;
+	// mipLevels per image, an image counts as unrequested while its requested level is its mip level count
+	TextureResidency(std::vector<uint32_t> mipLevels, uint64_t evictionFrameCount);
+
+	// returns true if the level is finer than anything requested for the image before
+	bool request(uint32_t imageIndex, uint32_t level);
+	// ends the frame whose requests were passed to request(), returns the images to evict (whose requested levels are
+	// reset so that they can be requested again)
+	std::vector<uint32_t> endFrame(bool tracedRays);
+
+	bool isRequested(uint32_t imageIndex) const { return m_requestedLevels[imageIndex] < m_mipLevels[imageIndex]; }
+
+  private:
+	std::vector<uint32_t> m_mipLevels;
+	std::vector<uint32_t> m_requestedLevels;
+	// value of m_frameCount in the last frame that requested the image
+	std::vector<uint64_t> m_lastRequestFrames;
+	uint64_t m_evictionFrameCount = 0;
+	// frames that counted towards eviction
+	uint64_t m_frameCount = 0;
+	bool m_hasFrameRequests = false;
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+class ThreadPool {
+  public:
+	// a thread count of 0 spawns one worker per hardware thread
+	ThreadPool(size_t threadCount = 0);
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+	// waits for all enqueued jobs to finish
+	~ThreadPool();
+
+	size_t threadCount() const { return m_workers.size(); }
+
+	// jobs must not wait on other jobs of the same pool, that can deadlock once all workers are waiting
+	template <typename Function> std::future<std::invoke_result_t<Function>> enqueue(Function&& function);
+
+  private:
+	void workerLoop();
+
+	std::vector<std::thread> m_workers;
+
+	std::queue<std::function<void()>> m_jobs;
+	std::mutex m_jobMutex;
+	std::condition_variable m_jobCondition;
+	bool m_shouldExit = false;
+};
+
+template <typename Function> std::future<std::invoke_result_t<Function>> ThreadPool::enqueue(Function&& function) {
+	using ResultType = std::invoke_result_t<Function>;
+
+	// std::function needs a copyable target, packaged_task is move-only
+	auto task = std::make_shared<std::packaged_task<ResultType()>>(std::forward<Function>(function));
+	std::future<ResultType> result = task->get_future();
+	{
+		std::scoped_lock lock(m_jobMutex);
+		m_jobs.push([task]() { (*task)(); });
+	}
+	m_jobCondition.notify_one();
+	return result;
+}
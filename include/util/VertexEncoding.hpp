@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Encoders for the compact vertex attribute format, the hit shaders decode them again. Sources are tightly packed
+// floats, destinations may be write-combined staging memory and are never read.
+
+// 3 floats per normal -> octahedral coordinates as 2x16 bit snorm
+void encodeOctahedralNormals(const float* normals, size_t count, uint32_t* dst);
+// 4 floats per tangent -> octahedral coordinates as 16 bit (x) and 15 bit (y) snorm, the sign of w in the top bit
+void encodeOctahedralTangents(const float* tangents, size_t count, uint32_t* dst);
+// IEEE half floats, rounded to nearest even
+void encodeHalfFloats(const float* values, size_t count, uint16_t* dst);
+
+// Interleaved shading records (normal, tangent, texture coordinates) for INTERLEAVED_VERTEX_ATTRIBUTES. Compact records
+// are the three 32 bit encodings above, full ones 9 floats. Attributes that are nullptr are written as zeros.
+constexpr size_t shadingRecordSize(bool compact) { return compact ? 3 * sizeof(uint32_t) : 9 * sizeof(float); }
+void encodeShadingRecords(const float* normals, const float* tangents, const float* texCoords, size_t count,
+						  bool compact, uint8_t* dst);
@@ -8,6 +8,10 @@ struct RayPayload {
 	bool isLightSample;
 
 	uint randomState;
+
+	// ray cone for texture LOD selection: width at the ray origin and spread angle in radians
+	float coneWidth;
+	float coneSpreadAngle;
 };
 
 struct GeometryData {
@@ -18,10 +22,76 @@ struct GeometryData {
 	uint indexOffset;
 
 	uint materialIndex;
+	uint hasShortIndices;
+
+	float texelDensityLod;
 
 	mat3 normalTransformMatrix;
 };
 
+#ifdef COMPACT_VERTEX_ATTRIBUTES
+// counterparts to the encoders in util/VertexEncoding.cpp
+vec3 decodeOctahedral(vec2 octCoords) {
+	vec3 direction = vec3(octCoords, 1.0f - abs(octCoords.x) - abs(octCoords.y));
+	float fold = max(-direction.z, 0.0f);
+	direction.x += direction.x >= 0.0f ? -fold : fold;
+	direction.y += direction.y >= 0.0f ? -fold : fold;
+	return normalize(direction);
+}
+
+vec3 decodeOctahedralNormal(uint packedNormal) {
+	return decodeOctahedral(unpackSnorm2x16(packedNormal));
+}
+
+vec4 decodeOctahedralTangent(uint packedTangent) {
+	float x = max(float(int(packedTangent << 16u) >> 16) / 32767.0f, -1.0f);
+	// 15 bit y, the top bit holds the bitangent sign
+	float y = max(float(int(packedTangent << 1u) >> 17) / 16383.0f, -1.0f);
+	return vec4(decodeOctahedral(vec2(x, y)), (packedTangent & 0x80000000u) != 0u ? -1.0f : 1.0f);
+}
+#endif
+
+#ifdef INTERLEAVED_VERTEX_ATTRIBUTES
+// everything of a vertex except the position, written by encodeShadingRecords in util/VertexEncoding.cpp
+struct ShadingRecord {
+#ifdef COMPACT_VERTEX_ATTRIBUTES
+	uint normal;
+	uint tangent;
+	uint texCoord;
+#else
+	vec3 normal;
+	vec4 tangent;
+	vec2 texCoord;
+#endif
+};
+
+#ifdef COMPACT_VERTEX_ATTRIBUTES
+vec3 recordNormal(ShadingRecord record) {
+	return decodeOctahedralNormal(record.normal);
+}
+
+vec4 recordTangent(ShadingRecord record) {
+	return decodeOctahedralTangent(record.tangent);
+}
+
+vec2 recordTexCoord(ShadingRecord record) {
+	return unpackHalf2x16(record.texCoord);
+}
+#else
+vec3 recordNormal(ShadingRecord record) {
+	return record.normal;
+}
+
+vec4 recordTangent(ShadingRecord record) {
+	return record.tangent;
+}
+
+vec2 recordTexCoord(ShadingRecord record) {
+	return record.texCoord;
+}
+#endif
+#endif
+
 struct Material {
 	float alphaCutoff;
 
@@ -37,6 +107,8 @@ struct Material {
 
 	uint albedoAndMetallicRoughnessTextureIndex;
 	uint normalAndEmissiveTextureIndex;
+
+	uint normalMapIsTwoChannel;
 };
 
 struct LightData {
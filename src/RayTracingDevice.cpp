@@ -177,6 +177,15 @@ void RayTracingDevice::init(bool enableHardwareRaytracing) {
 		}
 
 		if (foundQueue) {
+			// transfer-only families usually map to dedicated copy engines that run alongside the main queue
+			m_transferQueueFamilyIndex = m_queueFamilyIndex;
+			for (size_t i = 0; i < queueFamilyProperties.size(); ++i) {
+				VkQueueFlags flags = queueFamilyProperties[i].queueFlags;
+				if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))) {
+					m_transferQueueFamilyIndex = static_cast<uint32_t>(i);
+					break;
+				}
+			}
 			chosenDevice = device;
 			break;
 		}
@@ -187,6 +196,10 @@ void RayTracingDevice::init(bool enableHardwareRaytracing) {
 
 	m_physicalDevice = chosenDevice.value();
 
+	VkPhysicalDeviceFeatures supportedFeatures;
+	vkGetPhysicalDeviceFeatures(m_physicalDevice, &supportedFeatures);
+	m_supportsTextureCompressionBC = supportedFeatures.textureCompressionBC;
+
 	VkPhysicalDeviceRayTracingPipelineFeaturesKHR rayTracingFeatures = {
 		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_TRACING_PIPELINE_FEATURES_KHR, .rayTracingPipeline = VK_TRUE
 	};
@@ -202,10 +215,12 @@ void RayTracingDevice::init(bool enableHardwareRaytracing) {
 														  .shaderSampledImageArrayNonUniformIndexing = VK_TRUE,
 														  .runtimeDescriptorArray = VK_TRUE,
 														  .scalarBlockLayout = VK_TRUE,
+														  .timelineSemaphore = VK_TRUE,
 														  .bufferDeviceAddress = VK_TRUE };
 
 	VkPhysicalDeviceFeatures2 features = { .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
-										   .pNext = enableHardwareRaytracing ? &vulkan12Features : nullptr };
+										   .pNext = enableHardwareRaytracing ? &vulkan12Features : nullptr,
+										   .features = { .textureCompressionBC = m_supportsTextureCompressionBC } };
 
 	std::vector<const char*> deviceExtensionNames;
 	if (enableHardwareRaytracing) {
@@ -230,10 +245,16 @@ void RayTracingDevice::init(bool enableHardwareRaytracing) {
 	aftermathInfo.pNext = &features;
 	aftermathInfo.flags = aftermathFlags;*/
 
+	VkDeviceQueueCreateInfo queueCreateInfos[2] = { deviceQueueCreateInfo,
+													{ .sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+													  .queueFamilyIndex = m_transferQueueFamilyIndex,
+													  .queueCount = 1,
+													  .pQueuePriorities = &queuePriority } };
+
 	VkDeviceCreateInfo deviceCreateInfo = { .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
 											.pNext = &features,
-											.queueCreateInfoCount = 1,
-											.pQueueCreateInfos = &deviceQueueCreateInfo,
+											.queueCreateInfoCount = hasDedicatedTransferQueue() ? 2U : 1U,
+											.pQueueCreateInfos = queueCreateInfos,
 											.enabledLayerCount = static_cast<uint32_t>(instanceLayerNames.size()),
 											.ppEnabledLayerNames = instanceLayerNames.data(),
 											.enabledExtensionCount = static_cast<uint32_t>(deviceExtensionNames.size()),
@@ -244,12 +265,15 @@ void RayTracingDevice::init(bool enableHardwareRaytracing) {
 	volkLoadDevice(m_device);
 
 	vkGetDeviceQueue(m_device, m_queueFamilyIndex, 0, &m_queue);
+	vkGetDeviceQueue(m_device, m_transferQueueFamilyIndex, 0, &m_transferQueue);
 
 	if constexpr (enableDebugUtils) {
 		setObjectName(m_device, VK_OBJECT_TYPE_DEVICE, m_device, "Main device");
 		setObjectName(m_device, VK_OBJECT_TYPE_SURFACE_KHR, m_surface, "Presentation surface");
 		setObjectName(m_device, VK_OBJECT_TYPE_PHYSICAL_DEVICE, m_physicalDevice, "Chosen physical device");
 		setObjectName(m_device, VK_OBJECT_TYPE_QUEUE, m_queue, "Main ray-tracing/compute queue");
+		if (hasDedicatedTransferQueue())
+			setObjectName(m_device, VK_OBJECT_TYPE_QUEUE, m_transferQueue, "Transfer queue");
 	}
 
 	for (size_t i = 0; i < frameInFlightCount; ++i) {
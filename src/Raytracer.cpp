@@ -92,6 +92,12 @@ TriangleMeshRaytracer::TriangleMeshRaytracer(RayTracingDevice& device, MemoryAll
 	VkDescriptorBufferInfo texcoordBufferInfo = { .buffer = loader.uvBuffer(),
 												  .offset = 0,
 												  .range = loader.uvBufferSize() };
+	// Tangents and texture coordinates are empty if no geometry has them or if the shading records in the normal buffer
+	// hold them. Nothing reads the bindings then, they alias the normal buffer to stay valid.
+	if (!loader.tangentBufferSize())
+		tangentBufferInfo = normalBufferInfo;
+	if (!loader.uvBufferSize())
+		texcoordBufferInfo = normalBufferInfo;
 	VkWriteDescriptorSet texcoordBufferWrite = { .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
 												 .pNext = &accelerationStructureWrite,
 												 .dstSet = pipelineBuilder.generalSet(),
@@ -127,6 +133,17 @@ TriangleMeshRaytracer::TriangleMeshRaytracer(RayTracingDevice& device, MemoryAll
 
 	recreateAccumulationImage();
 
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(m_device.physicalDevice(), &properties);
+	m_timestampPeriod = properties.limits.timestampPeriod;
+
+	VkQueryPoolCreateInfo queryPoolCreateInfo = { .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+												  .queryType = VK_QUERY_TYPE_TIMESTAMP,
+												  .queryCount = 2 * frameInFlightCount };
+	verifyResult(vkCreateQueryPool(m_device.device(), &queryPoolCreateInfo, nullptr, &m_traceTimestampPool));
+
+	m_initialLightSpheres = accelerationStructureBuilder.lightSpheres();
+
 	std::memcpy(m_worldPos, loader.camera().position, 3 * sizeof(float));
 	std::memcpy(m_worldDirection, loader.camera().direction, 3 * sizeof(float));
 	std::memcpy(m_worldRight, loader.camera().right, 3 * sizeof(float));
@@ -140,6 +157,7 @@ TriangleMeshRaytracer::~TriangleMeshRaytracer() {
 	vkDeviceWaitIdle(m_device.device());
 	vkDestroyImageView(m_device.device(), m_accumulationImageView, nullptr);
 	vkDestroyImage(m_device.device(), m_accumulationImage, nullptr);
+	vkDestroyQueryPool(m_device.device(), m_traceTimestampPool, nullptr);
 }
 
 bool TriangleMeshRaytracer::update() {
@@ -151,6 +169,37 @@ bool TriangleMeshRaytracer::update() {
 		recreateAccumulationImage();
 		resetSampleCount();
 	}
+	// beginFrame waited for the frame's fence, so its timestamps from the last use are available
+	if (m_traceTimestampsWritten[frameData.frameIndex]) {
+		uint64_t timestamps[2];
+		verifyResult(vkGetQueryPoolResults(m_device.device(), m_traceTimestampPool, 2 * frameData.frameIndex, 2,
+										   sizeof(timestamps), timestamps, sizeof(uint64_t),
+										   VK_QUERY_RESULT_64_BIT));
+		if (m_accumulatedSampleCount < m_maxSamples) {
+			m_accumulatedTraceTime += static_cast<double>(timestamps[1] - timestamps[0]) * m_timestampPeriod;
+			++m_timedTraceCount;
+		}
+	}
+	// samples taken with the placeholders or lower resolution textures would stay in the accumulation otherwise
+	if (m_modelLoader.updateStreamedTextures(frameData.commandBuffer, frameData.frameIndex,
+											 m_frameTracedRays[frameData.frameIndex])) {
+		resetSampleCount();
+	}
+	if (m_animateLightSpheres) {
+		double angle = fmod(glfwGetTime(), lightAnimationPeriod) / lightAnimationPeriod * 2.0 * std::numbers::pi;
+		for (size_t i = 0; i < m_initialLightSpheres.size(); ++i) {
+			// spread the spheres over the circle so they don't all move in the same direction
+			double sphereAngle = angle + 2.0 * std::numbers::pi * i / m_initialLightSpheres.size();
+			Sphere sphere = m_initialLightSpheres[i];
+			sphere.position[0] += lightAnimationRadius * static_cast<float>(cos(sphereAngle));
+			sphere.position[2] += lightAnimationRadius * static_cast<float>(sin(sphereAngle));
+			m_accelerationStructureBuilder.setLightSphere(i, sphere);
+		}
+	}
+	// moved instances invalidate the accumulated samples as well
+	if (m_accelerationStructureBuilder.updateTLAS(frameData.commandBuffer, frameData.frameIndex)) {
+		resetSampleCount();
+	}
 
 	double currentTime = glfwGetTime();
 	double deltaTime = currentTime - m_lastTime;
@@ -241,6 +290,17 @@ bool TriangleMeshRaytracer::update() {
 	else {
 		m_pressedFullscreenSwitch = false;
 	}
+	if (m_device.window().keyPressed(GLFW_KEY_L)) {
+		if (!m_pressedLightAnimationSwitch) {
+			m_animateLightSpheres = !m_animateLightSpheres;
+			m_pressedLightAnimationSwitch = true;
+			printf("Light animation %s, %u TLAS refits and %u rebuilds so far\n",
+				   m_animateLightSpheres ? "started" : "stopped", m_accelerationStructureBuilder.tlasRefitCount(),
+				   m_accelerationStructureBuilder.tlasRebuildCount());
+		}
+	} else {
+		m_pressedLightAnimationSwitch = false;
+	}
 
 	m_exposure = std::max(0.0f, m_exposure);
 
@@ -248,9 +308,17 @@ bool TriangleMeshRaytracer::update() {
 		++m_accumulatedSampleCount;
 		m_accumulatedSampleTime += deltaTime;
 	} else if (m_accumulatedSampleCount != -1U) {
-		printf("Max. sample count reached. Time=%f s\n", m_accumulatedSampleTime);
+		// the vertex layout is part of the report so runs of builds with different layouts can be compared
+		const char* vertexLayout = interleavedVertexAttributes ? "interleaved"
+								   : compactVertexAttributes   ? "compact"
+															   : "separate";
+		printf("Max. sample count reached. Time=%f s, average trace time=%f ms (%s vertex attributes)\n",
+			   m_accumulatedSampleTime,
+			   m_timedTraceCount ? m_accumulatedTraceTime / m_timedTraceCount / 1000000.0 : 0.0, vertexLayout);
 		m_accumulatedSampleCount = -1U;
 	}
+	// the raygen shader returns right away once converged, without writing texture requests
+	m_frameTracedRays[frameData.frameIndex] = m_accumulatedSampleCount != -1U;
 
 	VkDescriptorImageInfo accumulationImageInfo = { .sampler = VK_NULL_HANDLE,
 													.imageView = m_accumulationImageView,
@@ -326,7 +394,7 @@ bool TriangleMeshRaytracer::update() {
 					   sizeof(PushConstantData), &data);
 
 	VkDescriptorSet sets[3] = { m_pipelineBuilder.imageSet(frameData.frameIndex), m_pipelineBuilder.generalSet(),
-								m_modelLoader.textureDescriptorSet() };
+								m_modelLoader.textureDescriptorSet(frameData.frameIndex) };
 
 	vkCmdBindDescriptorSets(frameData.commandBuffer, VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR,
 							m_pipelineBuilder.pipelineLayout(), 0, m_modelLoader.textures().size() ? 3 : 2, sets, 0,
@@ -337,9 +405,15 @@ bool TriangleMeshRaytracer::update() {
 	VkStridedDeviceAddressRegionKHR missRegion = m_pipelineBuilder.missDeviceAddressRegion();
 	VkStridedDeviceAddressRegionKHR hitRegion = m_pipelineBuilder.hitDeviceAddressRegion();
 
+	vkCmdResetQueryPool(frameData.commandBuffer, m_traceTimestampPool, 2 * frameData.frameIndex, 2);
+	vkCmdWriteTimestamp(frameData.commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_traceTimestampPool,
+						2 * frameData.frameIndex);
 	vkCmdTraceRaysKHR(frameData.commandBuffer, &raygenRegion, &missRegion, &hitRegion, &nullRegion,
 					  static_cast<uint32_t>(m_device.window().width()),
 					  static_cast<uint32_t>(m_device.window().height()), 1);
+	vkCmdWriteTimestamp(frameData.commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_traceTimestampPool,
+						2 * frameData.frameIndex + 1);
+	m_traceTimestampsWritten[frameData.frameIndex] = true;
 
 	VkImageMemoryBarrier memoryBarrierAfter = { .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
 												.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
@@ -355,6 +429,16 @@ bool TriangleMeshRaytracer::update() {
 						 VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, 0, 0, nullptr, 0, nullptr, 1,
 						 &memoryBarrierAfter);
 
+	if constexpr (streamTextures) {
+		// the texture requests are read on the host once the frame's fence was waited on
+		m_modelLoader.copyTextureRequests(frameData.commandBuffer, frameData.frameIndex);
+		VkMemoryBarrier requestBarrier = { .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+										   .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+										   .dstAccessMask = VK_ACCESS_HOST_READ_BIT };
+		vkCmdPipelineBarrier(frameData.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1,
+							 &requestBarrier, 0, nullptr, 0, nullptr);
+	}
+
 	return m_device.endFrame();
 }
 
@@ -399,4 +483,6 @@ void TriangleMeshRaytracer::recreateAccumulationImage() {
 void TriangleMeshRaytracer::resetSampleCount() {
 	m_accumulatedSampleCount = 0;
 	m_accumulatedSampleTime = 0.0;
+	m_accumulatedTraceTime = 0.0;
+	m_timedTraceCount = 0;
 }
\ No newline at end of file
@@ -32,9 +32,12 @@ int main(int argc, const char** argv) {
 
 	MemoryAllocator allocator = MemoryAllocator(device);
 	OneTimeDispatcher dispatcher = OneTimeDispatcher(device);
-	ModelLoader loader = ModelLoader(device, allocator, dispatcher, gltfFilenames);
+	OneTimeDispatcher transferDispatcher = OneTimeDispatcher(device, true);
+	ModelLoader loader = ModelLoader(device, allocator, dispatcher, transferDispatcher, gltfFilenames);
 	AccelerationStructureBuilder builder =
 		AccelerationStructureBuilder(device, allocator, dispatcher, loader, spheres, 0, 1);
+	// textures keep uploading while the acceleration structures are built
+	loader.finishUploads();
 	PipelineBuilder pipelineBuilder =
 		PipelineBuilder(device, allocator, dispatcher,
 						loader.textures().empty() ? VK_NULL_HANDLE : loader.textureDescriptorSetLayout(), 8);
@@ -1,29 +1,135 @@
 #include <DebugHelper.hpp>
+#include <algorithm>
+#include <bit>
 #include <cmath>
 #include <cstring>
+#include <numeric>
+#include <unordered_map>
 #include <util/AccelerationStructureBuilder.hpp>
+#include <util/AccelerationStructureCache.hpp>
+#include <util/GeometryPartitioning.hpp>
+#include <util/Hash.hpp>
 
-// assign geometry to whichever AS it intersects with the most, undef this in order to assign geometries to ASes based
-// on whichever generates less intersection area between all AABBS (is O(n^2) instead of O(n) with n=number of ASes
+// with the grid partitioning, assign geometry to whichever AS it intersects with the most, undef this in order to
+// assign geometries to ASes based on whichever generates less intersection area between all AABBS (is O(n^2) instead
+// of O(n) with n=number of ASes
 #define AS_HEURISTIC_GEOMETRY_INTERSECTION
 
 // cube root of this number should be an integer because the model AABB is subdivided into equally-sized cubes (3
 // dimensions)
 constexpr size_t numASSubdivisions = 8;
 
+// updates have to use the same flags as the build they refit
+constexpr VkBuildAccelerationStructureFlagsKHR tlasBuildFlags =
+	VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR | VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR;
+
+struct AccelerationStructureInstanceInfo {
+	VkTransformMatrixKHR transform;
+	// geometry indices in the order of the BLAS geometries, gl_GeometryIndexEXT indexes into these
+	std::vector<size_t> geometryIndices;
+	uint32_t geometryIndexBufferOffset;
+};
+
 struct AccelerationStructureGeometryInfo {
 	std::vector<VkAccelerationStructureGeometryKHR> geometries;
 	std::vector<VkAccelerationStructureBuildRangeInfoKHR> rangeInfos;
-	std::vector<size_t> geometryIndices;
+	std::vector<AccelerationStructureInstanceInfo> instances;
 };
 
+// the sphere BLAS holds one sphere of radius 1/2 around the origin
+VkTransformMatrixKHR sphereTransform(const Sphere& sphere) {
+	return { .matrix = { { 2 * sphere.radius, 0.0f, 0.0f, sphere.position[0] },
+						 { 0.0f, 2 * sphere.radius, 0.0f, sphere.position[1] },
+						 { 0.0f, 0.0f, 2 * sphere.radius, sphere.position[2] } } };
+}
+
+VkTransformMatrixKHR transformMatrixFromGeometry(const Geometry& geometry) {
+	return { .matrix = { { geometry.transformMatrix[0], geometry.transformMatrix[1], geometry.transformMatrix[2],
+						   geometry.transformMatrix[3] },
+						 { geometry.transformMatrix[4], geometry.transformMatrix[5], geometry.transformMatrix[6],
+						   geometry.transformMatrix[7] },
+						 { geometry.transformMatrix[8], geometry.transformMatrix[9], geometry.transformMatrix[10],
+						   geometry.transformMatrix[11] } } };
+}
+
+// the partitioning decides which geometries end up in which BLAS, so its settings are part of the key as well
+uint64_t blasCacheKey(uint64_t sceneHash, const VkPhysicalDeviceIDProperties& idProperties) {
+	uint64_t key = hashCombine(sceneHash, accelerationStructureCacheVersion);
+	key = hashCombine(key, hashData(idProperties.deviceUUID, VK_UUID_SIZE));
+	key = hashCombine(key, hashData(idProperties.driverUUID, VK_UUID_SIZE));
+	key = hashCombine(key, sahBLASPartitioning);
+	key = hashCombine(key, sahBLASPartitioning ? blasPartitionBinCount : numASSubdivisions);
+	key = hashCombine(key, std::bit_cast<uint32_t>(tlasNodeCost));
+	key = hashCombine(key, std::bit_cast<uint32_t>(blasEntryCost));
+	return hashCombine(key, std::bit_cast<uint32_t>(blasNodeCost));
+}
+
+struct MemoryBatching {
+	VkDeviceSize poolSize;
+	// offset of each allocation in the pool
+	std::vector<VkDeviceSize> offsets;
+	// indices of the allocations that live in the pool at the same time
+	std::vector<std::vector<size_t>> batches;
+};
+
+// The pool holds at least the largest allocation and as many of the others as fit into the budget. Allocations are
+// placed largest first into the first batch that still has room for them, so that the fewest batches are needed.
+MemoryBatching batchMemory(const std::vector<VkDeviceSize>& sizes, VkDeviceSize alignment, VkDeviceSize budget) {
+	auto alignedSize = [alignment](VkDeviceSize size) { return (size + alignment - 1) / alignment * alignment; };
+
+	MemoryBatching result = { .offsets = std::vector<VkDeviceSize>(sizes.size()) };
+	VkDeviceSize largestSize = 0;
+	VkDeviceSize totalSize = 0;
+	for (auto& size : sizes) {
+		largestSize = std::max(largestSize, alignedSize(size));
+		totalSize += alignedSize(size);
+	}
+	result.poolSize = std::max(largestSize, std::min(budget, totalSize));
+
+	std::vector<size_t> placementOrder = std::vector<size_t>(sizes.size());
+	std::iota(placementOrder.begin(), placementOrder.end(), size_t{ 0 });
+	std::stable_sort(placementOrder.begin(), placementOrder.end(),
+					 [&sizes](size_t lhs, size_t rhs) { return sizes[lhs] > sizes[rhs]; });
+
+	std::vector<VkDeviceSize> batchUsedSizes;
+	for (auto& index : placementOrder) {
+		size_t batchIndex = 0;
+		while (batchIndex < batchUsedSizes.size() &&
+			   batchUsedSizes[batchIndex] + alignedSize(sizes[index]) > result.poolSize) {
+			++batchIndex;
+		}
+		if (batchIndex == batchUsedSizes.size()) {
+			batchUsedSizes.push_back(0);
+			result.batches.push_back({});
+		}
+		result.offsets[index] = batchUsedSizes[batchIndex];
+		batchUsedSizes[batchIndex] += alignedSize(sizes[index]);
+		result.batches[batchIndex].push_back(index);
+	}
+	return result;
+}
+
+bool isBLASCacheCompatible(VkDevice device, const AccelerationStructureCacheReader& cache) {
+	for (size_t i = 0; i < cache.structureCount(); ++i) {
+		VkAccelerationStructureVersionInfoKHR versionInfo = {
+			.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_VERSION_INFO_KHR, .pVersionData = cache.structureData(i)
+		};
+		VkAccelerationStructureCompatibilityKHR compatibility;
+		vkGetDeviceAccelerationStructureCompatibilityKHR(device, &versionInfo, &compatibility);
+		if (compatibility != VK_ACCELERATION_STRUCTURE_COMPATIBILITY_COMPATIBLE_KHR)
+			return false;
+	}
+	return true;
+}
+
 AccelerationStructureBuilder::AccelerationStructureBuilder(RayTracingDevice& device, MemoryAllocator& memoryAllocator,
 														   OneTimeDispatcher& dispatcher, ModelLoader& modelLoader,
 														   const std::vector<Sphere> lightSpheres,
 														   uint32_t triangleSBTIndex, uint32_t lightSphereSBTIndex)
-	: m_device(device), m_allocator(memoryAllocator), m_dispatcher(dispatcher) {
+	: m_device(device), m_allocator(memoryAllocator), m_dispatcher(dispatcher), m_lightSpheres(lightSpheres) {
+	VkPhysicalDeviceIDProperties idProperties = { .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES };
 	VkPhysicalDeviceAccelerationStructurePropertiesKHR accelerationStructureProperties = {
-		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ACCELERATION_STRUCTURE_PROPERTIES_KHR
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ACCELERATION_STRUCTURE_PROPERTIES_KHR, .pNext = &idProperties
 	};
 	VkPhysicalDeviceProperties2 properties = { .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
 											   .pNext = &accelerationStructureProperties };
@@ -31,30 +137,69 @@ AccelerationStructureBuilder::AccelerationStructureBuilder(RayTracingDevice& dev
 	vkGetPhysicalDeviceProperties2(m_device.physicalDevice(), &properties);
 
 	std::vector<AccelerationStructureGeometryInfo> asGeometryData;
-	std::vector<AABB> asAABBs;
-
-	asGeometryData.resize(numASSubdivisions);
-	asAABBs.reserve(numASSubdivisions);
-
-	const AABB& modelBounds = modelLoader.modelBounds();
-
-	size_t numASesPerDimension = static_cast<size_t>(cbrtf(numASSubdivisions));
 
-	float aabbChunkLength[3] = { (modelBounds.xmax - modelBounds.xmin) / numASesPerDimension,
-								 (modelBounds.ymax - modelBounds.ymin) / numASesPerDimension,
-								 (modelBounds.zmax - modelBounds.zmin) / numASesPerDimension };
+	// Meshes referenced by more than one node get a BLAS of their own in object space that is shared by one TLAS
+	// instance per node. All other geometries keep being merged into the spatially partitioned BLASes, one BLAS per
+	// node would only make the TLAS deeper for them.
+	std::unordered_map<uint32_t, size_t> meshInstanceCounts;
+	for (auto& instance : modelLoader.meshInstances()) {
+		++meshInstanceCounts[instance.meshIndex];
+	}
 
-	for (size_t i = 0; i < numASesPerDimension; ++i) {
-		for (size_t j = 0; j < numASesPerDimension; ++j) {
-			for (size_t k = 0; k < numASesPerDimension; ++k) {
-				asAABBs.push_back({ .xmin = modelBounds.xmin + k * aabbChunkLength[0],
-									.ymin = modelBounds.ymin + j * aabbChunkLength[1],
-									.zmin = modelBounds.zmin + i * aabbChunkLength[2],
-									.xmax = modelBounds.xmin + (k + 1) * aabbChunkLength[0],
-									.ymax = modelBounds.ymin + (j + 1) * aabbChunkLength[1],
-									.zmax = modelBounds.zmin + (i + 1) * aabbChunkLength[2] });
+	// geometries without triangles or vertices can't be hit and are left out of all BLASes, this also keeps maxVertex
+	// from wrapping around
+	auto hasTriangles = [](const Geometry& geometry) { return geometry.indexCount >= 3 && geometry.vertexCount > 0; };
+
+	std::vector<bool> isGeometryInstanced = std::vector<bool>(modelLoader.geometries().size());
+	std::unordered_map<uint32_t, size_t> meshASIndices;
+	for (auto& instance : modelLoader.meshInstances()) {
+		if (meshInstanceCounts[instance.meshIndex] < 2)
+			continue;
+
+		auto geometryBegin = modelLoader.geometries().begin() + instance.firstGeometryIndex;
+		auto geometryEnd = geometryBegin + instance.geometryCount;
+		// a BLAS needs at least one geometry
+		if (std::none_of(geometryBegin, geometryEnd, hasTriangles))
+			continue;
+		std::fill(isGeometryInstanced.begin() + instance.firstGeometryIndex,
+				  isGeometryInstanced.begin() + instance.firstGeometryIndex + instance.geometryCount, true);
+
+		auto asIndexIterator = meshASIndices.find(instance.meshIndex);
+		if (asIndexIterator == meshASIndices.end()) {
+			asIndexIterator = meshASIndices.insert({ instance.meshIndex, asGeometryData.size() }).first;
+			AccelerationStructureGeometryInfo& data = asGeometryData.emplace_back();
+
+			for (auto geometry = geometryBegin; geometry != geometryEnd; ++geometry) {
+				if (!hasTriangles(*geometry))
+					continue;
+				VkAccelerationStructureGeometryTrianglesDataKHR triangles = {
+					.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_TRIANGLES_DATA_KHR,
+					.vertexFormat = VK_FORMAT_R32G32B32_SFLOAT,
+					.vertexData = { .deviceAddress = modelLoader.vertexBufferDeviceAddress() + geometry->vertexOffset },
+					.vertexStride = 3 * sizeof(float),
+					.maxVertex = static_cast<uint32_t>(geometry->vertexCount - 1),
+					.indexType = geometry->hasShortIndices ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32,
+					.indexData = { .deviceAddress = modelLoader.indexBufferDeviceAddress() + geometry->indexOffset }
+				};
+				data.geometries.push_back({ .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR,
+											.geometryType = VK_GEOMETRY_TYPE_TRIANGLES_KHR,
+											.geometry = { .triangles = triangles },
+											.flags = geometry->isAlphaTested ? 0U : VK_GEOMETRY_OPAQUE_BIT_KHR });
+				data.rangeInfos.push_back({ .primitiveCount = static_cast<uint32_t>(geometry->indexCount / 3) });
 			}
 		}
+
+		// all geometries of a node share its transform, offset the same way as the partitioned BLASes
+		AccelerationStructureInstanceInfo instanceInfo = { .transform = transformMatrixFromGeometry(*geometryBegin) };
+		for (size_t i = 0; i < 3; ++i) {
+			instanceInfo.transform.matrix[i][3] += 1.0f;
+		}
+		// the BLAS geometry indices only count the geometries that were added to it
+		for (size_t i = 0; i < instance.geometryCount; ++i) {
+			if (hasTriangles(geometryBegin[i]))
+				instanceInfo.geometryIndices.push_back(instance.firstGeometryIndex + i);
+		}
+		asGeometryData[asIndexIterator->second].instances.push_back(std::move(instanceInfo));
 	}
 
 	VkBuffer triangleTransformBuffer;
@@ -82,69 +227,116 @@ AccelerationStructureBuilder::AccelerationStructureBuilder(RayTracingDevice& dev
 	std::vector<VkTransformMatrixKHR> transformMatrices;
 	transformMatrices.reserve(modelLoader.geometries().size());
 
-	#ifdef AS_HEURISTIC_GEOMETRY_INTERSECTION
-	for (auto& geometry : modelLoader.geometries()) {
-		bestAccelerationStructureIndex(asAABBs, modelBounds, geometry.aabb);
+	// everything else is merged into BLASes with the geometry transforms baked in and one instance each
+	std::vector<size_t> partitionedGeometryIndices;
+	std::vector<PartitionItem> partitionItems;
+	for (size_t i = 0; i < modelLoader.geometries().size(); ++i) {
+		const Geometry& geometry = modelLoader.geometries()[i];
+		if (isGeometryInstanced[i] || !hasTriangles(geometry))
+			continue;
+		partitionedGeometryIndices.push_back(i);
+		partitionItems.push_back({ .bounds = geometry.aabb, .triangleCount = geometry.indexCount / 3 });
 	}
-	#endif
+
+	// both partitionings are evaluated, so that the cost model can be compared against the grid
+	PartitionCostModel costModel = { .tlasNodeCost = tlasNodeCost,
+									 .blasEntryCost = blasEntryCost,
+									 .blasNodeCost = blasNodeCost };
+	std::vector<GeometryPartition> sahPartitions =
+		partitionGeometries(partitionItems, costModel, blasPartitionBinCount);
+	std::vector<GeometryPartition> gridPartitions =
+		partitionGeometriesInGrid(partitionItems, modelLoader.modelBounds());
+	printf("SAH partitioning: %zu BLASes, expected traversal cost %f\n", sahPartitions.size(),
+		   partitionTraversalCost(sahPartitions, costModel));
+	printf("Grid partitioning: %zu BLASes, expected traversal cost %f\n", gridPartitions.size(),
+		   partitionTraversalCost(gridPartitions, costModel));
+	const std::vector<GeometryPartition>& partitions = sahBLASPartitioning ? sahPartitions : gridPartitions;
 
 	size_t currentTransformBufferOffset = 0;
-	size_t geometryIndex = 0;
-	for (auto& geometry : modelLoader.geometries()) {
-		size_t asIndex = bestAccelerationStructureIndex(asAABBs, modelBounds, geometry.aabb, false);
-		asGeometryData[asIndex].geometries.push_back(
-			{ .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR,
-			  .geometryType = VK_GEOMETRY_TYPE_TRIANGLES_KHR,
-			  .geometry = { .triangles = { .sType =
-											   VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_TRIANGLES_DATA_KHR,
-										   .vertexFormat = VK_FORMAT_R32G32B32_SFLOAT,
-										   .vertexData = { .deviceAddress = modelLoader.vertexBufferDeviceAddress() +
-																			geometry.vertexOffset },
-										   .vertexStride = 3 * sizeof(float),
-										   .maxVertex = static_cast<uint32_t>(geometry.vertexCount - 1),
-										   .indexType = VK_INDEX_TYPE_UINT32,
-										   .indexData = { .deviceAddress = modelLoader.indexBufferDeviceAddress() +
-																		   geometry.indexOffset },
-										   .transformData = { .deviceAddress = triangleTransformBufferDeviceAddress +
-																			   currentTransformBufferOffset } } },
-			  .flags = geometry.isAlphaTested ? 0U : VK_GEOMETRY_OPAQUE_BIT_KHR });
-		VkTransformMatrixKHR transformMatrix = { .matrix = {
-													 { geometry.transformMatrix[0], geometry.transformMatrix[1],
-													   geometry.transformMatrix[2], geometry.transformMatrix[3] },
-													 { geometry.transformMatrix[4], geometry.transformMatrix[5],
-													   geometry.transformMatrix[6], geometry.transformMatrix[7] },
-													 { geometry.transformMatrix[8], geometry.transformMatrix[9],
-													   geometry.transformMatrix[10], geometry.transformMatrix[11] }
-		} };
-		asGeometryData[asIndex].rangeInfos.push_back(
-			{ .primitiveCount = static_cast<uint32_t>(geometry.indexCount / 3) });
-		transformMatrices.push_back(transformMatrix);
-		currentTransformBufferOffset += sizeof(VkTransformMatrixKHR);
-
-		asGeometryData[asIndex].geometryIndices.push_back(geometryIndex);
-		++geometryIndex;
+	for (auto& partition : partitions) {
+		AccelerationStructureGeometryInfo& data = asGeometryData.emplace_back();
+		data.instances.push_back({ .transform = { .matrix = { { 1.0f, 0.0f, 0.0f, 1.0f },
+															  { 0.0f, 1.0f, 0.0f, 1.0f },
+															  { 0.0f, 0.0f, 1.0f, 1.0f } } } });
+
+		for (auto& itemIndex : partition.itemIndices) {
+			size_t geometryIndex = partitionedGeometryIndices[itemIndex];
+			const Geometry& geometry = modelLoader.geometries()[geometryIndex];
+			VkAccelerationStructureGeometryTrianglesDataKHR triangles = {
+				.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_TRIANGLES_DATA_KHR,
+				.vertexFormat = VK_FORMAT_R32G32B32_SFLOAT,
+				.vertexData = { .deviceAddress = modelLoader.vertexBufferDeviceAddress() + geometry.vertexOffset },
+				.vertexStride = 3 * sizeof(float),
+				.maxVertex = static_cast<uint32_t>(geometry.vertexCount - 1),
+				.indexType = geometry.hasShortIndices ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32,
+				.indexData = { .deviceAddress = modelLoader.indexBufferDeviceAddress() + geometry.indexOffset },
+				.transformData = { .deviceAddress =
+									   triangleTransformBufferDeviceAddress + currentTransformBufferOffset }
+			};
+			data.geometries.push_back({ .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR,
+										.geometryType = VK_GEOMETRY_TYPE_TRIANGLES_KHR,
+										.geometry = { .triangles = triangles },
+										.flags = geometry.isAlphaTested ? 0U : VK_GEOMETRY_OPAQUE_BIT_KHR });
+			data.rangeInfos.push_back({ .primitiveCount = static_cast<uint32_t>(geometry.indexCount / 3) });
+			transformMatrices.push_back(transformMatrixFromGeometry(geometry));
+			currentTransformBufferOffset += sizeof(VkTransformMatrixKHR);
+
+			data.instances.front().geometryIndices.push_back(geometryIndex);
+		}
 	}
 
 	std::memcpy(mappedTransformStagingBuffer, transformMatrices.data(),
 				transformMatrices.size() * sizeof(VkTransformMatrixKHR));
 
+	// The triangle BLASes are restored from the cache instead of built if it belongs to the same scene, partitioning,
+	// device and driver, holds as many BLASes as would be built and the driver can deserialize all of them.
+	size_t triangleBLASCount = std::count_if(asGeometryData.begin(), asGeometryData.end(),
+											 [](const auto& data) { return !data.geometries.empty(); });
+	bool cacheBLASes = enableAccelerationStructureCache && modelLoader.hasSceneHash() && triangleBLASCount > 0;
+	uint64_t cacheKey = 0;
+	AccelerationStructureCacheReader blasCache;
+	bool restoreBLASes = false;
+	if (cacheBLASes) {
+		cacheKey = blasCacheKey(modelLoader.sceneHash(), idProperties);
+		if (blasCache.open(accelerationStructureCachePath(cacheKey), cacheKey)) {
+			restoreBLASes =
+				blasCache.structureCount() == triangleBLASCount && isBLASCacheCompatible(m_device.device(), blasCache);
+			if (!restoreBLASes)
+				printf("BLAS cache %s is stale or incompatible, rebuilding\n",
+					   accelerationStructureCachePath(cacheKey).c_str());
+		}
+	}
+
 	std::vector<VkAccelerationStructureBuildGeometryInfoKHR> buildInfos;
 	std::vector<std::vector<VkAccelerationStructureBuildRangeInfoKHR>> buildRangeInfos;
 	std::vector<VkAccelerationStructureBuildRangeInfoKHR*> ptrBuildRangeInfos;
-	std::vector<VkBuffer> uncompactedASBackingBuffers;
-	std::vector<VkAccelerationStructureKHR> uncompactedBLASes;
-	std::vector<VkBuffer> triangleASBuildScratchBuffers;
-	std::vector<size_t> geometryIndexBufferOffsets;
+	// structure and scratch memory of each build, in the order of buildInfos
+	std::vector<VkDeviceSize> structureSizes;
+	std::vector<VkDeviceSize> scratchSizes;
+	// instances to create for each triangle BLAS, in build order
+	std::vector<const std::vector<AccelerationStructureInstanceInfo>*> blasInstances;
 
 	std::vector<uint32_t> geometryIndices;
 
-	buildInfos.reserve(numASSubdivisions);
+	buildInfos.reserve(asGeometryData.size());
+	buildRangeInfos.reserve(asGeometryData.size() + 1);
 	geometryIndices.reserve(modelLoader.geometries().size());
 
 	VkBufferDeviceAddressInfo deviceAddressInfo = { .sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO };
 
 	for (auto& data : asGeometryData) {
 		if (!data.geometries.empty()) {
+			for (auto& instance : data.instances) {
+				instance.geometryIndexBufferOffset = static_cast<uint32_t>(geometryIndices.size());
+				for (auto& index : instance.geometryIndices) {
+					geometryIndices.push_back(index);
+				}
+			}
+			blasInstances.push_back(&data.instances);
+
+			if (restoreBLASes)
+				continue;
+
 			buildRangeInfos.push_back({});
 			buildRangeInfos.back().reserve(data.geometries.size());
 
@@ -164,21 +356,10 @@ AccelerationStructureBuilder::AccelerationStructureBuilder(RayTracingDevice& dev
 				primitiveCounts.push_back(info.primitiveCount);
 			}
 
-			geometryIndexBufferOffsets.push_back(geometryIndices.size());
-			for (auto& index : data.geometryIndices) {
-				geometryIndices.push_back(index);
-			}
-
-			AccelerationStructureData accelerationStructureData = createAccelerationStructure(
-				buildInfos.back(), primitiveCounts,
-				accelerationStructureProperties.minAccelerationStructureScratchOffsetAlignment);
-
-			buildInfos.back().dstAccelerationStructure = accelerationStructureData.accelerationStructure;
-			buildInfos.back().scratchData = { .deviceAddress = accelerationStructureData.scratchBufferDeviceAddress };
-
-			uncompactedASBackingBuffers.push_back(accelerationStructureData.backingBuffer);
-			uncompactedBLASes.push_back(accelerationStructureData.accelerationStructure);
-			triangleASBuildScratchBuffers.push_back(accelerationStructureData.scratchBuffer);
+			VkAccelerationStructureBuildSizesInfoKHR sizeInfo =
+				accelerationStructureBuildSizes(buildInfos.back(), primitiveCounts);
+			structureSizes.push_back(sizeInfo.accelerationStructureSize);
+			scratchSizes.push_back(sizeInfo.buildScratchSize);
 			ptrBuildRangeInfos.push_back(buildRangeInfos.back().data());
 		}
 	}
@@ -187,7 +368,8 @@ AccelerationStructureBuilder::AccelerationStructureBuilder(RayTracingDevice& dev
 	VkBuffer sphereAABBBuffer;
 	VkDeviceAddress sphereAABBBufferDeviceAddress;
 	VkBuffer sphereAABBStagingBuffer;
-	AccelerationStructureData sphereBLASData;
+	// referenced by the sphere build info until the BLASes are built
+	VkAccelerationStructureGeometryKHR sphereGeometry;
 
 	if (lightSpheres.size() > 0) {
 		VkBufferCreateInfo sphereAABBBufferCreateInfo = {
@@ -210,7 +392,7 @@ AccelerationStructureBuilder::AccelerationStructureBuilder(RayTracingDevice& dev
 		deviceAddressInfo.buffer = sphereAABBBuffer;
 		sphereAABBBufferDeviceAddress = vkGetBufferDeviceAddress(m_device.device(), &deviceAddressInfo);
 
-		VkAccelerationStructureGeometryKHR sphereGeometry = {
+		sphereGeometry = {
 			.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR,
 			.geometryType = VK_GEOMETRY_TYPE_AABBS_KHR,
 			.geometry = { .aabbs = { .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_AABBS_DATA_KHR,
@@ -231,16 +413,15 @@ AccelerationStructureBuilder::AccelerationStructureBuilder(RayTracingDevice& dev
 
 		uint32_t sphereCount = lightSpheres.size();
 
-		sphereBLASData = createAccelerationStructure(
-			sphereBuildInfo, { 1 }, accelerationStructureProperties.minAccelerationStructureScratchOffsetAlignment);
-
-		sphereBuildInfo.dstAccelerationStructure = sphereBLASData.accelerationStructure;
-		sphereBuildInfo.scratchData = { .deviceAddress = sphereBLASData.scratchBufferDeviceAddress };
+		VkAccelerationStructureBuildSizesInfoKHR sphereSizeInfo =
+			accelerationStructureBuildSizes(sphereBuildInfo, { 1 });
 
+		// the sphere BLAS is always the last build
 		buildInfos.push_back(sphereBuildInfo);
+		structureSizes.push_back(sphereSizeInfo.accelerationStructureSize);
+		scratchSizes.push_back(sphereSizeInfo.buildScratchSize);
 		buildRangeInfos.push_back({ { .primitiveCount = 1 } });
 		ptrBuildRangeInfos.push_back(buildRangeInfos.back().data());
-		uncompactedBLASes.push_back(sphereBLASData.accelerationStructure);
 
 		VkBufferCreateInfo sphereDataBufferCreateInfo = { .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
 														  .size = sphereCount * sizeof(Sphere),
@@ -260,12 +441,59 @@ AccelerationStructureBuilder::AccelerationStructureBuilder(RayTracingDevice& dev
 
 		std::memcpy(mappedLightDataStagingBuffer, lightSpheres.data(), sphereCount * sizeof(Sphere));
 
-		sphereBuildInfo.dstAccelerationStructure = sphereBLASData.accelerationStructure;
-		sphereBuildInfo.scratchData = { .deviceAddress = sphereBLASData.scratchBufferDeviceAddress };
-
 		m_lightDataBufferSize = sphereCount * sizeof(Sphere);
 	}
 
+	// Uncompacted BLASes are built batch by batch into one arena of blasBuildBudget and compacted into buffers of their
+	// own before the next batch reuses the arena, so uncompacted memory never exceeds the arena. The builds of a batch
+	// share one scratch pool the same way, builds that don't fit into it together run one after another.
+	VkDeviceSize scratchAlignment = accelerationStructureProperties.minAccelerationStructureScratchOffsetAlignment;
+	MemoryBatching arenaBatching =
+		batchMemory(structureSizes, uncompactedAccelerationStructureAlignment, blasBuildBudget);
+	std::vector<MemoryBatching> scratchBatchings;
+	scratchBatchings.reserve(arenaBatching.batches.size());
+	VkDeviceSize scratchPoolSize = 0;
+	for (auto& batch : arenaBatching.batches) {
+		std::vector<VkDeviceSize> batchScratchSizes;
+		batchScratchSizes.reserve(batch.size());
+		for (auto& index : batch) {
+			batchScratchSizes.push_back(scratchSizes[index]);
+		}
+		scratchBatchings.push_back(batchMemory(batchScratchSizes, scratchAlignment, blasScratchBudget));
+		scratchPoolSize = std::max(scratchPoolSize, scratchBatchings.back().poolSize);
+	}
+
+	VkBuffer uncompactedArenaBuffer = VK_NULL_HANDLE;
+	VkBuffer scratchPoolBuffer = VK_NULL_HANDLE;
+	VkDeviceAddress scratchPoolDeviceAddress = 0;
+	if (!buildInfos.empty()) {
+		VkBufferCreateInfo arenaBufferCreateInfo = { .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+													 .size = arenaBatching.poolSize,
+													 .usage = VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR };
+		verifyResult(vkCreateBuffer(m_device.device(), &arenaBufferCreateInfo, nullptr, &uncompactedArenaBuffer));
+		m_allocator.bindDeviceBuffer(uncompactedArenaBuffer, uncompactedAccelerationStructureAlignment);
+		setObjectName(m_device.device(), VK_OBJECT_TYPE_BUFFER, uncompactedArenaBuffer, "Uncompacted BLAS arena");
+
+		VkBufferCreateInfo scratchPoolBufferCreateInfo = { .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+														   .size = scratchPoolSize,
+														   .usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+																	VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT };
+		verifyResult(vkCreateBuffer(m_device.device(), &scratchPoolBufferCreateInfo, nullptr, &scratchPoolBuffer));
+		m_allocator.bindDeviceBuffer(scratchPoolBuffer, scratchAlignment);
+		setObjectName(m_device.device(), VK_OBJECT_TYPE_BUFFER, scratchPoolBuffer, "BLAS scratch pool");
+
+		deviceAddressInfo.buffer = scratchPoolBuffer;
+		scratchPoolDeviceAddress = vkGetBufferDeviceAddress(m_device.device(), &deviceAddressInfo);
+
+		VkDeviceSize totalStructureSize =
+			std::accumulate(structureSizes.begin(), structureSizes.end(), VkDeviceSize{ 0 });
+		VkDeviceSize totalScratchSize = std::accumulate(scratchSizes.begin(), scratchSizes.end(), VkDeviceSize{ 0 });
+		printf("Building %zu BLASes in %zu batches with a %f MiB arena and %f MiB of scratch memory (%f MiB and %f MiB "
+			   "without batching)\n",
+			   buildInfos.size(), arenaBatching.batches.size(), arenaBatching.poolSize / 1048576.0,
+			   scratchPoolSize / 1048576.0, totalStructureSize / 1048576.0, totalScratchSize / 1048576.0);
+	}
+
 	m_geometryIndexBufferSize = geometryIndices.size() * sizeof(uint32_t);
 	VkBufferCreateInfo geometryIndexBufferCreateInfo = { .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
 														 .size = geometryIndices.size() * sizeof(uint32_t),
@@ -282,21 +510,58 @@ AccelerationStructureBuilder::AccelerationStructureBuilder(RayTracingDevice& dev
 
 	std::memcpy(mappedGeometryIndexBuffer, geometryIndices.data(), m_geometryIndexBufferSize);
 
-	VkQueryPool compactionSizeQueryPool;
+	VkBuffer serializedBLASBuffer = VK_NULL_HANDLE;
+	VkBuffer serializedBLASStagingBuffer = VK_NULL_HANDLE;
+	VkDeviceAddress serializedBLASBufferDeviceAddress = 0;
+	if (restoreBLASes) {
+		void* mappedSerializedBLASStagingBuffer = createSerializationBuffers(
+			blasCache.dataSize(), serializedBLASBuffer, serializedBLASBufferDeviceAddress, serializedBLASStagingBuffer);
+		std::memcpy(mappedSerializedBLASStagingBuffer, blasCache.data(), blasCache.dataSize());
+	}
+
+	// nothing is built if all BLASes are restored and there are no light spheres
+	VkQueryPool compactionSizeQueryPool = VK_NULL_HANDLE;
 
 	VkQueryPoolCreateInfo blasSizeQueryPoolCreateInfo = { .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
 														  .queryType =
 															  VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR,
 														  .queryCount = static_cast<uint32_t>(buildInfos.size()) };
-	verifyResult(vkCreateQueryPool(m_device.device(), &blasSizeQueryPoolCreateInfo, nullptr, &compactionSizeQueryPool));
+	if (!buildInfos.empty()) {
+		verifyResult(
+			vkCreateQueryPool(m_device.device(), &blasSizeQueryPoolCreateInfo, nullptr, &compactionSizeQueryPool));
+	}
 
-	std::vector<VkCommandBuffer> commandBuffers = m_dispatcher.allocateOneTimeSubmitBuffers(2);
+	VkQueryPool serializationSizeQueryPool = VK_NULL_HANDLE;
+	if (cacheBLASes && !restoreBLASes) {
+		VkQueryPoolCreateInfo serializationSizeQueryPoolCreateInfo = {
+			.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+			.queryType = VK_QUERY_TYPE_ACCELERATION_STRUCTURE_SERIALIZATION_SIZE_KHR,
+			.queryCount = static_cast<uint32_t>(triangleBLASCount)
+		};
+		verifyResult(vkCreateQueryPool(m_device.device(), &serializationSizeQueryPoolCreateInfo, nullptr,
+									   &serializationSizeQueryPool));
+	}
+
+	// one command buffer per BLAS batch, the last one also compacts the last batch, and one for the TLAS
+	std::vector<VkCommandBuffer> commandBuffers =
+		m_dispatcher.allocateOneTimeSubmitBuffers(static_cast<uint32_t>(arenaBatching.batches.size() + 2));
 	VkCommandBuffer blasBuildBuffer = commandBuffers[0];
 	VkCommandBufferBeginInfo beginInfo = { .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
 										   .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT };
 	verifyResult(vkBeginCommandBuffer(blasBuildBuffer, &beginInfo));
 
-	vkCmdResetQueryPool(blasBuildBuffer, compactionSizeQueryPool, 0, static_cast<uint32_t>(buildInfos.size()));
+	if (!buildInfos.empty())
+		vkCmdResetQueryPool(blasBuildBuffer, compactionSizeQueryPool, 0, static_cast<uint32_t>(buildInfos.size()));
+
+	// the model buffers were uploaded on the transfer queue, the submit below waits for that on the GPU
+	const std::vector<VkBufferMemoryBarrier>& modelBufferBarriers = modelLoader.bufferAcquireBarriers();
+	if (!modelBufferBarriers.empty()) {
+		vkCmdPipelineBarrier(blasBuildBuffer, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
+							 VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR |
+								 VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR,
+							 0, 0, nullptr, static_cast<uint32_t>(modelBufferBarriers.size()),
+							 modelBufferBarriers.data(), 0, nullptr);
+	}
 
 	VkBufferCopy bufferCopy = { .size = transformMatrices.size() * sizeof(VkTransformMatrixKHR) };
 	vkCmdCopyBuffer(blasBuildBuffer, triangleTransformStagingBuffer, triangleTransformBuffer, 1, &bufferCopy);
@@ -319,45 +584,136 @@ AccelerationStructureBuilder::AccelerationStructureBuilder(RayTracingDevice& dev
 						 VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, 0, 1, &barrier, 0, nullptr, 0,
 						 nullptr);
 
-	vkCmdBuildAccelerationStructuresKHR(blasBuildBuffer, buildInfos.size(), buildInfos.data(),
-										ptrBuildRangeInfos.data());
+	std::vector<TimelineSemaphoreWait> uploadWaits;
+	if (modelLoader.uploadSemaphore() != VK_NULL_HANDLE) {
+		uploadWaits.push_back({ .semaphore = modelLoader.uploadSemaphore(),
+								.value = modelLoader.geometryUploadValue(),
+								.stageMask = VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR });
+	}
 
-	barrier.srcAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
-	barrier.dstAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR;
-	vkCmdPipelineBarrier(blasBuildBuffer, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
-						 VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, 0, 1, &barrier, 0, nullptr, 0,
-						 nullptr);
+	// Every submit compacts the batch built by the previous one and builds the next batch into the arena. Only the
+	// compacted sizes have to come back to the CPU in between, to create the structures the batch is compacted into.
+	std::vector<VkAccelerationStructureKHR> uncompactedBLASes =
+		std::vector<VkAccelerationStructureKHR>(buildInfos.size(), VK_NULL_HANDLE);
+	std::vector<AccelerationStructureData> compactedBLASes = std::vector<AccelerationStructureData>(buildInfos.size());
+	std::vector<uint32_t> compactedASSizes = std::vector<uint32_t>(buildInfos.size());
+
+	std::vector<VkAccelerationStructureBuildGeometryInfoKHR> batchBuildInfos;
+	std::vector<VkAccelerationStructureBuildRangeInfoKHR*> batchBuildRangeInfos;
+	VkMemoryBarrier accelerationStructureBarrier = {
+		.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+		.srcAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR | VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR,
+		.dstAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR | VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR
+	};
+
+	VkCommandBuffer commandBuffer = blasBuildBuffer;
+	for (size_t batchIndex = 0; batchIndex <= arenaBatching.batches.size(); ++batchIndex) {
+		if (batchIndex > 0) {
+			for (auto& index : arenaBatching.batches[batchIndex - 1]) {
+				VkCopyAccelerationStructureInfoKHR copy = {
+					.sType = VK_STRUCTURE_TYPE_COPY_ACCELERATION_STRUCTURE_INFO_KHR,
+					.src = uncompactedBLASes[index],
+					.dst = compactedBLASes[index].accelerationStructure,
+					.mode = VK_COPY_ACCELERATION_STRUCTURE_MODE_COMPACT_KHR
+				};
+				vkCmdCopyAccelerationStructureKHR(commandBuffer, &copy);
+			}
+		}
+
+		if (batchIndex < arenaBatching.batches.size()) {
+			const std::vector<size_t>& batch = arenaBatching.batches[batchIndex];
+			const MemoryBatching& scratchBatching = scratchBatchings[batchIndex];
+
+			// the compaction copies above read the part of the arena this batch is built into
+			if (batchIndex > 0) {
+				vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
+									 VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, 0, 1,
+									 &accelerationStructureBarrier, 0, nullptr, 0, nullptr);
+			}
+
+			for (size_t i = 0; i < batch.size(); ++i) {
+				uncompactedBLASes[batch[i]] = createAccelerationStructure(
+					uncompactedArenaBuffer, arenaBatching.offsets[batch[i]], structureSizes[batch[i]]);
+				buildInfos[batch[i]].dstAccelerationStructure = uncompactedBLASes[batch[i]];
+				buildInfos[batch[i]].scratchData = { .deviceAddress =
+														 scratchPoolDeviceAddress + scratchBatching.offsets[i] };
+			}
+
+			for (size_t i = 0; i < scratchBatching.batches.size(); ++i) {
+				// the previous scratch batch has to be done with the scratch memory before this one reuses it
+				if (i > 0) {
+					vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
+										 VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, 0, 1,
+										 &accelerationStructureBarrier, 0, nullptr, 0, nullptr);
+				}
+
+				batchBuildInfos.clear();
+				batchBuildRangeInfos.clear();
+				for (auto& scratchIndex : scratchBatching.batches[i]) {
+					batchBuildInfos.push_back(buildInfos[batch[scratchIndex]]);
+					batchBuildRangeInfos.push_back(ptrBuildRangeInfos[batch[scratchIndex]]);
+				}
+				vkCmdBuildAccelerationStructuresKHR(commandBuffer, batchBuildInfos.size(), batchBuildInfos.data(),
+													batchBuildRangeInfos.data());
+			}
 
-	vkCmdWriteAccelerationStructuresPropertiesKHR(
-		blasBuildBuffer, static_cast<uint32_t>(uncompactedBLASes.size()), uncompactedBLASes.data(),
-		VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR, compactionSizeQueryPool, 0);
+			barrier.srcAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
+			barrier.dstAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR;
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
+								 VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, 0, 1, &barrier, 0, nullptr, 0,
+								 nullptr);
+
+			// query indices follow the build indices, the pool was reset for all of them in the first submit
+			for (auto& index : batch) {
+				vkCmdWriteAccelerationStructuresPropertiesKHR(
+					commandBuffer, 1, &uncompactedBLASes[index],
+					VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR, compactionSizeQueryPool,
+					static_cast<uint32_t>(index));
+			}
+		}
 
-	verifyResult(vkEndCommandBuffer(blasBuildBuffer));
+		verifyResult(vkEndCommandBuffer(commandBuffer));
+		if (batchIndex == 0)
+			m_dispatcher.submit(commandBuffer, uploadWaits, VK_NULL_HANDLE, 0);
+		else
+			m_dispatcher.submit(commandBuffer, {});
+		m_dispatcher.waitForFence(commandBuffer, UINT64_MAX);
 
-	m_dispatcher.submit(blasBuildBuffer, {});
-	m_dispatcher.waitForFence(blasBuildBuffer, UINT64_MAX);
+		if (batchIndex > 0) {
+			for (auto& index : arenaBatching.batches[batchIndex - 1]) {
+				vkDestroyAccelerationStructureKHR(m_device.device(), uncompactedBLASes[index], nullptr);
+			}
+		}
 
-	std::vector<uint32_t> compactedASSizes = std::vector<uint32_t>(uncompactedBLASes.size());
-	verifyResult(vkGetQueryPoolResults(m_device.device(), compactionSizeQueryPool, 0, uncompactedBLASes.size(),
-									   compactedASSizes.size() * sizeof(uint32_t), compactedASSizes.data(),
-									   sizeof(uint32_t), 0));
+		if (batchIndex < arenaBatching.batches.size()) {
+			for (auto& index : arenaBatching.batches[batchIndex]) {
+				verifyResult(vkGetQueryPoolResults(m_device.device(), compactionSizeQueryPool,
+												   static_cast<uint32_t>(index), 1, sizeof(uint32_t),
+												   &compactedASSizes[index], sizeof(uint32_t), 0));
+				compactedBLASes[index] = createAccelerationStructure(compactedASSizes[index]);
+			}
 
-	std::vector<VkAccelerationStructureInstanceKHR> tlasInstances;
-	tlasInstances.reserve(uncompactedASBackingBuffers.size()); // sphere BLAS data was not appended to this array
+			commandBuffer = commandBuffers[batchIndex + 1];
+			verifyResult(vkBeginCommandBuffer(commandBuffer, &beginInfo));
+		}
+	}
+
+	size_t triangleInstanceCount = 0;
+	for (auto& instances : blasInstances) {
+		triangleInstanceCount += instances->size();
+	}
+
+	m_tlasInstances.reserve(triangleInstanceCount + lightSpheres.size());
 
 	AccelerationStructureData compactedSphereAccelerationStructureData;
 	if (lightSpheres.size() > 0) {
-		uint32_t compactedSphereASSize = compactedASSizes.back();
+		compactedSphereAccelerationStructureData = compactedBLASes.back();
+		compactedBLASes.pop_back();
 		compactedASSizes.pop_back();
-		uncompactedBLASes.pop_back();
-
-		compactedSphereAccelerationStructureData = createAccelerationStructure(compactedSphereASSize);
 
 		for (auto& sphere : lightSpheres) {
-			tlasInstances.push_back(
-				{ .transform = { .matrix = { { 2 * sphere.radius, 0.0f, 0.0f, sphere.position[0] },
-											 { 0.0f, 2 * sphere.radius, 0.0f, sphere.position[1] },
-											 { 0.0f, 0.0f, 2 * sphere.radius, sphere.position[2] } } },
+			m_tlasInstances.push_back(
+				{ .transform = sphereTransform(sphere),
 				  .instanceCustomIndex = 0U,
 				  .mask = 0x01, // culled in ray gen
 				  .instanceShaderBindingTableRecordOffset = lightSphereSBTIndex,
@@ -371,71 +727,79 @@ AccelerationStructureBuilder::AccelerationStructureBuilder(RayTracingDevice& dev
 		m_sphereASBackingBuffer = compactedSphereAccelerationStructureData.backingBuffer;
 	}
 
-	m_triangleBLASes.reserve(compactedASSizes.size());
-	m_triangleASBackingBuffers.reserve(compactedASSizes.size());
+	if (restoreBLASes) {
+		for (size_t i = 0; i < blasCache.structureCount(); ++i) {
+			compactedASSizes.push_back(static_cast<uint32_t>(blasCache.structure(i).structureSize));
+			compactedBLASes.push_back(createAccelerationStructure(compactedASSizes.back()));
+		}
+	}
+
+	m_triangleBLASes.reserve(compactedBLASes.size());
+	m_triangleASBackingBuffers.reserve(compactedBLASes.size());
 
 	uint32_t instanceIndex = 0;
-	for (auto& size : compactedASSizes) {
-		AccelerationStructureData data = createAccelerationStructure(size);
+	for (auto& data : compactedBLASes) {
 		setObjectName(m_device.device(), VK_OBJECT_TYPE_ACCELERATION_STRUCTURE_KHR, data.accelerationStructure,
 					  "Compacted BLAS " + std::to_string(instanceIndex));
 
 		m_triangleBLASes.push_back(data.accelerationStructure);
 		m_triangleASBackingBuffers.push_back(data.backingBuffer);
 
-		tlasInstances.push_back(
-			{ .transform = { .matrix = { { 1.0f, 0.0f, 0.0f, 1.0f },
-										 { 0.0f, 1.0f, 0.0f, 1.0f },
-										 { 0.0f, 0.0f, 1.0f, 1.0f } } },
-			  .instanceCustomIndex = static_cast<uint32_t>(geometryIndexBufferOffsets[instanceIndex]),
-			  .mask = 0xFF,
-			  .instanceShaderBindingTableRecordOffset = triangleSBTIndex,
-			  .accelerationStructureReference = data.accelerationStructureDeviceAddress });
+		for (auto& instance : *blasInstances[instanceIndex]) {
+			m_tlasInstances.push_back({ .transform = instance.transform,
+										.instanceCustomIndex = instance.geometryIndexBufferOffset,
+										.mask = 0xFF,
+										.instanceShaderBindingTableRecordOffset = triangleSBTIndex,
+										.accelerationStructureReference = data.accelerationStructureDeviceAddress });
+		}
 		++instanceIndex;
 	}
 
-	VkBuffer instanceBuffer;
-	VkBuffer instanceStagingBuffer;
-
+	// The instances stay in host memory and are uploaded again through the staging buffer of the current frame
+	// whenever they change, followed by the light data. The first one uploads them for the initial build.
+	m_instanceDataSize = m_tlasInstances.size() * sizeof(VkAccelerationStructureInstanceKHR);
 	VkBufferCreateInfo instanceBufferCreateInfo = {
 		.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
-		.size = tlasInstances.size() * sizeof(VkAccelerationStructureInstanceKHR),
+		.size = m_instanceDataSize,
 		.usage = VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR |
 				 VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT
 	};
-	verifyResult(vkCreateBuffer(m_device.device(), &instanceBufferCreateInfo, nullptr, &instanceBuffer));
-	instanceBufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	verifyResult(vkCreateBuffer(m_device.device(), &instanceBufferCreateInfo, nullptr, &m_instanceBuffer));
+	m_allocator.bindDeviceBuffer(m_instanceBuffer, 0);
+	setObjectName(m_device.device(), VK_OBJECT_TYPE_BUFFER, m_instanceBuffer, "TLAS instance buffer");
 
-	verifyResult(vkCreateBuffer(m_device.device(), &instanceBufferCreateInfo, nullptr, &instanceStagingBuffer));
-
-	m_allocator.bindDeviceBuffer(instanceBuffer, 0);
-	void* mappedInstanceStagingBuffer = m_allocator.bindStagingBuffer(instanceStagingBuffer, 0);
+	instanceBufferCreateInfo.size = m_instanceDataSize + m_lightDataBufferSize;
+	instanceBufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	for (uint32_t i = 0; i < frameInFlightCount; ++i) {
+		verifyResult(
+			vkCreateBuffer(m_device.device(), &instanceBufferCreateInfo, nullptr, &m_instanceStagingBuffers[i]));
+		m_mappedInstanceStagingBuffers[i] = m_allocator.bindStagingBuffer(m_instanceStagingBuffers[i], 0);
+	}
 
-	std::memcpy(mappedInstanceStagingBuffer, tlasInstances.data(),
-				tlasInstances.size() * sizeof(VkAccelerationStructureInstanceKHR));
+	std::memcpy(m_mappedInstanceStagingBuffers[0], m_tlasInstances.data(), m_instanceDataSize);
 
-	deviceAddressInfo.buffer = instanceBuffer;
-	VkDeviceAddress instanceBufferDeviceAddress = vkGetBufferDeviceAddress(m_device.device(), &deviceAddressInfo);
+	deviceAddressInfo.buffer = m_instanceBuffer;
+	m_instanceBufferDeviceAddress = vkGetBufferDeviceAddress(m_device.device(), &deviceAddressInfo);
 
 	VkAccelerationStructureGeometryKHR tlasGeometry = {
 		.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR,
 		.geometryType = VK_GEOMETRY_TYPE_INSTANCES_KHR,
 		.geometry = { .instances = { .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_INSTANCES_DATA_KHR,
 									 .arrayOfPointers = VK_FALSE,
-									 .data = instanceBufferDeviceAddress } }
+									 .data = m_instanceBufferDeviceAddress } }
 	};
 
 	VkAccelerationStructureBuildGeometryInfoKHR tlasBuildInfo = {
 		.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR,
 		.type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR,
-		.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR,
+		.flags = tlasBuildFlags,
 		.mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR,
 		.geometryCount = 1,
 		.pGeometries = &tlasGeometry
 	};
 
 	AccelerationStructureData tlasData = createAccelerationStructure(
-		tlasBuildInfo, { static_cast<uint32_t>(tlasInstances.size()) },
+		tlasBuildInfo, { static_cast<uint32_t>(m_tlasInstances.size()) },
 		accelerationStructureProperties.minAccelerationStructureScratchOffsetAlignment, true);
 
 	tlasBuildInfo.dstAccelerationStructure = tlasData.accelerationStructure;
@@ -445,74 +809,96 @@ AccelerationStructureBuilder::AccelerationStructureBuilder(RayTracingDevice& dev
 
 	m_tlas = tlasData.accelerationStructure;
 	m_tlasBackingBuffer = tlasData.backingBuffer;
+	m_tlasScratchBuffer = tlasData.scratchBuffer;
+	m_tlasScratchBufferDeviceAddress = tlasData.scratchBufferDeviceAddress;
 
-	VkCommandBuffer tlasBuildBuffer = commandBuffers[1];
+	VkCommandBuffer tlasBuildBuffer = commandBuffers.back();
 	verifyResult(vkBeginCommandBuffer(tlasBuildBuffer, &beginInfo));
 
-	bufferCopy.size = tlasInstances.size() * sizeof(VkAccelerationStructureInstanceKHR);
-	vkCmdCopyBuffer(tlasBuildBuffer, instanceStagingBuffer, instanceBuffer, 1, &bufferCopy);
-
-	uint32_t compactedBLASIndex = 0;
-	for (auto& blas : uncompactedBLASes) {
-		VkCopyAccelerationStructureInfoKHR copy = { .sType = VK_STRUCTURE_TYPE_COPY_ACCELERATION_STRUCTURE_INFO_KHR,
-													.src = blas,
-													.dst = m_triangleBLASes[compactedBLASIndex],
-													.mode = VK_COPY_ACCELERATION_STRUCTURE_MODE_COMPACT_KHR };
-		vkCmdCopyAccelerationStructureKHR(tlasBuildBuffer, &copy);
-		++compactedBLASIndex;
-	}
-
-	if (lightSpheres.size() > 0) {
-		VkCopyAccelerationStructureInfoKHR copy = { .sType = VK_STRUCTURE_TYPE_COPY_ACCELERATION_STRUCTURE_INFO_KHR,
-													.src = sphereBLASData.accelerationStructure,
-													.dst = m_sphereBLAS,
-													.mode = VK_COPY_ACCELERATION_STRUCTURE_MODE_COMPACT_KHR };
-		vkCmdCopyAccelerationStructureKHR(tlasBuildBuffer, &copy);
+	bufferCopy.size = m_instanceDataSize;
+	vkCmdCopyBuffer(tlasBuildBuffer, m_instanceStagingBuffers[0], m_instanceBuffer, 1, &bufferCopy);
+
+	if (restoreBLASes) {
+		bufferCopy.size = blasCache.dataSize();
+		vkCmdCopyBuffer(tlasBuildBuffer, serializedBLASStagingBuffer, serializedBLASBuffer, 1, &bufferCopy);
+
+		VkMemoryBarrier deserializeBarrier = { .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+											   .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+											   .dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT };
+		vkCmdPipelineBarrier(tlasBuildBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+							 VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, 0, 1, &deserializeBarrier, 0,
+							 nullptr, 0, nullptr);
+
+		for (size_t i = 0; i < blasCache.structureCount(); ++i) {
+			VkCopyMemoryToAccelerationStructureInfoKHR copy = {
+				.sType = VK_STRUCTURE_TYPE_COPY_MEMORY_TO_ACCELERATION_STRUCTURE_INFO_KHR,
+				.src = { .deviceAddress = serializedBLASBufferDeviceAddress + blasCache.structure(i).dataOffset },
+				.dst = m_triangleBLASes[i],
+				.mode = VK_COPY_ACCELERATION_STRUCTURE_MODE_DESERIALIZE_KHR
+			};
+			vkCmdCopyMemoryToAccelerationStructureKHR(tlasBuildBuffer, &copy);
+		}
 	}
 
-	VkMemoryBarrier memoryBarrier = { .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
-									  .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
-									  .dstAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR };
-	vkCmdPipelineBarrier(tlasBuildBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+	// also covers the compaction copies of the BLAS batch submits
+	VkMemoryBarrier memoryBarrier = {
+		.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+		.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR,
+		.dstAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR
+	};
+	vkCmdPipelineBarrier(tlasBuildBuffer,
+						 VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
 						 VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, 0, 1, &memoryBarrier, 0, nullptr, 0,
 						 nullptr);
 
 	VkAccelerationStructureBuildRangeInfoKHR rangeInfo = { .primitiveCount =
-															   static_cast<uint32_t>(tlasInstances.size()) };
+															   static_cast<uint32_t>(m_tlasInstances.size()) };
 	VkAccelerationStructureBuildRangeInfoKHR* ptrRangeInfo = &rangeInfo;
 
 	vkCmdBuildAccelerationStructuresKHR(tlasBuildBuffer, 1, &tlasBuildInfo, &ptrRangeInfo);
 
+	if (serializationSizeQueryPool) {
+		vkCmdResetQueryPool(tlasBuildBuffer, serializationSizeQueryPool, 0, static_cast<uint32_t>(triangleBLASCount));
+
+		memoryBarrier.srcAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
+		memoryBarrier.dstAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR;
+		vkCmdPipelineBarrier(tlasBuildBuffer, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
+							 VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, 0, 1, &memoryBarrier, 0, nullptr,
+							 0, nullptr);
+
+		vkCmdWriteAccelerationStructuresPropertiesKHR(
+			tlasBuildBuffer, static_cast<uint32_t>(m_triangleBLASes.size()), m_triangleBLASes.data(),
+			VK_QUERY_TYPE_ACCELERATION_STRUCTURE_SERIALIZATION_SIZE_KHR, serializationSizeQueryPool, 0);
+	}
+
 	verifyResult(vkEndCommandBuffer(tlasBuildBuffer));
 
 	m_dispatcher.submit(tlasBuildBuffer, {});
 	m_dispatcher.waitForFence(tlasBuildBuffer, UINT64_MAX);
 
+	if (restoreBLASes) {
+		printf("Restored %zu BLASes from %s\n", blasCache.structureCount(),
+			   accelerationStructureCachePath(cacheKey).c_str());
+		vkDestroyBuffer(m_device.device(), serializedBLASBuffer, nullptr);
+		vkDestroyBuffer(m_device.device(), serializedBLASStagingBuffer, nullptr);
+	}
+	if (serializationSizeQueryPool) {
+		writeBLASCache(serializationSizeQueryPool, compactedASSizes, cacheKey);
+		vkDestroyQueryPool(m_device.device(), serializationSizeQueryPool, nullptr);
+	}
+
 	vkDestroyBuffer(m_device.device(), triangleTransformBuffer, nullptr);
 	vkDestroyBuffer(m_device.device(), triangleTransformStagingBuffer, nullptr);
 
-	for (auto& structure : uncompactedBLASes) {
-		vkDestroyAccelerationStructureKHR(m_device.device(), structure, nullptr);
-	}
-	for (auto& buffer : uncompactedASBackingBuffers) {
-		vkDestroyBuffer(m_device.device(), buffer, nullptr);
-	}
-	for (auto& buffer : triangleASBuildScratchBuffers) {
-		vkDestroyBuffer(m_device.device(), buffer, nullptr);
-	}
+	vkDestroyBuffer(m_device.device(), uncompactedArenaBuffer, nullptr);
+	vkDestroyBuffer(m_device.device(), scratchPoolBuffer, nullptr);
 	if (lightSpheres.size() > 0) {
 		vkDestroyBuffer(m_device.device(), sphereAABBBuffer, nullptr);
 		vkDestroyBuffer(m_device.device(), sphereAABBStagingBuffer, nullptr);
-		vkDestroyAccelerationStructureKHR(m_device.device(), sphereBLASData.accelerationStructure, nullptr);
-		vkDestroyBuffer(m_device.device(), sphereBLASData.backingBuffer, nullptr);
-		vkDestroyBuffer(m_device.device(), sphereBLASData.scratchBuffer, nullptr);
 	}
 
 	vkDestroyQueryPool(m_device.device(), compactionSizeQueryPool, nullptr);
 
-	vkDestroyBuffer(m_device.device(), instanceBuffer, nullptr);
-	vkDestroyBuffer(m_device.device(), instanceStagingBuffer, nullptr);
-	vkDestroyBuffer(m_device.device(), tlasData.scratchBuffer, nullptr);
 
 	if (lightSpheres.size() > 0)
 		vkDestroyBuffer(m_device.device(), lightDataStagingBuffer, nullptr);
@@ -522,6 +908,11 @@ AccelerationStructureBuilder::~AccelerationStructureBuilder() {
 
 	vkDestroyAccelerationStructureKHR(m_device.device(), m_tlas, nullptr);
 	vkDestroyBuffer(m_device.device(), m_tlasBackingBuffer, nullptr);
+	vkDestroyBuffer(m_device.device(), m_tlasScratchBuffer, nullptr);
+	vkDestroyBuffer(m_device.device(), m_instanceBuffer, nullptr);
+	for (auto& buffer : m_instanceStagingBuffers) {
+		vkDestroyBuffer(m_device.device(), buffer, nullptr);
+	}
 
 	if (m_sphereBLAS) {
 		vkDestroyBuffer(m_device.device(), m_lightDataBuffer, nullptr);
@@ -537,6 +928,232 @@ AccelerationStructureBuilder::~AccelerationStructureBuilder() {
 	}
 }
 
+void AccelerationStructureBuilder::setInstanceTransform(size_t instanceIndex, const VkTransformMatrixKHR& transform) {
+	m_tlasInstances[instanceIndex].transform = transform;
+	m_instancesChanged = true;
+}
+
+void AccelerationStructureBuilder::setInstanceMask(size_t instanceIndex, uint8_t mask) {
+	m_tlasInstances[instanceIndex].mask = mask;
+	m_instancesChanged = true;
+}
+
+void AccelerationStructureBuilder::setLightSphere(size_t sphereIndex, const Sphere& sphere) {
+	m_lightSpheres[sphereIndex] = sphere;
+	setInstanceTransform(sphereIndex, sphereTransform(sphere));
+}
+
+bool AccelerationStructureBuilder::updateTLAS(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
+	if (!m_instancesChanged)
+		return false;
+	m_instancesChanged = false;
+
+	// the frame's fence was waited on, so nothing reads its staging buffer anymore
+	uint8_t* mappedStagingBuffer = static_cast<uint8_t*>(m_mappedInstanceStagingBuffers[frameIndex]);
+	std::memcpy(mappedStagingBuffer, m_tlasInstances.data(), m_instanceDataSize);
+	if (m_lightDataBufferSize)
+		std::memcpy(mappedStagingBuffer + m_instanceDataSize, m_lightSpheres.data(), m_lightDataBufferSize);
+
+	// the frames before this one may still trace the TLAS and read the light data, or update the TLAS themselves
+	VkMemoryBarrier barrier = { .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+								.srcAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR,
+								.dstAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR |
+												 VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR };
+	vkCmdPipelineBarrier(commandBuffer,
+						 VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR |
+							 VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
+						 VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, 0, 1,
+						 &barrier, 0, nullptr, 0, nullptr);
+
+	VkBufferCopy bufferCopy = { .size = m_instanceDataSize };
+	vkCmdCopyBuffer(commandBuffer, m_instanceStagingBuffers[frameIndex], m_instanceBuffer, 1, &bufferCopy);
+	if (m_lightDataBufferSize) {
+		bufferCopy = { .srcOffset = m_instanceDataSize, .size = m_lightDataBufferSize };
+		vkCmdCopyBuffer(commandBuffer, m_instanceStagingBuffers[frameIndex], m_lightDataBuffer, 1, &bufferCopy);
+	}
+
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+						 VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, 0, 1, &barrier, 0, nullptr, 0,
+						 nullptr);
+
+	// A refit keeps the hierarchy of the last build and only recomputes its bounds, which overlap more the further the
+	// instances moved since then. Rebuilding every few updates bounds how much tracing slows down.
+	bool rebuild = m_tlasUpdateCount == tlasUpdatesBeforeRebuild;
+	m_tlasUpdateCount = rebuild ? 0 : m_tlasUpdateCount + 1;
+	++(rebuild ? m_tlasRebuildCount : m_tlasRefitCount);
+
+	VkAccelerationStructureGeometryKHR tlasGeometry = {
+		.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR,
+		.geometryType = VK_GEOMETRY_TYPE_INSTANCES_KHR,
+		.geometry = { .instances = { .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_INSTANCES_DATA_KHR,
+									 .arrayOfPointers = VK_FALSE,
+									 .data = m_instanceBufferDeviceAddress } }
+	};
+	VkAccelerationStructureBuildGeometryInfoKHR tlasBuildInfo = {
+		.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR,
+		.type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR,
+		.flags = tlasBuildFlags,
+		.mode =
+			rebuild ? VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR : VK_BUILD_ACCELERATION_STRUCTURE_MODE_UPDATE_KHR,
+		.srcAccelerationStructure = rebuild ? VK_NULL_HANDLE : m_tlas,
+		.dstAccelerationStructure = m_tlas,
+		.geometryCount = 1,
+		.pGeometries = &tlasGeometry,
+		.scratchData = { .deviceAddress = m_tlasScratchBufferDeviceAddress }
+	};
+	VkAccelerationStructureBuildRangeInfoKHR rangeInfo = { .primitiveCount =
+															   static_cast<uint32_t>(m_tlasInstances.size()) };
+	VkAccelerationStructureBuildRangeInfoKHR* ptrRangeInfo = &rangeInfo;
+	vkCmdBuildAccelerationStructuresKHR(commandBuffer, 1, &tlasBuildInfo, &ptrRangeInfo);
+
+	barrier.srcAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR | VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR | VK_ACCESS_SHADER_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer,
+						 VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR | VK_PIPELINE_STAGE_TRANSFER_BIT,
+						 VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+	return true;
+}
+
+void* AccelerationStructureBuilder::createSerializationBuffers(VkDeviceSize size, VkBuffer& buffer,
+															 VkDeviceAddress& bufferDeviceAddress,
+															 VkBuffer& stagingBuffer) {
+	VkBufferCreateInfo bufferCreateInfo = { .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+											.size = size,
+											.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+													 VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+													 VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT };
+	verifyResult(vkCreateBuffer(m_device.device(), &bufferCreateInfo, nullptr, &buffer));
+	m_allocator.bindDeviceBuffer(buffer, serializedAccelerationStructureAlignment);
+
+	bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	verifyResult(vkCreateBuffer(m_device.device(), &bufferCreateInfo, nullptr, &stagingBuffer));
+
+	setObjectName(m_device.device(), VK_OBJECT_TYPE_BUFFER, buffer, "Serialized BLAS buffer");
+	setObjectName(m_device.device(), VK_OBJECT_TYPE_BUFFER, stagingBuffer, "Serialized BLAS staging buffer");
+
+	VkBufferDeviceAddressInfo deviceAddressInfo = { .sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO,
+													.buffer = buffer };
+	bufferDeviceAddress = vkGetBufferDeviceAddress(m_device.device(), &deviceAddressInfo);
+	return m_allocator.bindStagingBuffer(stagingBuffer, 0);
+}
+
+void AccelerationStructureBuilder::writeBLASCache(VkQueryPool serializationSizeQueryPool,
+												  const std::vector<uint32_t>& compactedSizes, uint64_t cacheKey) {
+	std::vector<VkDeviceSize> serializedSizes = std::vector<VkDeviceSize>(m_triangleBLASes.size());
+	verifyResult(vkGetQueryPoolResults(m_device.device(), serializationSizeQueryPool, 0, m_triangleBLASes.size(),
+									   serializedSizes.size() * sizeof(VkDeviceSize), serializedSizes.data(),
+									   sizeof(VkDeviceSize), VK_QUERY_RESULT_64_BIT));
+
+	std::vector<CachedAccelerationStructure> structures;
+	structures.reserve(m_triangleBLASes.size());
+	uint64_t dataSize = 0;
+	for (size_t i = 0; i < m_triangleBLASes.size(); ++i) {
+		structures.push_back(
+			{ .dataOffset = dataSize, .serializedSize = serializedSizes[i], .structureSize = compactedSizes[i] });
+		dataSize += (serializedSizes[i] + serializedAccelerationStructureAlignment - 1) &
+					~(serializedAccelerationStructureAlignment - 1);
+	}
+
+	VkBuffer serializedBLASBuffer;
+	VkBuffer serializedBLASStagingBuffer;
+	VkDeviceAddress serializedBLASBufferDeviceAddress;
+	void* mappedSerializedBLASStagingBuffer = createSerializationBuffers(
+		dataSize, serializedBLASBuffer, serializedBLASBufferDeviceAddress, serializedBLASStagingBuffer);
+
+	VkCommandBuffer serializeBuffer = m_dispatcher.allocateOneTimeSubmitBuffers(1)[0];
+	VkCommandBufferBeginInfo beginInfo = { .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+										   .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT };
+	verifyResult(vkBeginCommandBuffer(serializeBuffer, &beginInfo));
+
+	for (size_t i = 0; i < m_triangleBLASes.size(); ++i) {
+		VkCopyAccelerationStructureToMemoryInfoKHR copy = {
+			.sType = VK_STRUCTURE_TYPE_COPY_ACCELERATION_STRUCTURE_TO_MEMORY_INFO_KHR,
+			.src = m_triangleBLASes[i],
+			.dst = { .deviceAddress = serializedBLASBufferDeviceAddress + structures[i].dataOffset },
+			.mode = VK_COPY_ACCELERATION_STRUCTURE_MODE_SERIALIZE_KHR
+		};
+		vkCmdCopyAccelerationStructureToMemoryKHR(serializeBuffer, &copy);
+	}
+
+	VkMemoryBarrier barrier = { .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+								.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+								.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT };
+	vkCmdPipelineBarrier(serializeBuffer, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
+						 VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+	VkBufferCopy bufferCopy = { .size = dataSize };
+	vkCmdCopyBuffer(serializeBuffer, serializedBLASBuffer, serializedBLASStagingBuffer, 1, &bufferCopy);
+
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	vkCmdPipelineBarrier(serializeBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier,
+						 0, nullptr, 0, nullptr);
+
+	verifyResult(vkEndCommandBuffer(serializeBuffer));
+
+	m_dispatcher.submit(serializeBuffer, {});
+	m_dispatcher.waitForFence(serializeBuffer, UINT64_MAX);
+
+	std::string path = accelerationStructureCachePath(cacheKey);
+	if (writeAccelerationStructureCache(path, cacheKey, structures, mappedSerializedBLASStagingBuffer, dataSize)) {
+		printf("Wrote BLAS cache %s\n", path.c_str());
+	} else {
+		printf("Failed to write BLAS cache %s\n", path.c_str());
+	}
+
+	vkDestroyBuffer(m_device.device(), serializedBLASBuffer, nullptr);
+	vkDestroyBuffer(m_device.device(), serializedBLASStagingBuffer, nullptr);
+}
+
+std::vector<GeometryPartition> AccelerationStructureBuilder::partitionGeometriesInGrid(
+	const std::vector<PartitionItem>& items, const AABB& modelBounds) {
+	std::vector<AABB> asAABBs;
+	asAABBs.reserve(numASSubdivisions);
+
+	size_t numASesPerDimension = static_cast<size_t>(cbrtf(numASSubdivisions));
+
+	float aabbChunkLength[3] = { (modelBounds.xmax - modelBounds.xmin) / numASesPerDimension,
+								 (modelBounds.ymax - modelBounds.ymin) / numASesPerDimension,
+								 (modelBounds.zmax - modelBounds.zmin) / numASesPerDimension };
+
+	for (size_t i = 0; i < numASesPerDimension; ++i) {
+		for (size_t j = 0; j < numASesPerDimension; ++j) {
+			for (size_t k = 0; k < numASesPerDimension; ++k) {
+				asAABBs.push_back({ .xmin = modelBounds.xmin + k * aabbChunkLength[0],
+									.ymin = modelBounds.ymin + j * aabbChunkLength[1],
+									.zmin = modelBounds.zmin + i * aabbChunkLength[2],
+									.xmax = modelBounds.xmin + (k + 1) * aabbChunkLength[0],
+									.ymax = modelBounds.ymin + (j + 1) * aabbChunkLength[1],
+									.zmax = modelBounds.zmin + (i + 1) * aabbChunkLength[2] });
+			}
+		}
+	}
+
+#ifdef AS_HEURISTIC_GEOMETRY_INTERSECTION
+	for (auto& item : items) {
+		bestAccelerationStructureIndex(asAABBs, modelBounds, item.bounds);
+	}
+#endif
+
+	std::vector<GeometryPartition> cells = std::vector<GeometryPartition>(numASSubdivisions);
+	for (size_t i = 0; i < items.size(); ++i) {
+		GeometryPartition& cell = cells[bestAccelerationStructureIndex(asAABBs, modelBounds, items[i].bounds, false)];
+		cell.bounds = cell.itemIndices.empty() ? items[i].bounds
+											   : AABB{ .xmin = std::min(cell.bounds.xmin, items[i].bounds.xmin),
+													   .ymin = std::min(cell.bounds.ymin, items[i].bounds.ymin),
+													   .zmin = std::min(cell.bounds.zmin, items[i].bounds.zmin),
+													   .xmax = std::max(cell.bounds.xmax, items[i].bounds.xmax),
+													   .ymax = std::max(cell.bounds.ymax, items[i].bounds.ymax),
+													   .zmax = std::max(cell.bounds.zmax, items[i].bounds.zmax) };
+		cell.itemIndices.push_back(i);
+		cell.triangleCount += items[i].triangleCount;
+	}
+	std::erase_if(cells, [](const GeometryPartition& cell) { return cell.itemIndices.empty(); });
+	return cells;
+}
+
 size_t AccelerationStructureBuilder::bestAccelerationStructureIndex(std::vector<AABB>& asBoundingBoxes,
 																	const AABB& modelBounds,
 																	const AABB& geometryBoundingBox,
@@ -632,11 +1249,7 @@ AccelerationStructureData AccelerationStructureBuilder::createAccelerationStruct
 	uint32_t scratchBufferAlignment, bool topLevel) {
 	AccelerationStructureData result = {};
 
-	VkAccelerationStructureBuildSizesInfoKHR sizeInfo = {
-		.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR
-	};
-	vkGetAccelerationStructureBuildSizesKHR(m_device.device(), VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR,
-											&buildInfo, maxPrimitiveCounts.data(), &sizeInfo);
+	VkAccelerationStructureBuildSizesInfoKHR sizeInfo = accelerationStructureBuildSizes(buildInfo, maxPrimitiveCounts);
 
 	VkBufferCreateInfo accelerationStructureStorageCreateInfo = {
 		.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
@@ -657,7 +1270,8 @@ AccelerationStructureData AccelerationStructureBuilder::createAccelerationStruct
 	verifyResult(vkCreateAccelerationStructureKHR(m_device.device(), &accelerationStructureCreateInfo, nullptr,
 												  &result.accelerationStructure));
 
-	accelerationStructureStorageCreateInfo.size = sizeInfo.buildScratchSize;
+	// the TLAS is updated with the same scratch buffer later on
+	accelerationStructureStorageCreateInfo.size = std::max(sizeInfo.buildScratchSize, sizeInfo.updateScratchSize);
 	accelerationStructureStorageCreateInfo.usage =
 		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
 	verifyResult(
@@ -671,6 +1285,32 @@ AccelerationStructureData AccelerationStructureBuilder::createAccelerationStruct
 	return result;
 }
 
+VkAccelerationStructureBuildSizesInfoKHR AccelerationStructureBuilder::accelerationStructureBuildSizes(
+	const VkAccelerationStructureBuildGeometryInfoKHR& buildInfo, const std::vector<uint32_t>& maxPrimitiveCounts) {
+	VkAccelerationStructureBuildSizesInfoKHR sizeInfo = {
+		.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR
+	};
+	vkGetAccelerationStructureBuildSizesKHR(m_device.device(), VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR,
+											&buildInfo, maxPrimitiveCounts.data(), &sizeInfo);
+	return sizeInfo;
+}
+
+VkAccelerationStructureKHR AccelerationStructureBuilder::createAccelerationStructure(VkBuffer buffer,
+																					 VkDeviceSize offset,
+																					 VkDeviceSize size) {
+	VkAccelerationStructureCreateInfoKHR accelerationStructureCreateInfo = {
+		.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR,
+		.buffer = buffer,
+		.offset = offset,
+		.size = size,
+		.type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR
+	};
+	VkAccelerationStructureKHR accelerationStructure;
+	verifyResult(vkCreateAccelerationStructureKHR(m_device.device(), &accelerationStructureCreateInfo, nullptr,
+												  &accelerationStructure));
+	return accelerationStructure;
+}
+
 AccelerationStructureData AccelerationStructureBuilder::createAccelerationStructure(uint32_t compactedSize) {
 	AccelerationStructureData result = {};
 	VkBufferCreateInfo accelerationStructureStorageCreateInfo = {
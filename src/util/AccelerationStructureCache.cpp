@@ -0,0 +1,81 @@
+#include <Config.hpp>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <util/AccelerationStructureCache.hpp>
+#include <volk.h>
+
+static constexpr uint32_t accelerationStructureCacheMagic = 0x41524B56; // "VKRA"
+
+std::string accelerationStructureCachePath(uint64_t cacheKey) {
+	char filename[32];
+	snprintf(filename, sizeof(filename), "%016llx.blas", static_cast<unsigned long long>(cacheKey));
+	return (std::filesystem::path(sceneCacheDirectory) / filename).string();
+}
+
+bool writeAccelerationStructureCache(const std::string& path, uint64_t cacheKey,
+									 const std::vector<CachedAccelerationStructure>& structures, const void* data,
+									 uint64_t dataSize) {
+	std::error_code error;
+	std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+
+	std::string temporaryPath = path + ".tmp";
+	FILE* file = fopen(temporaryPath.c_str(), "wb");
+	if (!file)
+		return false;
+
+	AccelerationStructureCacheHeader header = { .magic = accelerationStructureCacheMagic,
+												.version = accelerationStructureCacheVersion,
+												.cacheKey = cacheKey,
+												.structureCount = structures.size(),
+												.dataSize = dataSize };
+	bool failed = fwrite(&header, sizeof(AccelerationStructureCacheHeader), 1, file) != 1;
+	if (!structures.empty())
+		failed |= fwrite(structures.data(), sizeof(CachedAccelerationStructure) * structures.size(), 1, file) != 1;
+	if (dataSize)
+		failed |= fwrite(data, dataSize, 1, file) != 1;
+	failed |= fclose(file) != 0;
+
+	if (!failed) {
+		std::filesystem::rename(temporaryPath, path, error);
+		failed = static_cast<bool>(error);
+	}
+	if (failed)
+		std::remove(temporaryPath.c_str());
+	return !failed;
+}
+
+bool AccelerationStructureCacheReader::open(const std::string& path, uint64_t cacheKey) {
+	if (!m_file.open(path.c_str()) || m_file.size() < sizeof(AccelerationStructureCacheHeader))
+		return false;
+
+	AccelerationStructureCacheHeader header;
+	std::memcpy(&header, m_file.data(), sizeof(AccelerationStructureCacheHeader));
+	uint64_t structureTableSize = header.structureCount * sizeof(CachedAccelerationStructure);
+	uint64_t fileSize = m_file.size() - sizeof(AccelerationStructureCacheHeader);
+	if (header.magic != accelerationStructureCacheMagic || header.version != accelerationStructureCacheVersion ||
+		header.cacheKey != cacheKey || header.structureCount > fileSize / sizeof(CachedAccelerationStructure) ||
+		header.dataSize != fileSize - structureTableSize) {
+		m_file.close();
+		return false;
+	}
+
+	m_structures.resize(header.structureCount);
+	std::memcpy(m_structures.data(), m_file.data() + sizeof(AccelerationStructureCacheHeader), structureTableSize);
+	m_data = m_file.data() + sizeof(AccelerationStructureCacheHeader) + structureTableSize;
+	m_dataSize = header.dataSize;
+
+	// every structure needs to hold at least the version data that is checked before anything is deserialized
+	for (auto& structure : m_structures) {
+		if (structure.dataOffset % serializedAccelerationStructureAlignment || structure.dataOffset > m_dataSize ||
+			structure.serializedSize > m_dataSize - structure.dataOffset ||
+			structure.serializedSize < 2 * VK_UUID_SIZE) {
+			m_file.close();
+			m_structures.clear();
+			m_data = nullptr;
+			m_dataSize = 0;
+			return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,61 @@
+#include <algorithm>
+#include <bit>
+#include <util/AccessorOffsetMap.hpp>
+
+AccessorOffsetMap::AccessorOffsetMap(size_t initialCapacity) {
+	m_capacityLog2 = std::bit_width(std::bit_ceil(std::max(initialCapacity, size_t(16)))) - 1;
+	m_entries.resize(size_t(1) << m_capacityLog2);
+}
+
+const size_t* AccessorOffsetMap::find(const cgltf_accessor* accessor, AccessorUsage usage) const {
+	size_t mask = m_entries.size() - 1;
+	for (size_t index = slotIndex(accessor, usage);; index = (index + 1) & mask) {
+		const Entry& entry = m_entries[index];
+		if (!entry.accessor)
+			return nullptr;
+		if (entry.accessor == accessor && entry.usage == usage)
+			return &entry.offset;
+	}
+}
+
+bool AccessorOffsetMap::insert(const cgltf_accessor* accessor, AccessorUsage usage, size_t offset) {
+	// keep the load factor below 1/2, probe sequences stay short and there is always an empty slot
+	if ((m_entryCount + 1) * 2 > m_entries.size())
+		grow();
+
+	size_t mask = m_entries.size() - 1;
+	for (size_t index = slotIndex(accessor, usage);; index = (index + 1) & mask) {
+		Entry& entry = m_entries[index];
+		if (!entry.accessor) {
+			entry = { .accessor = accessor, .usage = usage, .offset = offset };
+			++m_entryCount;
+			return true;
+		}
+		if (entry.accessor == accessor && entry.usage == usage)
+			return false;
+	}
+}
+
+void AccessorOffsetMap::clear() {
+	std::fill(m_entries.begin(), m_entries.end(), Entry{});
+	m_entryCount = 0;
+}
+
+size_t AccessorOffsetMap::slotIndex(const cgltf_accessor* accessor, AccessorUsage usage) const {
+	// fibonacci hashing, the top bits of the product are the best mixed ones
+	uint64_t key = reinterpret_cast<uintptr_t>(accessor) ^ static_cast<uint64_t>(usage);
+	return static_cast<size_t>((key * 0x9E3779B97F4A7C15ULL) >> (64 - m_capacityLog2));
+}
+
+void AccessorOffsetMap::grow() {
+	std::vector<Entry> oldEntries = std::move(m_entries);
+
+	++m_capacityLog2;
+	m_entries = std::vector<Entry>(size_t(1) << m_capacityLog2);
+	m_entryCount = 0;
+
+	for (auto& entry : oldEntries) {
+		if (entry.accessor)
+			insert(entry.accessor, entry.usage, entry.offset);
+	}
+}
@@ -0,0 +1,314 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <util/AccessorUnpacking.hpp>
+#include <vector>
+#if defined(__SSE2__) || defined(_M_X64)
+#define ACCESSOR_UNPACKING_SSE2
+#include <emmintrin.h>
+#endif
+
+static size_t componentSize(cgltf_component_type type) {
+	switch (type) {
+		case cgltf_component_type_r_8:
+		case cgltf_component_type_r_8u:
+			return 1;
+		case cgltf_component_type_r_16:
+		case cgltf_component_type_r_16u:
+			return 2;
+		default:
+			return 4;
+	}
+}
+
+static const uint8_t* bufferViewData(const cgltf_buffer_view* view) {
+	return reinterpret_cast<const uint8_t*>(view->buffer->data) + view->offset;
+}
+
+static bool isSignedComponent(cgltf_component_type type) {
+	return type == cgltf_component_type_r_8 || type == cgltf_component_type_r_16;
+}
+
+// normalized integers are mapped to [0, 1] or [-1, 1], the most negative signed value is clamped to -1 (glTF spec 3.11)
+static float componentScale(cgltf_component_type type, bool normalized) {
+	if (!normalized)
+		return 1.0f;
+	switch (type) {
+		case cgltf_component_type_r_8:
+			return 1.0f / 127.0f;
+		case cgltf_component_type_r_8u:
+			return 1.0f / 255.0f;
+		case cgltf_component_type_r_16:
+			return 1.0f / 32767.0f;
+		case cgltf_component_type_r_16u:
+			return 1.0f / 65535.0f;
+		default:
+			return 1.0f;
+	}
+}
+
+static float componentMinValue(cgltf_component_type type, bool normalized) {
+	return normalized && isSignedComponent(type) ? -1.0f : -std::numeric_limits<float>::infinity();
+}
+
+static void unpackStridedFloats(const uint8_t* src, size_t stride, size_t count, size_t componentCount, float* dst) {
+	size_t i = 0;
+#ifdef ACCESSOR_UNPACKING_SSE2
+	switch (componentCount) {
+		case 2:
+			for (; i + 2 <= count; i += 2) {
+				// 8 byte loads without alignment requirements
+				__m128 first = _mm_castsi128_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i * stride)));
+				__m128 second =
+					_mm_castsi128_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + (i + 1) * stride)));
+				_mm_storeu_ps(dst + i * 2, _mm_movelh_ps(first, second));
+			}
+			break;
+		case 3:
+			// Four elements are shuffled into three full vectors. The 16 byte loads read one float past each element,
+			// which stays inside the buffer for every element except the last one, that is left to the scalar loop.
+			for (; i + 4 < count; i += 4) {
+				__m128 a = _mm_loadu_ps(reinterpret_cast<const float*>(src + i * stride));
+				__m128 b = _mm_loadu_ps(reinterpret_cast<const float*>(src + (i + 1) * stride));
+				__m128 c = _mm_loadu_ps(reinterpret_cast<const float*>(src + (i + 2) * stride));
+				__m128 d = _mm_loadu_ps(reinterpret_cast<const float*>(src + (i + 3) * stride));
+				__m128 a2b0 = _mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 2, 2));
+				__m128 c2d0 = _mm_shuffle_ps(c, d, _MM_SHUFFLE(0, 0, 2, 2));
+				_mm_storeu_ps(dst + i * 3, _mm_shuffle_ps(a, a2b0, _MM_SHUFFLE(2, 0, 1, 0)));
+				_mm_storeu_ps(dst + i * 3 + 4, _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 0, 2, 1)));
+				_mm_storeu_ps(dst + i * 3 + 8, _mm_shuffle_ps(c2d0, d, _MM_SHUFFLE(2, 1, 2, 0)));
+			}
+			break;
+		case 4:
+			for (; i < count; ++i) {
+				_mm_storeu_ps(dst + i * 4, _mm_loadu_ps(reinterpret_cast<const float*>(src + i * stride)));
+			}
+			break;
+		default:
+			break;
+	}
+#endif
+	for (; i < count; ++i) {
+		std::memcpy(dst + i * componentCount, src + i * stride, componentCount * sizeof(float));
+	}
+}
+
+template <typename T>
+static void unpackIntegerComponents(const uint8_t* src, size_t stride, size_t count, size_t componentCount,
+									float scale, float minValue, float* dst) {
+	for (size_t i = 0; i < count; ++i) {
+		for (size_t j = 0; j < componentCount; ++j) {
+			T value;
+			std::memcpy(&value, src + i * stride + j * sizeof(T), sizeof(T));
+			dst[i * componentCount + j] = std::max(static_cast<float>(value) * scale, minValue);
+		}
+	}
+}
+
+// two component 8 and 16 bit integers, mostly quantized texture coordinates
+template <typename T>
+static void unpackIntegerPairs(const uint8_t* src, size_t stride, size_t count, float scale, float minValue,
+							   float* dst) {
+	size_t i = 0;
+#ifdef ACCESSOR_UNPACKING_SSE2
+	constexpr int componentBits = sizeof(T) * 8;
+	constexpr bool isSigned = std::numeric_limits<T>::is_signed;
+	__m128 scaleVector = _mm_set1_ps(scale);
+	__m128 minVector = _mm_set1_ps(minValue);
+	for (; i + 4 <= count; i += 4) {
+		// one 32 bit lane per element holding both components
+		int32_t elements[4] = {};
+		for (size_t j = 0; j < 4; ++j) {
+			std::memcpy(&elements[j], src + (i + j) * stride, 2 * sizeof(T));
+		}
+		__m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i*>(elements));
+
+		__m128i x, y;
+		if constexpr (isSigned) {
+			x = _mm_srai_epi32(_mm_slli_epi32(packed, 32 - componentBits), 32 - componentBits);
+			y = _mm_srai_epi32(_mm_slli_epi32(packed, 32 - 2 * componentBits), 32 - componentBits);
+		} else {
+			__m128i mask = _mm_set1_epi32((1 << componentBits) - 1);
+			x = _mm_and_si128(packed, mask);
+			y = _mm_and_si128(_mm_srli_epi32(packed, componentBits), mask);
+		}
+		__m128 xFloat = _mm_max_ps(_mm_mul_ps(_mm_cvtepi32_ps(x), scaleVector), minVector);
+		__m128 yFloat = _mm_max_ps(_mm_mul_ps(_mm_cvtepi32_ps(y), scaleVector), minVector);
+		_mm_storeu_ps(dst + i * 2, _mm_unpacklo_ps(xFloat, yFloat));
+		_mm_storeu_ps(dst + i * 2 + 4, _mm_unpackhi_ps(xFloat, yFloat));
+	}
+#endif
+	unpackIntegerComponents<T>(src + i * stride, stride, count - i, 2, scale, minValue, dst + i * 2);
+}
+
+static void unpackComponents(const uint8_t* src, size_t stride, size_t count, size_t componentCount,
+							 cgltf_component_type type, bool normalized, float* dst) {
+	float scale = componentScale(type, normalized);
+	float minValue = componentMinValue(type, normalized);
+	switch (type) {
+		case cgltf_component_type_r_8:
+			if (componentCount == 2)
+				unpackIntegerPairs<int8_t>(src, stride, count, scale, minValue, dst);
+			else
+				unpackIntegerComponents<int8_t>(src, stride, count, componentCount, scale, minValue, dst);
+			break;
+		case cgltf_component_type_r_8u:
+			if (componentCount == 2)
+				unpackIntegerPairs<uint8_t>(src, stride, count, scale, minValue, dst);
+			else
+				unpackIntegerComponents<uint8_t>(src, stride, count, componentCount, scale, minValue, dst);
+			break;
+		case cgltf_component_type_r_16:
+			if (componentCount == 2)
+				unpackIntegerPairs<int16_t>(src, stride, count, scale, minValue, dst);
+			else
+				unpackIntegerComponents<int16_t>(src, stride, count, componentCount, scale, minValue, dst);
+			break;
+		case cgltf_component_type_r_16u:
+			if (componentCount == 2)
+				unpackIntegerPairs<uint16_t>(src, stride, count, scale, minValue, dst);
+			else
+				unpackIntegerComponents<uint16_t>(src, stride, count, componentCount, scale, minValue, dst);
+			break;
+		case cgltf_component_type_r_32u:
+			unpackIntegerComponents<uint32_t>(src, stride, count, componentCount, scale, minValue, dst);
+			break;
+		case cgltf_component_type_r_32f:
+			if (stride == componentCount * sizeof(float))
+				std::memcpy(dst, src, count * componentCount * sizeof(float));
+			else
+				unpackStridedFloats(src, stride, count, componentCount, dst);
+			break;
+		default:
+			std::fill_n(dst, count * componentCount, 0.0f);
+			break;
+	}
+}
+
+static size_t readSparseIndex(const uint8_t* indices, cgltf_component_type type, size_t index) {
+	switch (type) {
+		case cgltf_component_type_r_8u:
+			return indices[index];
+		case cgltf_component_type_r_16u: {
+			uint16_t value;
+			std::memcpy(&value, indices + index * sizeof(uint16_t), sizeof(uint16_t));
+			return value;
+		}
+		default: {
+			uint32_t value;
+			std::memcpy(&value, indices + index * sizeof(uint32_t), sizeof(uint32_t));
+			return value;
+		}
+	}
+}
+
+// Src and Dst are unsigned index types, the SIMD loops zero extend by interleaving with zeros
+template <typename Src, typename Dst>
+static void convertIndices(const uint8_t* src, size_t stride, size_t count, Dst* dst) {
+	if constexpr (sizeof(Src) == sizeof(Dst)) {
+		if (stride == sizeof(Src)) {
+			std::memcpy(dst, src, count * sizeof(Dst));
+			return;
+		}
+	}
+
+	size_t i = 0;
+#ifdef ACCESSOR_UNPACKING_SSE2
+	if (stride == sizeof(Src)) {
+		__m128i zero = _mm_setzero_si128();
+		if constexpr (sizeof(Src) == 1 && sizeof(Dst) == 4) {
+			for (; i + 16 <= count; i += 16) {
+				__m128i indices = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+				__m128i low = _mm_unpacklo_epi8(indices, zero);
+				__m128i high = _mm_unpackhi_epi8(indices, zero);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_unpacklo_epi16(low, zero));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 4), _mm_unpackhi_epi16(low, zero));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 8), _mm_unpacklo_epi16(high, zero));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 12), _mm_unpackhi_epi16(high, zero));
+			}
+		} else if constexpr (sizeof(Src) == 1 && sizeof(Dst) == 2) {
+			for (; i + 16 <= count; i += 16) {
+				__m128i indices = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_unpacklo_epi8(indices, zero));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 8), _mm_unpackhi_epi8(indices, zero));
+			}
+		} else if constexpr (sizeof(Src) == 2 && sizeof(Dst) == 4) {
+			for (; i + 8 <= count; i += 8) {
+				__m128i indices = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_unpacklo_epi16(indices, zero));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 4), _mm_unpackhi_epi16(indices, zero));
+			}
+		} else if constexpr (sizeof(Src) == 4 && sizeof(Dst) == 2) {
+			// SSE2 only has a signed saturating pack, sign extending the low halves first makes it exact
+			for (; i + 8 <= count; i += 8) {
+				__m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+				__m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4 + 16));
+				low = _mm_srai_epi32(_mm_slli_epi32(low, 16), 16);
+				high = _mm_srai_epi32(_mm_slli_epi32(high, 16), 16);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packs_epi32(low, high));
+			}
+		}
+	}
+#endif
+	for (; i < count; ++i) {
+		Src index;
+		std::memcpy(&index, src + i * stride, sizeof(Src));
+		dst[i] = static_cast<Dst>(index);
+	}
+}
+
+template <typename Dst>
+static void unpackIndices(const cgltf_accessor* accessor, Dst* dst) {
+	const uint8_t* src = bufferViewData(accessor->buffer_view) + accessor->offset;
+	switch (accessor->component_type) {
+		case cgltf_component_type_r_8u:
+			convertIndices<uint8_t>(src, accessor->stride, accessor->count, dst);
+			break;
+		case cgltf_component_type_r_16u:
+			convertIndices<uint16_t>(src, accessor->stride, accessor->count, dst);
+			break;
+		case cgltf_component_type_r_32u:
+			convertIndices<uint32_t>(src, accessor->stride, accessor->count, dst);
+			break;
+		default:
+			break;
+	}
+}
+
+bool isTightlyPackedFloatAccessor(const cgltf_accessor* accessor, size_t componentCount) {
+	return accessor->buffer_view && !accessor->is_sparse && accessor->component_type == cgltf_component_type_r_32f &&
+		   accessor->stride == componentCount * sizeof(float);
+}
+
+void unpackAccessorFloats(const cgltf_accessor* accessor, size_t componentCount, float* dst) {
+	if (accessor->buffer_view) {
+		unpackComponents(bufferViewData(accessor->buffer_view) + accessor->offset, accessor->stride, accessor->count,
+						 componentCount, accessor->component_type, accessor->normalized, dst);
+	} else {
+		// sparse accessors without a buffer view start out as zeros
+		std::fill_n(dst, accessor->count * componentCount, 0.0f);
+	}
+
+	if (!accessor->is_sparse)
+		return;
+
+	const cgltf_accessor_sparse& sparse = accessor->sparse;
+	const uint8_t* indices = bufferViewData(sparse.indices_buffer_view) + sparse.indices_byte_offset;
+	size_t valueStride = componentCount * componentSize(accessor->component_type);
+
+	std::vector<float> values(sparse.count * componentCount);
+	unpackComponents(bufferViewData(sparse.values_buffer_view) + sparse.values_byte_offset, valueStride, sparse.count,
+					 componentCount, accessor->component_type, accessor->normalized, values.data());
+
+	for (size_t i = 0; i < sparse.count; ++i) {
+		size_t index = readSparseIndex(indices, sparse.indices_component_type, i);
+		if (index >= accessor->count)
+			continue;
+		std::memcpy(dst + index * componentCount, values.data() + i * componentCount, componentCount * sizeof(float));
+	}
+}
+
+void unpackAccessorIndices(const cgltf_accessor* accessor, uint32_t* dst) { unpackIndices(accessor, dst); }
+
+void unpackAccessorShortIndices(const cgltf_accessor* accessor, uint16_t* dst) { unpackIndices(accessor, dst); }
@@ -0,0 +1,171 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <util/GeometryPartitioning.hpp>
+
+static AABB emptyBounds() {
+	constexpr float max = std::numeric_limits<float>::max();
+	return { .xmin = max, .ymin = max, .zmin = max, .xmax = -max, .ymax = -max, .zmax = -max };
+}
+
+static void growBounds(AABB& bounds, const AABB& other) {
+	bounds.xmin = std::min(bounds.xmin, other.xmin);
+	bounds.ymin = std::min(bounds.ymin, other.ymin);
+	bounds.zmin = std::min(bounds.zmin, other.zmin);
+	bounds.xmax = std::max(bounds.xmax, other.xmax);
+	bounds.ymax = std::max(bounds.ymax, other.ymax);
+	bounds.zmax = std::max(bounds.zmax, other.zmax);
+}
+
+static float surfaceArea(const AABB& bounds) {
+	if (bounds.xmax < bounds.xmin)
+		return 0.0f;
+	float width = bounds.xmax - bounds.xmin;
+	float height = bounds.ymax - bounds.ymin;
+	float depth = bounds.zmax - bounds.zmin;
+	return 2.0f * (width * height + height * depth + depth * width);
+}
+
+// cost of a ray that hits the BLAS bounds
+static float blasCost(size_t triangleCount, const PartitionCostModel& costModel) {
+	return costModel.blasEntryCost +
+		   costModel.blasNodeCost * std::log2(static_cast<float>(std::max(triangleCount, size_t{ 1 })));
+}
+
+float partitionTraversalCost(const std::vector<GeometryPartition>& partitions, const PartitionCostModel& costModel) {
+	if (partitions.empty())
+		return 0.0f;
+
+	AABB sceneBounds = emptyBounds();
+	for (auto& partition : partitions) {
+		growBounds(sceneBounds, partition.bounds);
+	}
+	float sceneArea = surfaceArea(sceneBounds);
+
+	float cost = costModel.tlasNodeCost * std::ceil(std::log2(static_cast<float>(partitions.size())));
+	for (auto& partition : partitions) {
+		float hitProbability = sceneArea > 0.0f ? surfaceArea(partition.bounds) / sceneArea : 1.0f;
+		cost += hitProbability * blasCost(partition.triangleCount, costModel);
+	}
+	return cost;
+}
+
+std::vector<GeometryPartition> partitionGeometries(const std::vector<PartitionItem>& items,
+												   const PartitionCostModel& costModel, size_t binCount) {
+	std::vector<GeometryPartition> partitions;
+
+	std::vector<std::array<float, 3>> centroids;
+	centroids.reserve(items.size());
+	for (auto& item : items) {
+		centroids.push_back({ (item.bounds.xmin + item.bounds.xmax) * 0.5f,
+							  (item.bounds.ymin + item.bounds.ymax) * 0.5f,
+							  (item.bounds.zmin + item.bounds.zmax) * 0.5f });
+	}
+
+	struct Bin {
+		AABB bounds;
+		size_t itemCount;
+		size_t triangleCount;
+	};
+	std::vector<Bin> bins = std::vector<Bin>(binCount);
+	// SAH cost of everything right of each split plane, without the division by the parent area
+	std::vector<float> rightCosts = std::vector<float>(binCount);
+
+	// every range of itemIndices is split further or becomes a partition
+	std::vector<size_t> itemIndices = std::vector<size_t>(items.size());
+	std::iota(itemIndices.begin(), itemIndices.end(), size_t{ 0 });
+	std::vector<std::pair<size_t, size_t>> ranges;
+	if (!items.empty())
+		ranges.push_back({ 0, items.size() });
+
+	while (!ranges.empty()) {
+		auto [rangeBegin, rangeEnd] = ranges.back();
+		ranges.pop_back();
+		size_t rangeSize = rangeEnd - rangeBegin;
+
+		AABB bounds = emptyBounds();
+		std::array<float, 3> centroidMin = { std::numeric_limits<float>::max(), std::numeric_limits<float>::max(),
+											 std::numeric_limits<float>::max() };
+		std::array<float, 3> centroidMax = { -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max(),
+											 -std::numeric_limits<float>::max() };
+		size_t triangleCount = 0;
+		for (size_t i = rangeBegin; i < rangeEnd; ++i) {
+			growBounds(bounds, items[itemIndices[i]].bounds);
+			triangleCount += items[itemIndices[i]].triangleCount;
+			for (size_t axis = 0; axis < 3; ++axis) {
+				centroidMin[axis] = std::min(centroidMin[axis], centroids[itemIndices[i]][axis]);
+				centroidMax[axis] = std::max(centroidMax[axis], centroids[itemIndices[i]][axis]);
+			}
+		}
+		float area = surfaceArea(bounds);
+
+		auto binIndex = [&](size_t itemIndex, size_t axis) {
+			float binScale = static_cast<float>(binCount) / (centroidMax[axis] - centroidMin[axis]);
+			size_t index = static_cast<size_t>((centroids[itemIndex][axis] - centroidMin[axis]) * binScale);
+			return std::min(index, binCount - 1);
+		};
+
+		float bestCost = blasCost(triangleCount, costModel);
+		size_t bestAxis = 3;
+		size_t bestSplit = 0;
+		for (size_t axis = 0; rangeSize > 1 && area > 0.0f && axis < 3; ++axis) {
+			if (!(centroidMax[axis] > centroidMin[axis]))
+				continue;
+
+			std::fill(bins.begin(), bins.end(), Bin{ .bounds = emptyBounds(), .itemCount = 0, .triangleCount = 0 });
+			for (size_t i = rangeBegin; i < rangeEnd; ++i) {
+				Bin& bin = bins[binIndex(itemIndices[i], axis)];
+				growBounds(bin.bounds, items[itemIndices[i]].bounds);
+				++bin.itemCount;
+				bin.triangleCount += items[itemIndices[i]].triangleCount;
+			}
+
+			// split plane b lies between bins b - 1 and b
+			AABB rightBounds = emptyBounds();
+			size_t rightTriangleCount = 0;
+			for (size_t b = binCount - 1; b > 0; --b) {
+				growBounds(rightBounds, bins[b].bounds);
+				rightTriangleCount += bins[b].triangleCount;
+				rightCosts[b] = surfaceArea(rightBounds) * blasCost(rightTriangleCount, costModel);
+			}
+
+			AABB leftBounds = emptyBounds();
+			size_t leftItemCount = 0;
+			size_t leftTriangleCount = 0;
+			for (size_t b = 1; b < binCount; ++b) {
+				growBounds(leftBounds, bins[b - 1].bounds);
+				leftItemCount += bins[b - 1].itemCount;
+				leftTriangleCount += bins[b - 1].triangleCount;
+				if (!leftItemCount || leftItemCount == rangeSize)
+					continue;
+
+				float cost = costModel.tlasNodeCost +
+							 (surfaceArea(leftBounds) * blasCost(leftTriangleCount, costModel) + rightCosts[b]) / area;
+				if (cost < bestCost) {
+					bestCost = cost;
+					bestAxis = axis;
+					bestSplit = b;
+				}
+			}
+		}
+
+		if (bestAxis == 3) {
+			GeometryPartition& partition = partitions.emplace_back();
+			partition.itemIndices.assign(itemIndices.begin() + rangeBegin, itemIndices.begin() + rangeEnd);
+			// keep the geometries in scene order inside the BLAS
+			std::sort(partition.itemIndices.begin(), partition.itemIndices.end());
+			partition.bounds = bounds;
+			partition.triangleCount = triangleCount;
+			continue;
+		}
+
+		auto rangeMiddle = std::partition(itemIndices.begin() + rangeBegin, itemIndices.begin() + rangeEnd,
+										  [&](size_t itemIndex) { return binIndex(itemIndex, bestAxis) < bestSplit; });
+		size_t middle = rangeMiddle - itemIndices.begin();
+		ranges.push_back({ middle, rangeEnd });
+		ranges.push_back({ rangeBegin, middle });
+	}
+	return partitions;
+}
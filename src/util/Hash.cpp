@@ -0,0 +1,83 @@
+#include <cstring>
+#include <util/Hash.hpp>
+
+// https://github.com/Cyan4973/xxHash/blob/dev/doc/xxhash_spec.md
+
+static constexpr uint64_t prime1 = 0x9E3779B185EBCA87ULL;
+static constexpr uint64_t prime2 = 0xC2B2AE3D27D4EB4FULL;
+static constexpr uint64_t prime3 = 0x165667B19E3779F9ULL;
+static constexpr uint64_t prime4 = 0x85EBCA77C2B2AE63ULL;
+static constexpr uint64_t prime5 = 0x27D4EB2F165667C5ULL;
+
+static inline uint64_t rotateLeft(uint64_t value, int bits) { return (value << bits) | (value >> (64 - bits)); }
+
+static inline uint64_t read64(const uint8_t* data) {
+	uint64_t value;
+	std::memcpy(&value, data, sizeof(uint64_t));
+	return value;
+}
+
+static inline uint32_t read32(const uint8_t* data) {
+	uint32_t value;
+	std::memcpy(&value, data, sizeof(uint32_t));
+	return value;
+}
+
+static inline uint64_t accumulateRound(uint64_t accumulator, uint64_t input) {
+	accumulator += input * prime2;
+	accumulator = rotateLeft(accumulator, 31);
+	return accumulator * prime1;
+}
+
+static inline uint64_t mergeRound(uint64_t accumulator, uint64_t value) {
+	accumulator ^= accumulateRound(0, value);
+	return accumulator * prime1 + prime4;
+}
+
+uint64_t hashData(const void* data, size_t size, uint64_t seed) {
+	const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+	const uint8_t* end = bytes + size;
+	uint64_t hash;
+
+	if (size >= 32) {
+		uint64_t accumulators[4] = { seed + prime1 + prime2, seed + prime2, seed, seed - prime1 };
+		const uint8_t* stripeEnd = end - 32;
+		do {
+			for (int i = 0; i < 4; ++i) {
+				accumulators[i] = accumulateRound(accumulators[i], read64(bytes + i * 8));
+			}
+			bytes += 32;
+		} while (bytes <= stripeEnd);
+
+		hash = rotateLeft(accumulators[0], 1) + rotateLeft(accumulators[1], 7) + rotateLeft(accumulators[2], 12) +
+			   rotateLeft(accumulators[3], 18);
+		for (int i = 0; i < 4; ++i) {
+			hash = mergeRound(hash, accumulators[i]);
+		}
+	} else {
+		hash = seed + prime5;
+	}
+
+	hash += static_cast<uint64_t>(size);
+
+	for (; bytes + 8 <= end; bytes += 8) {
+		hash ^= accumulateRound(0, read64(bytes));
+		hash = rotateLeft(hash, 27) * prime1 + prime4;
+	}
+	if (bytes + 4 <= end) {
+		hash ^= static_cast<uint64_t>(read32(bytes)) * prime1;
+		hash = rotateLeft(hash, 23) * prime2 + prime3;
+		bytes += 4;
+	}
+	for (; bytes < end; ++bytes) {
+		hash ^= static_cast<uint64_t>(*bytes) * prime5;
+		hash = rotateLeft(hash, 11) * prime1;
+	}
+
+	hash ^= hash >> 33;
+	hash *= prime2;
+	hash ^= hash >> 29;
+	hash *= prime3;
+	hash ^= hash >> 32;
+	return hash;
+}
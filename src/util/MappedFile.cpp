@@ -0,0 +1,62 @@
+#include <util/MappedFile.hpp>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#endif
+
+MappedFile::~MappedFile() { close(); }
+
+bool MappedFile::open(const char* path) {
+	close();
+#ifdef __linux__
+	int fileDescriptor = ::open(path, O_RDONLY | O_CLOEXEC);
+	if (fileDescriptor == -1)
+		return false;
+
+	struct stat fileStatus;
+	if (fstat(fileDescriptor, &fileStatus) == -1 || fileStatus.st_size == 0) {
+		::close(fileDescriptor);
+		return false;
+	}
+
+	void* mappedData =
+		mmap(nullptr, static_cast<size_t>(fileStatus.st_size), PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+	::close(fileDescriptor);
+	if (mappedData == MAP_FAILED)
+		return false;
+
+	m_data = reinterpret_cast<const uint8_t*>(mappedData);
+	m_size = static_cast<size_t>(fileStatus.st_size);
+#else
+	std::ifstream file = std::ifstream(path, std::ios::binary | std::ios::ate);
+	if (!file.is_open())
+		return false;
+	m_readData.resize(static_cast<size_t>(file.tellg()));
+	file.seekg(0);
+	if (m_readData.empty() || !file.read(reinterpret_cast<char*>(m_readData.data()), m_readData.size())) {
+		m_readData.clear();
+		return false;
+	}
+
+	m_data = m_readData.data();
+	m_size = m_readData.size();
+#endif
+	return true;
+}
+
+void MappedFile::close() {
+	if (!m_data)
+		return;
+#ifdef __linux__
+	munmap(const_cast<uint8_t*>(m_data), m_size);
+#else
+	m_readData = std::vector<uint8_t>();
+#endif
+	m_data = nullptr;
+	m_size = 0;
+}
@@ -0,0 +1,99 @@
+#include <util/MappedFileReader.hpp>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFileReader::~MappedFileReader() {
+#ifdef __linux__
+	for (auto& [data, size] : m_mappings) {
+		munmap(data, size);
+	}
+#endif
+}
+
+void MappedFileReader::setFileCallbacks(cgltf_options& options) {
+#ifdef __linux__
+	options.file.user_data = this;
+	options.file.read = [](const cgltf_memory_options*, const cgltf_file_options* fileOptions, const char* path,
+						   cgltf_size* size, void** data) {
+		return reinterpret_cast<MappedFileReader*>(fileOptions->user_data)->mapFile(path, size, data);
+	};
+	// newer cgltf versions additionally pass the size of the data to release, the mapping size is tracked here anyway
+	options.file.release = [](const cgltf_memory_options* memoryOptions, const cgltf_file_options* fileOptions,
+							  void* data, auto...) {
+		reinterpret_cast<MappedFileReader*>(fileOptions->user_data)->unmapFile(memoryOptions, data);
+	};
+#endif
+}
+
+void MappedFileReader::prefetch(const void* data, size_t size) {
+#ifdef __linux__
+	if (!size)
+		return;
+	// madvise needs page aligned addresses, unmapped ranges (e.g. data URIs in heap memory) just fail silently
+	uintptr_t pageSize = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+	uintptr_t begin = reinterpret_cast<uintptr_t>(data) & ~(pageSize - 1);
+	uintptr_t end = reinterpret_cast<uintptr_t>(data) + size;
+	madvise(reinterpret_cast<void*>(begin), end - begin, MADV_WILLNEED);
+#endif
+}
+
+cgltf_result MappedFileReader::mapFile(const char* path, cgltf_size* size, void** data) {
+#ifdef __linux__
+	int fileDescriptor = open(path, O_RDONLY | O_CLOEXEC);
+	if (fileDescriptor == -1)
+		return cgltf_result_file_not_found;
+
+	struct stat fileStatus;
+	if (fstat(fileDescriptor, &fileStatus) == -1 || fileStatus.st_size == 0) {
+		close(fileDescriptor);
+		return cgltf_result_io_error;
+	}
+
+	size_t fileSize = static_cast<size_t>(fileStatus.st_size);
+	void* mappedData = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+	// the mapping stays valid after closing the file
+	close(fileDescriptor);
+	if (mappedData == MAP_FAILED)
+		return cgltf_result_io_error;
+
+	// accessors and the JSON are mostly read front to back, let the kernel read ahead aggressively
+	madvise(mappedData, fileSize, MADV_SEQUENTIAL);
+
+	{
+		std::scoped_lock lock(m_mappingMutex);
+		m_mappings.insert({ mappedData, fileSize });
+	}
+
+	if (size)
+		*size = fileSize;
+	*data = mappedData;
+	return cgltf_result_success;
+#else
+	return cgltf_result_io_error;
+#endif
+}
+
+void MappedFileReader::unmapFile(const cgltf_memory_options* memoryOptions, void* data) {
+#ifdef __linux__
+	{
+		std::scoped_lock lock(m_mappingMutex);
+		auto mapping = m_mappings.find(data);
+		if (mapping != m_mappings.end()) {
+			munmap(mapping->first, mapping->second);
+			m_mappings.erase(mapping);
+			return;
+		}
+	}
+#endif
+	// not mapped by us, cgltf allocated it with the memory callbacks
+	if (memoryOptions->free_func) {
+		memoryOptions->free_func(memoryOptions->user_data, data);
+	} else {
+		free(data);
+	}
+}
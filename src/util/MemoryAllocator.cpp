@@ -1,4 +1,5 @@
 #include <ErrorHelper.hpp>
+#include <algorithm>
 #include <numeric>
 #include <util/MemoryAllocator.hpp>
 #include <volk.h>
@@ -12,9 +13,16 @@ MemoryAllocator::~MemoryAllocator() {
 	for (auto& memory : m_deviceBufferMemoryAllocations) {
 		vkFreeMemory(m_device.device(), memory.memory, nullptr);
 	}
+	for (auto& memory : m_readbackBufferMemoryAllocations) {
+		vkFreeMemory(m_device.device(), memory.memory, nullptr);
+	}
 	for (auto& memory : m_deviceImageMemoryAllocations) {
 		vkFreeMemory(m_device.device(), memory.memory, nullptr);
 	}
+	for (auto& block : m_pooledImageMemoryBlocks) {
+		if (block.memory != VK_NULL_HANDLE)
+			vkFreeMemory(m_device.device(), block.memory, nullptr);
+	}
 }
 
 void* MemoryAllocator::bindStagingBuffer(VkBuffer buffer, VkDeviceSize alignment) {
@@ -34,6 +42,26 @@ void* MemoryAllocator::bindStagingBuffer(VkBuffer buffer, VkDeviceSize alignment
 						allocationAlignment, memoryTypeIndex, nullptr, bufferMemorySize, true).mappedMemoryPointer;
 }
 
+void* MemoryAllocator::bindReadbackBuffer(VkBuffer buffer, VkDeviceSize alignment) {
+	VkMemoryRequirements requirements;
+	vkGetBufferMemoryRequirements(m_device.device(), buffer, &requirements);
+
+	// staging memory is often write-combined, reading from uncached memory is very slow
+	uint32_t memoryTypeIndex =
+		m_device.findBestMemoryIndex(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+									 VK_MEMORY_PROPERTY_HOST_CACHED_BIT, ~requirements.memoryTypeBits);
+	VkDeviceSize allocationAlignment;
+	if (alignment) {
+		allocationAlignment = std::lcm(alignment, requirements.alignment);
+	} else {
+		allocationAlignment = requirements.alignment;
+	}
+
+	return bindResource(m_readbackBufferMemoryAllocations, buffer, vkBindBufferMemory, requirements.size,
+						allocationAlignment, memoryTypeIndex, nullptr, readbackMemorySize, true)
+		.mappedMemoryPointer;
+}
+
 void MemoryAllocator::bindDeviceBuffer(VkBuffer buffer, VkDeviceSize alignment) {
 	VkMemoryAllocateFlagsInfo flagsInfo = { .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO,
 											.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT };
@@ -86,3 +114,81 @@ void MemoryAllocator::freeImage(const ImageAllocation& allocation) {
 			allocation.offset + allocation.size;
 	}
 }
+
+ImageAllocation MemoryAllocator::bindPooledImage(VkImage image) {
+	VkMemoryRequirements requirements;
+	vkGetImageMemoryRequirements(m_device.device(), image, &requirements);
+
+	uint32_t memoryTypeIndex =
+		m_device.findBestMemoryIndex(0, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, ~requirements.memoryTypeBits);
+
+	// first fit, the alignment padding in front of the image is part of its allocation
+	for (size_t i = 0; i < m_pooledImageMemoryBlocks.size(); ++i) {
+		PooledMemoryBlock& block = m_pooledImageMemoryBlocks[i];
+		if (block.memory == VK_NULL_HANDLE || block.memoryTypeIndex != memoryTypeIndex)
+			continue;
+
+		for (auto range = block.freeRanges.begin(); range != block.freeRanges.end(); ++range) {
+			VkDeviceSize alignedOffset =
+				(range->offset + requirements.alignment - 1) / requirements.alignment * requirements.alignment;
+			if (alignedOffset + requirements.size > range->offset + range->size)
+				continue;
+
+			verifyResult(vkBindImageMemory(m_device.device(), image, block.memory, alignedOffset));
+			ImageAllocation allocation = { .memoryAllocationIndex = i,
+										   .offset = range->offset,
+										   .size = alignedOffset + requirements.size - range->offset };
+			range->offset += allocation.size;
+			range->size -= allocation.size;
+			if (!range->size)
+				block.freeRanges.erase(range);
+			return allocation;
+		}
+	}
+
+	// slots of released blocks are reused so that the indices of the other allocations stay valid
+	auto blockIterator = std::find_if(m_pooledImageMemoryBlocks.begin(), m_pooledImageMemoryBlocks.end(),
+									  [](const PooledMemoryBlock& block) { return block.memory == VK_NULL_HANDLE; });
+	if (blockIterator == m_pooledImageMemoryBlocks.end()) {
+		m_pooledImageMemoryBlocks.emplace_back();
+		blockIterator = m_pooledImageMemoryBlocks.end() - 1;
+	}
+
+	PooledMemoryBlock& block = *blockIterator;
+	VkMemoryAllocateInfo allocateInfo = { .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+										  .allocationSize = std::max(imageMemorySize, requirements.size),
+										  .memoryTypeIndex = memoryTypeIndex };
+	verifyResult(vkAllocateMemory(m_device.device(), &allocateInfo, nullptr, &block.memory));
+	verifyResult(vkBindImageMemory(m_device.device(), image, block.memory, 0));
+	block.memoryTypeIndex = memoryTypeIndex;
+	block.size = allocateInfo.allocationSize;
+	block.freeRanges.clear();
+	if (requirements.size < block.size)
+		block.freeRanges.push_back({ .offset = requirements.size, .size = block.size - requirements.size });
+
+	return { .memoryAllocationIndex = static_cast<size_t>(blockIterator - m_pooledImageMemoryBlocks.begin()),
+			 .offset = 0,
+			 .size = requirements.size };
+}
+
+void MemoryAllocator::freePooledImage(const ImageAllocation& allocation) {
+	PooledMemoryBlock& block = m_pooledImageMemoryBlocks[allocation.memoryAllocationIndex];
+
+	auto next = std::lower_bound(block.freeRanges.begin(), block.freeRanges.end(), allocation.offset,
+								 [](const MemoryRange& range, VkDeviceSize offset) { return range.offset < offset; });
+	auto range = block.freeRanges.insert(next, { .offset = allocation.offset, .size = allocation.size });
+	if (range + 1 != block.freeRanges.end() && range->offset + range->size == (range + 1)->offset) {
+		range->size += (range + 1)->size;
+		block.freeRanges.erase(range + 1);
+	}
+	if (range != block.freeRanges.begin() && (range - 1)->offset + (range - 1)->size == range->offset) {
+		(range - 1)->size += range->size;
+		block.freeRanges.erase(range);
+	}
+
+	if (block.freeRanges.size() == 1 && block.freeRanges[0].size == block.size) {
+		vkFreeMemory(m_device.device(), block.memory, nullptr);
+		block.memory = VK_NULL_HANDLE;
+		block.freeRanges.clear();
+	}
+}
@@ -0,0 +1,164 @@
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <limits>
+#include <util/AccessorUnpacking.hpp>
+#include <util/Hash.hpp>
+#include <util/MeshOptimization.hpp>
+
+static constexpr uint32_t invalidVertex = std::numeric_limits<uint32_t>::max();
+
+// spreads the lower 10 bits of value so that there are two zero bits between each of them
+static uint32_t spreadMortonBits(uint32_t value) {
+	value &= 0x3FFU;
+	value = (value | (value << 16)) & 0x030000FFU;
+	value = (value | (value << 8)) & 0x0300F00FU;
+	value = (value | (value << 4)) & 0x030C30C3U;
+	value = (value | (value << 2)) & 0x09249249U;
+	return value;
+}
+
+static void sortTrianglesByMortonCode(std::vector<uint32_t>& indices, const std::vector<float>& positions,
+									  const float boundsMin[3], const float boundsExtent[3]) {
+	size_t triangleCount = indices.size() / 3;
+	// Morton code in the upper 32 bits, the triangle index in the lower ones keeps the order of equal codes stable
+	std::vector<uint64_t> sortKeys(triangleCount);
+	for (size_t i = 0; i < triangleCount; ++i) {
+		uint32_t code = 0;
+		for (size_t axis = 0; axis < 3; ++axis) {
+			float centroid = (positions[indices[i * 3] * 3 + axis] + positions[indices[i * 3 + 1] * 3 + axis] +
+							  positions[indices[i * 3 + 2] * 3 + axis]) /
+							 3.0f;
+			float normalized = boundsExtent[axis] > 0.0f ? (centroid - boundsMin[axis]) / boundsExtent[axis] : 0.0f;
+			uint32_t quantized = static_cast<uint32_t>(std::clamp(normalized * 1023.0f, 0.0f, 1023.0f));
+			code |= spreadMortonBits(quantized) << axis;
+		}
+		sortKeys[i] = (static_cast<uint64_t>(code) << 32) | i;
+	}
+	std::sort(sortKeys.begin(), sortKeys.end());
+
+	std::vector<uint32_t> sortedIndices(triangleCount * 3);
+	for (size_t i = 0; i < triangleCount; ++i) {
+		size_t triangleIndex = sortKeys[i] & 0xFFFFFFFFU;
+		std::memcpy(sortedIndices.data() + i * 3, indices.data() + triangleIndex * 3, 3 * sizeof(uint32_t));
+	}
+	// trailing indices that don't form a whole triangle stay where they are
+	std::copy(indices.begin() + triangleCount * 3, indices.end(), sortedIndices.begin() + triangleCount * 3);
+	indices = std::move(sortedIndices);
+}
+
+WeldedMesh weldMesh(const MeshAttributes& attributes, const std::vector<const cgltf_accessor*>& indexAccessors) {
+	size_t sourceVertexCount = attributes.positions->count;
+	if (!sourceVertexCount) {
+		// nothing the indices could reference
+		WeldedMesh mesh;
+		mesh.indices.resize(indexAccessors.size());
+		return mesh;
+	}
+
+	// all attributes of a vertex next to each other, for hashing and comparing whole vertices
+	struct StreamLayout {
+		const cgltf_accessor* accessor;
+		size_t componentCount;
+		std::vector<float> WeldedMesh::*stream;
+	};
+	StreamLayout layouts[] = { { attributes.positions, 3, &WeldedMesh::positions },
+							   { attributes.normals, 3, &WeldedMesh::normals },
+							   { attributes.tangents, 4, &WeldedMesh::tangents },
+							   { attributes.texCoords, 2, &WeldedMesh::texCoords } };
+	size_t vertexStride = 0;
+	for (auto& layout : layouts) {
+		if (layout.accessor && layout.accessor->count >= sourceVertexCount)
+			vertexStride += layout.componentCount;
+		else
+			layout.accessor = nullptr;
+	}
+
+	std::vector<float> sourceVertices(sourceVertexCount * vertexStride);
+	std::vector<float> unpackedStream;
+	size_t streamOffset = 0;
+	for (auto& layout : layouts) {
+		if (!layout.accessor)
+			continue;
+		unpackedStream.resize(layout.accessor->count * layout.componentCount);
+		unpackAccessorFloats(layout.accessor, layout.componentCount, unpackedStream.data());
+		for (size_t i = 0; i < sourceVertexCount; ++i) {
+			std::memcpy(sourceVertices.data() + i * vertexStride + streamOffset,
+						unpackedStream.data() + i * layout.componentCount, layout.componentCount * sizeof(float));
+		}
+		streamOffset += layout.componentCount;
+	}
+
+	// open addressing table of the first vertex with each content, twice the vertex count keeps the probes short
+	size_t tableSize = std::bit_ceil(std::max(sourceVertexCount * 2, size_t{ 16 }));
+	std::vector<uint32_t> table(tableSize, invalidVertex);
+	std::vector<uint32_t> weldedIndices(sourceVertexCount);
+	size_t vertexSize = vertexStride * sizeof(float);
+	for (size_t i = 0; i < sourceVertexCount; ++i) {
+		const float* vertex = sourceVertices.data() + i * vertexStride;
+		size_t slot = hashData(vertex, vertexSize) & (tableSize - 1);
+		while (table[slot] != invalidVertex &&
+			   std::memcmp(sourceVertices.data() + table[slot] * vertexStride, vertex, vertexSize)) {
+			slot = (slot + 1) & (tableSize - 1);
+		}
+		if (table[slot] == invalidVertex)
+			table[slot] = static_cast<uint32_t>(i);
+		weldedIndices[i] = table[slot];
+	}
+
+	float boundsMin[3] = { std::numeric_limits<float>::max(), std::numeric_limits<float>::max(),
+						   std::numeric_limits<float>::max() };
+	float boundsMax[3] = { -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max(),
+						   -std::numeric_limits<float>::max() };
+	std::vector<float> sourcePositions(sourceVertexCount * 3);
+	for (size_t i = 0; i < sourceVertexCount; ++i) {
+		for (size_t axis = 0; axis < 3; ++axis) {
+			float position = sourceVertices[i * vertexStride + axis];
+			sourcePositions[i * 3 + axis] = position;
+			boundsMin[axis] = std::min(boundsMin[axis], position);
+			boundsMax[axis] = std::max(boundsMax[axis], position);
+		}
+	}
+	float boundsExtent[3] = { boundsMax[0] - boundsMin[0], boundsMax[1] - boundsMin[1], boundsMax[2] - boundsMin[2] };
+
+	WeldedMesh mesh;
+	mesh.indices.resize(indexAccessors.size());
+	for (size_t i = 0; i < indexAccessors.size(); ++i) {
+		std::vector<uint32_t>& indices = mesh.indices[i];
+		indices.resize(indexAccessors[i]->count);
+		unpackAccessorIndices(indexAccessors[i], indices.data());
+		for (auto& index : indices) {
+			index = index < sourceVertexCount ? weldedIndices[index] : 0;
+		}
+		sortTrianglesByMortonCode(indices, sourcePositions, boundsMin, boundsExtent);
+	}
+
+	// renumber in order of first use so that vertices of neighbouring triangles are close in memory
+	std::vector<uint32_t> newIndices(sourceVertexCount, invalidVertex);
+	std::vector<uint32_t> sourceIndices;
+	for (auto& indices : mesh.indices) {
+		for (auto& index : indices) {
+			if (newIndices[index] == invalidVertex) {
+				newIndices[index] = static_cast<uint32_t>(sourceIndices.size());
+				sourceIndices.push_back(index);
+			}
+			index = newIndices[index];
+		}
+	}
+
+	mesh.vertexCount = sourceIndices.size();
+	streamOffset = 0;
+	for (auto& layout : layouts) {
+		if (!layout.accessor)
+			continue;
+		std::vector<float>& stream = mesh.*layout.stream;
+		stream.resize(mesh.vertexCount * layout.componentCount);
+		for (size_t i = 0; i < mesh.vertexCount; ++i) {
+			std::memcpy(stream.data() + i * layout.componentCount,
+						sourceVertices.data() + sourceIndices[i] * vertexStride + streamOffset,
+						layout.componentCount * sizeof(float));
+		}
+		streamOffset += layout.componentCount;
+	}
+	return mesh;
+}
@@ -1,11 +1,30 @@
 #define CGLTF_IMPLEMENTATION
 #define STB_IMAGE_IMPLEMENTATION
+#include <Config.hpp>
 #include <DebugHelper.hpp>
 #include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
 #include <cstring>
 #include <filesystem>
+#include <limits>
+#include <map>
+#include <optional>
 #include <stb_image.h>
+#include <util/AccessorUnpacking.hpp>
+#include <util/Hash.hpp>
+#include <util/MappedFile.hpp>
+#include <util/MappedFileReader.hpp>
+#include <util/MeshOptimization.hpp>
 #include <util/ModelLoader.hpp>
+#include <util/SceneCache.hpp>
+#include <util/TextureCompression.hpp>
+#include <util/VertexEncoding.hpp>
+#if defined(__SSE2__) || defined(_M_X64)
+#define MODEL_LOADER_SSE2
+#include <emmintrin.h>
+#endif
 
 // https://github.com/graphitemaster/normals_revisited
 float minor(const float m[16], int r0, int r1, int r2, int c0, int c1, int c2) {
@@ -67,99 +86,376 @@ void checkCGLTFResult(cgltf_result result, const std::string_view& gltfFilename)
 	}
 }
 
-struct BlitImage {
-	VkImage image;
-	int32_t width, height;
-};
-
-ModelLoader::ModelLoader(RayTracingDevice& device, MemoryAllocator& allocator, OneTimeDispatcher& dispatcher,
-						 const std::vector<std::string_view>& gltfFilenames)
-	: m_device(device), m_allocator(allocator), m_dispatcher(dispatcher) {
-	if (gltfFilenames.empty())
+void prefetchAccessor(const cgltf_accessor* accessor) {
+	if (!accessor->buffer_view || !accessor->count)
 		return;
-	std::vector<cgltf_data*> gltfData;
-	gltfData.reserve(gltfFilenames.size());
+	const uint8_t* data = reinterpret_cast<const uint8_t*>(accessor->buffer_view->buffer->data) +
+						  accessor->buffer_view->offset + accessor->offset;
+	size_t size = (accessor->count - 1) * accessor->stride + cgltf_calc_size(accessor->type, accessor->component_type);
+	MappedFileReader::prefetch(data, size);
+}
 
-	size_t totalImageCount = 0;
+// points to the accessor's floats in the glTF buffer if they're tightly packed, otherwise unpacks them to scratch
+const float* accessorFloats(const cgltf_accessor* accessor, size_t componentCount, std::vector<float>& scratch) {
+	if (isTightlyPackedFloatAccessor(accessor, componentCount)) {
+		return reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(accessor->buffer_view->buffer->data) +
+											  accessor->buffer_view->offset + accessor->offset);
+	}
+	scratch.resize(accessor->count * componentCount);
+	unpackAccessorFloats(accessor, componentCount, scratch.data());
+	return scratch.data();
+}
 
-	for (auto& gltfFilename : gltfFilenames) {
-		cgltf_options options = {};
-		cgltf_data* data;
-		cgltf_result result = cgltf_parse_file(&options, gltfFilename.data(), &data);
-		checkCGLTFResult(result, gltfFilename);
-		result = cgltf_load_buffers(&options, data, gltfFilename.data());
-		checkCGLTFResult(result, gltfFilename);
-		gltfData.push_back(data);
+const cgltf_accessor* positionAccessor(const cgltf_primitive* primitive) {
+	for (cgltf_size i = 0; i < primitive->attributes_count; ++i) {
+		if (primitive->attributes[i].type == cgltf_attribute_type_position)
+			return primitive->attributes[i].data;
+	}
+	return nullptr;
+}
 
-		if (data->scene) {
-			addScene(data, data->scene);
-		} else {
-			for (cgltf_size i = 0; i < data->scenes_count; ++i) {
-				addScene(data, data->scenes + i);
+// the attributes that end up in the vertex streams, materials only use the first texture coordinate set
+MeshAttributes primitiveAttributes(const cgltf_primitive* primitive) {
+	MeshAttributes attributes = {};
+	for (cgltf_size i = 0; i < primitive->attributes_count; ++i) {
+		const cgltf_attribute& attribute = primitive->attributes[i];
+		switch (attribute.type) {
+			case cgltf_attribute_type_position:
+				attributes.positions = attribute.data;
+				break;
+			case cgltf_attribute_type_normal:
+				attributes.normals = attribute.data;
+				break;
+			case cgltf_attribute_type_tangent:
+				attributes.tangents = attribute.data;
+				break;
+			case cgltf_attribute_type_texcoord:
+				if (attribute.index == 0)
+					attributes.texCoords = attribute.data;
+				break;
+			default:
+				break;
+		}
+	}
+	return attributes;
+}
+
+// Accessors the interleaved shading records of a primitive are built from (positions, normals, tangents, texture
+// coordinates). There is one record per position, attributes with fewer elements are left out like in weldMesh.
+std::array<const cgltf_accessor*, 4> shadingRecordSources(const cgltf_primitive* primitive) {
+	MeshAttributes attributes = primitiveAttributes(primitive);
+	std::array<const cgltf_accessor*, 4> sources = { attributes.positions, attributes.normals, attributes.tangents,
+													 attributes.texCoords };
+	for (size_t i = 1; i < sources.size(); ++i) {
+		if (!attributes.positions || (sources[i] && sources[i]->count < attributes.positions->count))
+			sources[i] = nullptr;
+	}
+	return sources;
+}
+
+// bounds of tightly packed positions transformed by the row-major matrix in Geometry::transformMatrix
+AABB transformedBounds(const float* positions, size_t count, const float transform[16]) {
+#ifdef MODEL_LOADER_SSE2
+	// one column of the transform per register, so each position needs three broadcasts and multiply-adds
+	__m128 column0 = _mm_setr_ps(transform[0], transform[4], transform[8], 0.0f);
+	__m128 column1 = _mm_setr_ps(transform[1], transform[5], transform[9], 0.0f);
+	__m128 column2 = _mm_setr_ps(transform[2], transform[6], transform[10], 0.0f);
+	__m128 column3 = _mm_setr_ps(transform[3], transform[7], transform[11], 0.0f);
+	__m128 boundsMin = _mm_set1_ps(std::numeric_limits<float>::max());
+	__m128 boundsMax = _mm_set1_ps(-std::numeric_limits<float>::max());
+	for (size_t i = 0; i < count; ++i) {
+		const float* position = positions + i * 3;
+		__m128 transformed = _mm_add_ps(_mm_add_ps(_mm_mul_ps(column0, _mm_set1_ps(position[0])),
+												   _mm_mul_ps(column1, _mm_set1_ps(position[1]))),
+										_mm_add_ps(_mm_mul_ps(column2, _mm_set1_ps(position[2])), column3));
+		boundsMin = _mm_min_ps(boundsMin, transformed);
+		boundsMax = _mm_max_ps(boundsMax, transformed);
+	}
+	alignas(16) float minValues[4], maxValues[4];
+	_mm_store_ps(minValues, boundsMin);
+	_mm_store_ps(maxValues, boundsMax);
+	return { .xmin = minValues[0],
+			 .ymin = minValues[1],
+			 .zmin = minValues[2],
+			 .xmax = maxValues[0],
+			 .ymax = maxValues[1],
+			 .zmax = maxValues[2] };
+#else
+	AABB bounds = { .xmin = std::numeric_limits<float>::max(),
+					.ymin = std::numeric_limits<float>::max(),
+					.zmin = std::numeric_limits<float>::max(),
+					.xmax = -std::numeric_limits<float>::max(),
+					.ymax = -std::numeric_limits<float>::max(),
+					.zmax = -std::numeric_limits<float>::max() };
+	for (size_t i = 0; i < count; ++i) {
+		const float* position = positions + i * 3;
+		float transformed[3];
+		for (size_t j = 0; j < 3; ++j) {
+			transformed[j] = transform[4 * j] * position[0] + transform[4 * j + 1] * position[1] +
+							 transform[4 * j + 2] * position[2] + transform[4 * j + 3];
+		}
+		bounds.xmin = std::min(bounds.xmin, transformed[0]);
+		bounds.ymin = std::min(bounds.ymin, transformed[1]);
+		bounds.zmin = std::min(bounds.zmin, transformed[2]);
+		bounds.xmax = std::max(bounds.xmax, transformed[0]);
+		bounds.ymax = std::max(bounds.ymax, transformed[1]);
+		bounds.zmax = std::max(bounds.zmax, transformed[2]);
+	}
+	return bounds;
+#endif
+}
+
+bool isBlockCompressed(VkFormat format) {
+	return format == VK_FORMAT_BC1_RGB_SRGB_BLOCK || format == VK_FORMAT_BC5_UNORM_BLOCK ||
+		   format == VK_FORMAT_BC7_SRGB_BLOCK;
+}
+
+size_t imageLevelSize(VkFormat format, uint32_t width, uint32_t height) {
+	switch (format) {
+		case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+			return blockCompressedSize(width, height, 8);
+		case VK_FORMAT_BC5_UNORM_BLOCK:
+		case VK_FORMAT_BC7_SRGB_BLOCK:
+			return blockCompressedSize(width, height, 16);
+		default:
+			return static_cast<size_t>(width) * height * 4;
+	}
+}
+
+// Compressed formats can't be blit destinations, so the mip chain is generated here and every level from firstLevel
+// on is written to the destination one after another, compressed if the format is. Streamed images of any format
+// are written like this as well.
+void writeImageLevels(const ImageData& image, const unsigned char* texels, uint32_t firstLevel,
+					  unsigned char* destination) {
+	bool isSRGB = image.format != VK_FORMAT_BC5_UNORM_BLOCK && image.format != VK_FORMAT_R8G8B8A8_UNORM;
+	uint32_t width = static_cast<uint32_t>(image.width);
+	uint32_t height = static_cast<uint32_t>(image.height);
+
+	std::vector<unsigned char> mipTexels[2];
+	for (uint32_t level = 0; level < image.mipLevels; ++level) {
+		if (level >= firstLevel) {
+			switch (image.format) {
+				case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+					compressBC1(texels, width, height, destination);
+					break;
+				case VK_FORMAT_BC5_UNORM_BLOCK:
+					compressBC5(texels, width, height, destination);
+					break;
+				case VK_FORMAT_BC7_SRGB_BLOCK:
+					compressBC7(texels, width, height, destination);
+					break;
+				default:
+					std::memcpy(destination, texels, imageLevelSize(image.format, width, height));
+					break;
 			}
+			destination += imageLevelSize(image.format, width, height);
 		}
 
-		totalImageCount += data->images_count;
+		if (level + 1 < image.mipLevels) {
+			std::vector<unsigned char>& nextLevelTexels = mipTexels[level % 2];
+			nextLevelTexels.resize(static_cast<size_t>(std::max(width / 2, 1U)) * std::max(height / 2, 1U) * 4);
+			downsampleImage(texels, width, height, nextLevelTexels.data(), isSRGB);
+
+			texels = nextLevelTexels.data();
+			width = std::max(width / 2, 1U);
+			height = std::max(height / 2, 1U);
+		}
 	}
+}
 
-	m_textureImageNormalUsage.resize(totalImageCount);
+// RGBA8 texels of the base level, freed with stbi_image_free. The image and its staging slot were created with the
+// dimensions from the header, so images that fail to decode to those return nullptr and are loaded as white.
+stbi_uc* loadImageTexels(const ImageData& image) {
+	int width = 0, height = 0, numChannels;
+	stbi_uc* decodedData = nullptr;
+	if (image.encodedData) {
+		decodedData = stbi_load_from_memory(image.encodedData, static_cast<int>(image.encodedSize), &width, &height,
+											&numChannels, 4);
+	} else if (!image.path.empty()) {
+		decodedData = stbi_load(image.path.c_str(), &width, &height, &numChannels, 4);
+	}
 
-	size_t vertexDataSize = m_totalVertexCount * 3 * sizeof(float);
-	size_t normalDataSize = m_totalNormalCount * 3 * sizeof(float);
-	size_t tangentDataSize = m_totalTangentCount * 4 * sizeof(float);
-	size_t uvDataSize = m_totalUVCount * 2 * sizeof(float);
-	size_t indexDataSize = m_totalIndexCount * sizeof(uint32_t);
+	if (decodedData && (width != image.width || height != image.height)) {
+		stbi_image_free(decodedData);
+		return nullptr;
+	}
+	return decodedData;
+}
+
+// decodes an image into its slot of the image staging buffer and returns the time it took in milliseconds
+double decodeImage(const ImageData& image, unsigned char* destination) {
+	auto startTime = std::chrono::steady_clock::now();
+
+	stbi_uc* decodedData = loadImageTexels(image);
+	if (isBlockCompressed(image.format)) {
+		std::vector<unsigned char> fallbackTexels;
+		if (!decodedData) {
+			fallbackTexels.assign(static_cast<size_t>(image.width) * image.height * 4, 0xFF);
+		}
+		writeImageLevels(image, decodedData ? decodedData : fallbackTexels.data(), 0, destination);
+	} else if (decodedData) {
+		std::memcpy(destination, decodedData, image.size);
+	} else {
+		std::memset(destination, 0xFF, image.size);
+	}
+	stbi_image_free(decodedData);
+
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+// Texture requests are written by the closest hit shader as (baseLod + offset) * scale, see sampleTexture in
+// triangle.rchit. The base LOD is independent of the texture resolution.
+static constexpr uint32_t noTextureRequest = ~0U;
+static constexpr float textureRequestLodOffset = 64.0f;
+static constexpr float textureRequestLodScale = 16.0f;
+
+// size of all levels from baseLevel on, as written by writeImageLevels
+size_t streamedImageSize(const ImageData& image, uint32_t baseLevel) {
+	size_t size = 0;
+	for (uint32_t level = baseLevel; level < image.mipLevels; ++level) {
+		size += imageLevelSize(image.format, std::max(image.width >> level, 1), std::max(image.height >> level, 1));
+	}
+	return size;
+}
+
+// Levels from baseLevel on, decoded from the source or copied from the scene cache's texel data. Compressed images
+// are cached with all levels, uncompressed ones only with the base level.
+std::vector<unsigned char> decodeStreamedImage(const ImageData& image, uint32_t baseLevel,
+											   const unsigned char* cachedTexels) {
+	std::vector<unsigned char> texels(streamedImageSize(image, baseLevel));
+	if (cachedTexels && isBlockCompressed(image.format)) {
+		std::memcpy(texels.data(), cachedTexels + (image.size - texels.size()), texels.size());
+		return texels;
+	}
+
+	stbi_uc* decodedData = cachedTexels ? nullptr : loadImageTexels(image);
+	std::vector<unsigned char> fallbackTexels;
+	const unsigned char* baseTexels = cachedTexels ? cachedTexels : decodedData;
+	if (!baseTexels) {
+		fallbackTexels.assign(static_cast<size_t>(image.width) * image.height * 4, 0xFF);
+		baseTexels = fallbackTexels.data();
+	}
+	writeImageLevels(image, baseTexels, baseLevel, texels.data());
+	stbi_image_free(decodedData);
+	return texels;
+}
+
+// scene-wide data stored in the cache
+struct CachedSceneInfo {
+	Camera camera;
+	AABB modelBounds;
 
-	m_vertexData = reinterpret_cast<float*>(malloc(vertexDataSize));
-	m_normalData = reinterpret_cast<float*>(malloc(normalDataSize));
-	m_tangentData = reinterpret_cast<float*>(malloc(tangentDataSize));
-	m_uvData = reinterpret_cast<float*>(malloc(uvDataSize));
-	m_indexData = reinterpret_cast<uint32_t*>(malloc(indexDataSize));
+	uint64_t vertexCount;
+	uint64_t uvCount;
+	uint64_t normalCount;
+	uint64_t tangentCount;
+	uint64_t indexCount;
 
+	uint64_t combinedImageSize;
+};
+
+struct CachedImage {
+	uint64_t stagingOffset;
+	uint64_t size;
+	int32_t width, height;
+	uint32_t mipLevels;
+	VkFormat format;
+};
+
+template <typename T>
+void restoreSection(const SceneCacheReader& cache, SceneCacheSection section, std::vector<T>& target) {
+	const T* data = reinterpret_cast<const T*>(cache.section(section));
+	target.assign(data, data + cache.sectionElementCount<T>(section));
+}
+
+// copies into block compressed images need buffer offsets aligned to the block size, 16 bytes covers all formats used
+static constexpr size_t imageStagingAlignment = 16;
+
+uint32_t mipLevelCount(int width, int height) {
+	return static_cast<uint32_t>(std::floor(std::log2(std::max(std::max(width, height), 1)))) + 1;
+}
+
+// 0.5 * log2 of the ratio between texture coordinate area and object space area over all triangles. Using one value
+// per geometry instead of one per triangle keeps the positions out of the hit shader.
+float objectTexelDensityLod(const cgltf_accessor* positions, const cgltf_accessor* texCoords,
+							const cgltf_accessor* indices) {
+	// cgltf_accessor_read_float can't read sparse accessors
+	if (!positions || !texCoords || !indices || positions->is_sparse || texCoords->is_sparse)
+		return 0.0f;
+
+	double texCoordArea = 0.0;
+	double objectArea = 0.0;
+	for (cgltf_size i = 0; i + 2 < indices->count; i += 3) {
+		glm::vec3 trianglePositions[3];
+		glm::vec2 triangleTexCoords[3];
+		for (cgltf_size j = 0; j < 3; ++j) {
+			cgltf_size index = cgltf_accessor_read_index(indices, i + j);
+			cgltf_accessor_read_float(positions, index, &trianglePositions[j][0], 3);
+			cgltf_accessor_read_float(texCoords, index, &triangleTexCoords[j][0], 2);
+		}
+
+		glm::vec2 texCoordEdge1 = triangleTexCoords[1] - triangleTexCoords[0];
+		glm::vec2 texCoordEdge2 = triangleTexCoords[2] - triangleTexCoords[0];
+		// both areas are doubled, that cancels out in the ratio
+		texCoordArea += std::abs(texCoordEdge1.x * texCoordEdge2.y - texCoordEdge2.x * texCoordEdge1.y);
+		objectArea += glm::length(
+			glm::cross(trianglePositions[1] - trianglePositions[0], trianglePositions[2] - trianglePositions[0]));
+	}
+
+	if (texCoordArea <= 0.0 || objectArea <= 0.0)
+		return 0.0f;
+	return static_cast<float>(0.5 * std::log2(texCoordArea / objectArea));
+}
+
+ModelLoader::ModelLoader(RayTracingDevice& device, MemoryAllocator& allocator, OneTimeDispatcher& dispatcher,
+						 OneTimeDispatcher& transferDispatcher, const std::vector<std::string_view>& gltfFilenames)
+	: m_device(device), m_allocator(allocator), m_dispatcher(dispatcher), m_transferDispatcher(transferDispatcher) {
+	if (gltfFilenames.empty())
+		return;
 	VkSamplerCreateInfo samplerCreateInfo = { .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
 											  .magFilter = VK_FILTER_LINEAR,
 											  .minFilter = VK_FILTER_LINEAR,
 											  .mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR,
 											  .addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT,
-											  .addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT };
+											  .addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+											  .maxLod = VK_LOD_CLAMP_NONE };
 	vkCreateSampler(m_device.device(), &samplerCreateInfo, nullptr, &m_fallbackSampler);
 	setObjectName(m_device.device(), VK_OBJECT_TYPE_SAMPLER, m_fallbackSampler, "Fallback sampler");
 
-	// the layout, order and number of geometries stays the same, so one can just increment a global counter in
-	// order to get the geometry for a given primitive
-	size_t geometryIndex = 0;
-	size_t gltfDataIndex = 0;
-	for (auto& gltfFilename : gltfFilenames) {
-		cgltf_data* data = gltfData[gltfDataIndex];
-		if (data->scene) {
-			copySceneGeometries(data, data->scene, geometryIndex);
-		} else {
-			for (cgltf_size i = 0; i < data->scenes_count; ++i) {
-				copySceneGeometries(data, data->scenes + i, geometryIndex);
-			}
-		}
-
-		for (cgltf_size i = 0; i < data->images_count; ++i) {
-			addImage(data, data->images + i, gltfFilename);
-		}
-		for (cgltf_size i = 0; i < data->samplers_count; ++i) {
-			addSampler(data, data->samplers + i);
-		}
-		for (cgltf_size i = 0; i < data->textures_count; ++i) {
-			addTexture(data, data->textures + i);
-		}
-		for (cgltf_size i = 0; i < data->materials_count; ++i) {
-			addMaterial(data, data->materials + i);
+	m_loadStartTime = std::chrono::steady_clock::now();
+
+	// A cache hit skips parsing, geometry processing and image decoding entirely, everything is copied straight from
+	// the mapped cache file into the staging buffers.
+	uint64_t sceneHash = 0;
+	bool canCacheScene = false;
+	m_compressTextures = compressTextures && m_device.supportsTextureCompressionBC();
+
+	if constexpr (enableSceneCache) {
+		canCacheScene = hashSceneInputs(gltfFilenames, m_threadPool, sceneHash);
+		// cached texel data is stored in the format it is uploaded in
+		sceneHash = hashCombine(sceneHash, m_compressTextures);
+		sceneHash = hashCombine(sceneHash, weldVertices);
+		if (canCacheScene) {
+			m_isSceneCached = m_sceneCache.open(sceneCachePath(sceneHash), sceneHash);
 		}
+	}
+	m_hasSceneHash = canCacheScene;
+	m_sceneHash = sceneHash;
 
-		m_globalMaterialIndexOffset += data->materials_count;
-		m_globalSamplerIndexOffset += data->samplers_count;
-		m_globalImageIndexOffset += data->images_count;
-		m_globalTextureIndexOffset += data->textures_count;
+	m_gltfData = std::vector<cgltf_data*>(gltfFilenames.size(), nullptr);
 
-		++gltfDataIndex;
+	if (m_isSceneCached) {
+		restoreSceneInfo(m_sceneCache);
+	} else {
+		parseScenes(gltfFilenames, m_gltfData, m_fileReader);
 	}
 
+	size_t vertexDataSize = m_totalVertexCount * 3 * sizeof(float);
+	size_t normalDataSize = normalBufferSize();
+	size_t tangentDataSize = tangentBufferSize();
+	size_t uvDataSize = uvBufferSize();
+	size_t indexDataSize = indexBufferSize();
+
 	// Allocate buffers (both staging and device local)
 
 	VkBufferCreateInfo bufferCreateInfo = { .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
@@ -186,23 +482,29 @@ ModelLoader::ModelLoader(RayTracingDevice& device, MemoryAllocator& allocator, O
 	setObjectName(m_device.device(), VK_OBJECT_TYPE_BUFFER, m_normalBuffer, "Normal buffer");
 	setObjectName(m_device.device(), VK_OBJECT_TYPE_BUFFER, m_normalStagingBuffer, "Normal staging buffer");
 
-	bufferCreateInfo.size = tangentDataSize;
-	stagingBufferCreateInfo.size = tangentDataSize;
+	// tangents and texture coordinates are empty if no geometry has them or if they are interleaved into the shading
+	// records in the normal buffer, zero-sized buffers aren't allowed
+	if (tangentDataSize) {
+		bufferCreateInfo.size = tangentDataSize;
+		stagingBufferCreateInfo.size = tangentDataSize;
 
-	verifyResult(vkCreateBuffer(m_device.device(), &bufferCreateInfo, nullptr, &m_tangentBuffer));
-	verifyResult(vkCreateBuffer(m_device.device(), &stagingBufferCreateInfo, nullptr, &m_tangentStagingBuffer));
+		verifyResult(vkCreateBuffer(m_device.device(), &bufferCreateInfo, nullptr, &m_tangentBuffer));
+		verifyResult(vkCreateBuffer(m_device.device(), &stagingBufferCreateInfo, nullptr, &m_tangentStagingBuffer));
 
-	setObjectName(m_device.device(), VK_OBJECT_TYPE_BUFFER, m_tangentBuffer, "Tangent buffer");
-	setObjectName(m_device.device(), VK_OBJECT_TYPE_BUFFER, m_tangentStagingBuffer, "Tangent staging buffer");
+		setObjectName(m_device.device(), VK_OBJECT_TYPE_BUFFER, m_tangentBuffer, "Tangent buffer");
+		setObjectName(m_device.device(), VK_OBJECT_TYPE_BUFFER, m_tangentStagingBuffer, "Tangent staging buffer");
+	}
 
-	bufferCreateInfo.size = uvDataSize;
-	stagingBufferCreateInfo.size = uvDataSize;
+	if (uvDataSize) {
+		bufferCreateInfo.size = uvDataSize;
+		stagingBufferCreateInfo.size = uvDataSize;
 
-	verifyResult(vkCreateBuffer(m_device.device(), &bufferCreateInfo, nullptr, &m_uvBuffer));
-	verifyResult(vkCreateBuffer(m_device.device(), &stagingBufferCreateInfo, nullptr, &m_uvStagingBuffer));
+		verifyResult(vkCreateBuffer(m_device.device(), &bufferCreateInfo, nullptr, &m_uvBuffer));
+		verifyResult(vkCreateBuffer(m_device.device(), &stagingBufferCreateInfo, nullptr, &m_uvStagingBuffer));
 
-	setObjectName(m_device.device(), VK_OBJECT_TYPE_BUFFER, m_uvBuffer, "Texcoord buffer");
-	setObjectName(m_device.device(), VK_OBJECT_TYPE_BUFFER, m_uvStagingBuffer, "Texcoord staging buffer");
+		setObjectName(m_device.device(), VK_OBJECT_TYPE_BUFFER, m_uvBuffer, "Texcoord buffer");
+		setObjectName(m_device.device(), VK_OBJECT_TYPE_BUFFER, m_uvStagingBuffer, "Texcoord staging buffer");
+	}
 
 	bufferCreateInfo.size = indexDataSize;
 	stagingBufferCreateInfo.size = indexDataSize;
@@ -213,6 +515,135 @@ ModelLoader::ModelLoader(RayTracingDevice& device, MemoryAllocator& allocator, O
 	setObjectName(m_device.device(), VK_OBJECT_TYPE_BUFFER, m_indexBuffer, "Index buffer");
 	setObjectName(m_device.device(), VK_OBJECT_TYPE_BUFFER, m_indexStagingBuffer, "Index staging buffer");
 
+	// accessor data is written straight into the mapped staging memory, the copy pass must never read it back since
+	// the memory might be uncached
+	float* vertexStagingData = reinterpret_cast<float*>(m_allocator.bindStagingBuffer(m_vertexStagingBuffer, 0));
+	uint8_t* normalStagingData = reinterpret_cast<uint8_t*>(m_allocator.bindStagingBuffer(m_normalStagingBuffer, 0));
+	uint8_t* tangentStagingData = nullptr;
+	if (tangentDataSize)
+		tangentStagingData = reinterpret_cast<uint8_t*>(m_allocator.bindStagingBuffer(m_tangentStagingBuffer, 0));
+	uint8_t* uvStagingData = nullptr;
+	if (uvDataSize)
+		uvStagingData = reinterpret_cast<uint8_t*>(m_allocator.bindStagingBuffer(m_uvStagingBuffer, 0));
+	uint32_t* indexStagingData = reinterpret_cast<uint32_t*>(m_allocator.bindStagingBuffer(m_indexStagingBuffer, 0));
+
+	// Streamed texel data is never complete, so the scene is only cached without streaming (but a cache written
+	// without it can be streamed from).
+	bool cacheScene = canCacheScene && !m_isSceneCached && !streamTextures;
+
+	if (m_isSceneCached) {
+		std::memcpy(vertexStagingData, m_sceneCache.section(SceneCacheSection::Vertices), vertexDataSize);
+		std::memcpy(normalStagingData, m_sceneCache.section(SceneCacheSection::Normals), normalDataSize);
+		if (tangentDataSize)
+			std::memcpy(tangentStagingData, m_sceneCache.section(SceneCacheSection::Tangents), tangentDataSize);
+		if (uvDataSize)
+			std::memcpy(uvStagingData, m_sceneCache.section(SceneCacheSection::UVs), uvDataSize);
+		std::memcpy(indexStagingData, m_sceneCache.section(SceneCacheSection::Indices), indexDataSize);
+	} else if (cacheScene) {
+		// the cache needs to read the streams again, so they are copied into host memory first and only then into
+		// the staging buffers
+		m_cachedVertices.resize(vertexDataSize / sizeof(float));
+		m_cachedNormals.resize(normalDataSize);
+		m_cachedTangents.resize(tangentDataSize);
+		m_cachedUVs.resize(uvDataSize);
+		m_cachedIndices.resize(indexDataSize / sizeof(uint32_t));
+
+		m_vertexData = m_cachedVertices.data();
+		m_normalData = m_cachedNormals.data();
+		m_tangentData = m_cachedTangents.data();
+		m_uvData = m_cachedUVs.data();
+		m_indexData = m_cachedIndices.data();
+		copyScenes(gltfFilenames, m_gltfData);
+
+		std::memcpy(vertexStagingData, m_vertexData, vertexDataSize);
+		std::memcpy(normalStagingData, m_normalData, normalDataSize);
+		if (tangentDataSize)
+			std::memcpy(tangentStagingData, m_tangentData, tangentDataSize);
+		if (uvDataSize)
+			std::memcpy(uvStagingData, m_uvData, uvDataSize);
+		std::memcpy(indexStagingData, m_indexData, indexDataSize);
+	} else {
+		m_vertexData = vertexStagingData;
+		m_normalData = normalStagingData;
+		m_tangentData = tangentStagingData;
+		m_uvData = uvStagingData;
+		m_indexData = indexStagingData;
+		copyScenes(gltfFilenames, m_gltfData);
+	}
+
+	// Images are streamed to the GPU through a fixed size staging ring, in chunks of consecutive images that each fit
+	// into one slot of the ring. The thread pool decodes the next chunks (or copies them from the cache) while the GPU
+	// copies the previous ones, a slot is only refilled once the chunk last using it has been copied.
+
+	m_imageStagingSlotSize = std::max(imageStagingRingSize / imageStagingSlotCount, m_maxImageSize);
+	m_imageStagingSlotSize = (m_imageStagingSlotSize + imageStagingAlignment - 1) & ~(imageStagingAlignment - 1);
+
+	// streamed images don't go through the ring at all
+	for (size_t i = 0; !streamTextures && i < m_imageData.size(); ++i) {
+		size_t imageEnd = i + 1 < m_imageData.size() ? m_imageData[i + 1].stagingOffset : m_combinedImageSize;
+		if (m_imageUploadChunks.empty() ||
+			imageEnd - m_imageUploadChunks.back().stagingOffset > m_imageStagingSlotSize) {
+			m_imageUploadChunks.push_back(
+				{ .firstImageIndex = i, .imageCount = 0, .stagingOffset = m_imageData[i].stagingOffset });
+		}
+		ImageUploadChunk& chunk = m_imageUploadChunks.back();
+		++chunk.imageCount;
+		chunk.size = imageEnd - chunk.stagingOffset;
+	}
+	m_imageStagingSlotCount = std::min(imageStagingSlotCount, m_imageUploadChunks.size());
+
+	if (!m_imageUploadChunks.empty()) {
+		VkBufferCreateInfo imageStagingBufferCreateInfo = {
+			.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+			.size = m_imageStagingSlotCount == 1 ? m_imageUploadChunks[0].size
+												 : m_imageStagingSlotCount * m_imageStagingSlotSize,
+			.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT
+		};
+		verifyResult(
+			vkCreateBuffer(m_device.device(), &imageStagingBufferCreateInfo, nullptr, &m_imageStagingBuffer));
+		setObjectName(m_device.device(), VK_OBJECT_TYPE_BUFFER, m_imageStagingBuffer, "Image staging ring buffer");
+		m_imageStagingData = reinterpret_cast<unsigned char*>(m_allocator.bindStagingBuffer(m_imageStagingBuffer, 0));
+	}
+
+	m_textureImages.resize(m_imageData.size(), VK_NULL_HANDLE);
+	m_textureImageViews.resize(m_imageData.size(), VK_NULL_HANDLE);
+	if constexpr (streamTextures) {
+		m_textureImageAllocations.resize(m_imageData.size());
+		createPlaceholderImages();
+	} else {
+		for (size_t i = 0; i < m_imageData.size(); ++i) {
+			createImage(i);
+		}
+	}
+
+	// Streamed textures start out as a placeholder that leaves the material as if it had no texture, except for
+	// emissive ones which are black so that nothing lights up before its texture is there.
+	// Evicted images go back to the same placeholder.
+	m_texturePlaceholders.resize(m_textureSources.size(), PlaceholderTexture::White);
+	for (auto& material : m_materials) {
+		if (material.emissiveTextureIndex < m_texturePlaceholders.size())
+			m_texturePlaceholders[material.emissiveTextureIndex] = PlaceholderTexture::Black;
+	}
+	for (auto& material : m_materials) {
+		if (material.normalTextureIndex < m_texturePlaceholders.size())
+			m_texturePlaceholders[material.normalTextureIndex] = PlaceholderTexture::FlatNormal;
+	}
+	// the flat normal placeholder stores z, so the flag only depends on the format of the normal map itself
+	for (auto& material : m_materials) {
+		if (material.normalTextureIndex < m_textureSources.size()) {
+			uint32_t imageIndex = m_textureSources[material.normalTextureIndex].imageIndex;
+			material.normalMapIsTwoChannel = m_imageData[imageIndex].format == VK_FORMAT_BC5_UNORM_BLOCK;
+		}
+	}
+	for (size_t i = 0; i < m_textureSources.size(); ++i) {
+		const TextureSource& source = m_textureSources[i];
+		VkImageView view = streamTextures ? m_placeholderImageViews[static_cast<size_t>(m_texturePlaceholders[i])]
+										  : m_textureImageViews[source.imageIndex];
+		m_textures.push_back({ .view = view,
+							   .sampler = source.samplerIndex == ~0U ? m_fallbackSampler
+																	 : m_textureSamplers[source.samplerIndex] });
+	}
+
 	bufferCreateInfo.usage &= ~(VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR |
 								VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT);
 	bufferCreateInfo.size = m_materials.size() * sizeof(Material);
@@ -233,110 +664,36 @@ ModelLoader::ModelLoader(RayTracingDevice& device, MemoryAllocator& allocator, O
 	setObjectName(m_device.device(), VK_OBJECT_TYPE_BUFFER, m_geometryBuffer, "Geometry buffer");
 	setObjectName(m_device.device(), VK_OBJECT_TYPE_BUFFER, m_geometryStagingBuffer, "Geometry staging buffer");
 
-	void* vertexStagingBufferData = m_allocator.bindStagingBuffer(m_vertexStagingBuffer, 0);
-	void* normalStagingBufferData = m_allocator.bindStagingBuffer(m_normalStagingBuffer, 0);
-	void* tangentStagingBufferData = m_allocator.bindStagingBuffer(m_tangentStagingBuffer, 0);
-	void* uvStagingBufferData = m_allocator.bindStagingBuffer(m_uvStagingBuffer, 0);
-	void* indexStagingBufferData = m_allocator.bindStagingBuffer(m_indexStagingBuffer, 0);
 	void* materialStagingBufferData = m_allocator.bindStagingBuffer(m_materialStagingBuffer, 0);
 	void* geometryStagingBufferData = m_allocator.bindStagingBuffer(m_geometryStagingBuffer, 0);
 	m_allocator.bindDeviceBuffer(m_vertexBuffer, 0);
 	m_allocator.bindDeviceBuffer(m_normalBuffer, 0);
-	m_allocator.bindDeviceBuffer(m_tangentBuffer, 0);
-	m_allocator.bindDeviceBuffer(m_uvBuffer, 0);
+	if (tangentDataSize)
+		m_allocator.bindDeviceBuffer(m_tangentBuffer, 0);
+	if (uvDataSize)
+		m_allocator.bindDeviceBuffer(m_uvBuffer, 0);
 	m_allocator.bindDeviceBuffer(m_indexBuffer, 0);
 	m_allocator.bindDeviceBuffer(m_materialBuffer, 0);
 	m_allocator.bindDeviceBuffer(m_geometryBuffer, 0);
 
-	/*	if (m_combinedImageSize > 4_GiB) {
-			stagingBufferCreateInfo.size = m_maxImageSize;
-		} else {*/
-	stagingBufferCreateInfo.size = m_combinedImageSize;
-	//}
-	verifyResult(vkCreateBuffer(m_device.device(), &stagingBufferCreateInfo, nullptr, &m_imageStagingBuffer));
-	void* imageStagingBufferData = m_allocator.bindStagingBuffer(m_imageStagingBuffer, 0);
-
-	// Copy vertex data
-
-	std::memcpy(vertexStagingBufferData, m_vertexData, vertexDataSize);
-	std::memcpy(normalStagingBufferData, m_normalData, normalDataSize);
-	std::memcpy(tangentStagingBufferData, m_tangentData, tangentDataSize);
-	std::memcpy(uvStagingBufferData, m_uvData, uvDataSize);
-	std::memcpy(indexStagingBufferData, m_indexData, indexDataSize);
-
 	// Copy material/geometry data
 
 	std::memcpy(materialStagingBufferData, m_materials.data(), m_materials.size() * sizeof(Material));
 	std::memcpy(geometryStagingBufferData, m_gpuGeometries.data(), m_gpuGeometries.size() * sizeof(GPUGeometry));
 
-	// Copy image data and prepare blits for mipmaps
+	// Geometry is uploaded first. The acceleration structure build waits for it on the GPU through m_uploadSemaphore
+	// while the textures are still streaming in.
 
-	std::vector<BlitImage> blitImages;
-	std::vector<VkBufferImageCopy> copies;
-	std::vector<VkImageMemoryBarrier> layoutTransferTransitionBarriers;
-	std::vector<VkImageMemoryBarrier> layoutSampledTransitionBarriers;
-	blitImages.reserve(m_textureImages.size());
-	copies.reserve(m_textureImages.size());
-	layoutTransferTransitionBarriers.reserve(m_textureImages.size());
-	layoutSampledTransitionBarriers.reserve(m_textureImages.size());
+	VkSemaphoreTypeCreateInfo semaphoreTypeCreateInfo = { .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+														  .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+														  .initialValue = 0 };
+	VkSemaphoreCreateInfo semaphoreCreateInfo = { .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+												  .pNext = &semaphoreTypeCreateInfo };
+	verifyResult(vkCreateSemaphore(m_device.device(), &semaphoreCreateInfo, nullptr, &m_uploadSemaphore));
+	setObjectName(m_device.device(), VK_OBJECT_TYPE_SEMAPHORE, m_uploadSemaphore, "Upload timeline semaphore");
 
-	size_t currentImageStagingOffset = 0;
-
-	for (auto& image : m_imageData) {
-		std::memcpy(reinterpret_cast<uint8_t*>(imageStagingBufferData) + currentImageStagingOffset, image.data,
-					image.size);
-		copies.push_back({ .bufferOffset = currentImageStagingOffset,
-						   .bufferRowLength = 0,
-						   .bufferImageHeight = 0,
-						   .imageSubresource = { .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-												 .mipLevel = 0,
-												 .baseArrayLayer = 0,
-												 .layerCount = 1 },
-						   .imageOffset = {},
-						   .imageExtent = { .width = static_cast<uint32_t>(image.width),
-											.height = static_cast<uint32_t>(image.height),
-											.depth = 1 } });
-		currentImageStagingOffset += image.size;
-		blitImages.push_back({ .width = image.width, .height = image.height });
-	}
-
-	size_t blitImageIndex = 0;
-	for (auto& image : m_textureImages) {
-		layoutTransferTransitionBarriers.push_back({ .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
-													 .srcAccessMask = VK_ACCESS_HOST_WRITE_BIT,
-													 .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
-													 .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-													 .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-													 .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-													 .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-													 .image = image,
-													 .subresourceRange = {
-														 .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-														 .baseMipLevel = 0,
-														 .levelCount = 1,
-														 .baseArrayLayer = 0,
-														 .layerCount = 1,
-													 } });
-		layoutSampledTransitionBarriers.push_back({ .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
-													.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
-													.dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
-													.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-													.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-													.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-													.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-													.image = image,
-													.subresourceRange = {
-														.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-														.baseMipLevel = 0,
-														.levelCount = 1,
-														.baseArrayLayer = 0,
-														.layerCount = 1,
-													} });
-		blitImages[blitImageIndex].image = image;
-		++blitImageIndex;
-	}
-
-	VkCommandBuffer commandBuffer = dispatcher.allocateOneTimeSubmitBuffers(1)[0];
+	VkCommandBuffer commandBuffer = m_transferDispatcher.allocateOneTimeSubmitBuffers(1)[0];
+	m_transferCommandBuffers.push_back(commandBuffer);
 
 	VkCommandBufferBeginInfo beginInfo = { .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
 										   .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT };
@@ -351,7 +708,8 @@ ModelLoader::ModelLoader(RayTracingDevice& device, MemoryAllocator& allocator, O
 	if (tangentDataSize)
 		vkCmdCopyBuffer(commandBuffer, m_tangentStagingBuffer, m_tangentBuffer, 1, &bufferCopy);
 	bufferCopy.size = uvDataSize;
-	vkCmdCopyBuffer(commandBuffer, m_uvStagingBuffer, m_uvBuffer, 1, &bufferCopy);
+	if (uvDataSize)
+		vkCmdCopyBuffer(commandBuffer, m_uvStagingBuffer, m_uvBuffer, 1, &bufferCopy);
 	bufferCopy.size = indexDataSize;
 	vkCmdCopyBuffer(commandBuffer, m_indexStagingBuffer, m_indexBuffer, 1, &bufferCopy);
 	bufferCopy.size = m_materials.size() * sizeof(Material);
@@ -359,127 +717,1023 @@ ModelLoader::ModelLoader(RayTracingDevice& device, MemoryAllocator& allocator, O
 	bufferCopy.size = m_gpuGeometries.size() * sizeof(GPUGeometry);
 	vkCmdCopyBuffer(commandBuffer, m_geometryStagingBuffer, m_geometryBuffer, 1, &bufferCopy);
 
-	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_HOST_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0,
-						 nullptr, layoutTransferTransitionBarriers.size(), layoutTransferTransitionBarriers.data());
+	if (m_device.hasDedicatedTransferQueue()) {
+		std::vector<VkBufferMemoryBarrier> releaseBarriers;
+		for (VkBuffer buffer : { m_vertexBuffer, m_normalBuffer, m_tangentBuffer, m_uvBuffer, m_indexBuffer,
+								 m_materialBuffer, m_geometryBuffer }) {
+			if (buffer == VK_NULL_HANDLE)
+				continue;
+			VkBufferMemoryBarrier barrier = { .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+											  .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+											  .dstAccessMask = 0,
+											  .srcQueueFamilyIndex = m_device.transferQueueFamilyIndex(),
+											  .dstQueueFamilyIndex = m_device.queueFamilyIndex(),
+											  .buffer = buffer,
+											  .offset = 0,
+											  .size = VK_WHOLE_SIZE };
+			releaseBarriers.push_back(barrier);
+			barrier.srcAccessMask = 0;
+			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			m_bufferAcquireBarriers.push_back(barrier);
+		}
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0,
+							 nullptr, static_cast<uint32_t>(releaseBarriers.size()), releaseBarriers.data(), 0,
+							 nullptr);
+	}
+
+	verifyResult(vkEndCommandBuffer(commandBuffer));
+
+	m_geometryUploadValue = 1;
+	m_textureUploadValue = m_geometryUploadValue + m_imageUploadChunks.size();
+	m_transferDispatcher.submit(commandBuffer, {}, m_uploadSemaphore, m_geometryUploadValue);
+
+	// Prepare image copies and blits for mipmaps
+
+	m_blitImages.reserve(m_textureImages.size());
+	m_imageCopies.reserve(m_textureImages.size());
+
+	// streamed images are uploaded by updateStreamedTextures instead
+	for (size_t i = 0; !streamTextures && i < m_imageData.size(); ++i) {
+		const ImageData& image = m_imageData[i];
+		uint32_t stagedLevels = isBlockCompressed(image.format) ? image.mipLevels : 1;
+		// relative to the start of the image, the slot offset is added once the chunk is recorded
+		size_t levelOffset = 0;
+		for (uint32_t level = 0; level < stagedLevels; ++level) {
+			uint32_t levelWidth = static_cast<uint32_t>(std::max(image.width >> level, 1));
+			uint32_t levelHeight = static_cast<uint32_t>(std::max(image.height >> level, 1));
+			m_imageCopies.push_back({ .bufferOffset = levelOffset,
+									  .bufferRowLength = 0,
+									  .bufferImageHeight = 0,
+									  .imageSubresource = { .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+															.mipLevel = level,
+															.baseArrayLayer = 0,
+															.layerCount = 1 },
+									  .imageOffset = {},
+									  .imageExtent = { .width = levelWidth, .height = levelHeight, .depth = 1 } });
+			levelOffset += imageLevelSize(image.format, levelWidth, levelHeight);
+		}
+
+		m_blitImages.push_back({ .image = m_textureImages[i],
+								 .width = image.width,
+								 .height = image.height,
+								 .mipLevels = image.mipLevels,
+								 .stagedLevels = stagedLevels });
+	}
+
+	// Everything but the texel data is known at this point, that is handed to the cache writer chunk by chunk as it is
+	// uploaded. The cache is written on its own thread so the disk never holds up the uploads.
+	if (cacheScene) {
+		m_sceneCacheWriter.emplace(sceneCachePath(sceneHash), sceneHash);
+		m_sceneCacheThread = std::thread(&ModelLoader::writeSceneCache, this);
+	}
+
+	// Without a dedicated transfer queue, the uploads share the main queue with the acceleration structure build and
+	// can't be submitted from another thread.
+	m_hasPendingUploads = true;
+	if (m_device.hasDedicatedTransferQueue()) {
+		m_textureUploadThread = std::thread(&ModelLoader::uploadTextures, this);
+	} else {
+		uploadTextures();
+	}
+
+	VkBufferDeviceAddressInfo addressInfo = { .sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO,
+											  .buffer = m_vertexBuffer };
+	m_vertexBufferDeviceAddress = vkGetBufferDeviceAddress(m_device.device(), &addressInfo);
+	addressInfo.buffer = m_indexBuffer;
+	m_indexBufferDeviceAddress = vkGetBufferDeviceAddress(m_device.device(), &addressInfo);
+
+	if (m_textures.size() > 0) {
+		uint32_t setCount = streamTextures ? frameInFlightCount : 1;
+		uint32_t textureCount = static_cast<uint32_t>(m_textures.size());
+
+		if constexpr (streamTextures) {
+			// the shaders' atomics stay in device memory, only the finished requests are copied to the host
+			VkBufferCreateInfo requestBufferCreateInfo = { .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+														   .size = textureCount * sizeof(uint32_t),
+														   .usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+																	VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+																	VK_BUFFER_USAGE_TRANSFER_DST_BIT };
+			VkBufferCreateInfo readbackBufferCreateInfo = { .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+															.size = textureCount * sizeof(uint32_t),
+															.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT };
+			for (uint32_t i = 0; i < frameInFlightCount; ++i) {
+				verifyResult(
+					vkCreateBuffer(m_device.device(), &requestBufferCreateInfo, nullptr, &m_textureRequestBuffers[i]));
+				verifyResult(vkCreateBuffer(m_device.device(), &readbackBufferCreateInfo, nullptr,
+											&m_textureRequestReadbackBuffers[i]));
+				setObjectName(m_device.device(), VK_OBJECT_TYPE_BUFFER, m_textureRequestBuffers[i],
+							  "Texture request buffer for frame " + std::to_string(i));
+				setObjectName(m_device.device(), VK_OBJECT_TYPE_BUFFER, m_textureRequestReadbackBuffers[i],
+							  "Texture request readback buffer for frame " + std::to_string(i));
+				m_allocator.bindDeviceBuffer(m_textureRequestBuffers[i], 0);
+				uint32_t* readbackData =
+					reinterpret_cast<uint32_t*>(m_allocator.bindReadbackBuffer(m_textureRequestReadbackBuffers[i], 0));
+				// nothing was copied back before the first frame, the request buffers are cleared every frame
+				std::fill_n(readbackData, textureCount, noTextureRequest);
+				m_textureRequestData[i] = readbackData;
+			}
+
+			// every frame in flight can upload up to one slot worth of images, at least one full size image
+			size_t maxStreamedImageSize = 0;
+			for (auto& image : m_imageData) {
+				maxStreamedImageSize = std::max(maxStreamedImageSize, streamedImageSize(image, 0));
+			}
+			m_streamingStagingSlotSize = std::max(imageStagingRingSize / frameInFlightCount, maxStreamedImageSize);
+			m_streamingStagingSlotSize =
+				(m_streamingStagingSlotSize + imageStagingAlignment - 1) & ~(imageStagingAlignment - 1);
+
+			VkBufferCreateInfo stagingBufferCreateInfo = { .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+														   .size = frameInFlightCount * m_streamingStagingSlotSize,
+														   .usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT };
+			verifyResult(
+				vkCreateBuffer(m_device.device(), &stagingBufferCreateInfo, nullptr, &m_streamingStagingBuffer));
+			setObjectName(m_device.device(), VK_OBJECT_TYPE_BUFFER, m_streamingStagingBuffer,
+						  "Texture streaming staging buffer");
+			m_streamingStagingData =
+				reinterpret_cast<unsigned char*>(m_allocator.bindStagingBuffer(m_streamingStagingBuffer, 0));
+
+			m_residentImageLevels.reserve(m_imageData.size());
+			for (auto& image : m_imageData) {
+				m_residentImageLevels.push_back(image.mipLevels);
+			}
+			m_textureResidency = TextureResidency(m_residentImageLevels, textureEvictionFrameCount);
+
+			m_textureStreamingThread = std::thread(&ModelLoader::decodeStreamedTextures, this);
+		}
+
+		VkDescriptorSetLayoutBinding bindings[2] = {
+			{ .binding = 0,
+			  .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+			  .descriptorCount = textureCount,
+			  .stageFlags = VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR | VK_SHADER_STAGE_ANY_HIT_BIT_KHR },
+			{ .binding = 1,
+			  .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			  .descriptorCount = 1,
+			  .stageFlags = VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR },
+		};
+
+		VkDescriptorSetLayoutCreateInfo layoutCreateInfo = {
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+			.bindingCount = streamTextures ? 2U : 1U,
+			.pBindings = bindings,
+		};
+		verifyResult(
+			vkCreateDescriptorSetLayout(m_device.device(), &layoutCreateInfo, nullptr, &m_textureDescriptorSetLayout));
+
+		VkDescriptorPoolSize poolSizes[2] = { { .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+												.descriptorCount = textureCount * setCount },
+											  { .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+												.descriptorCount = setCount } };
+		VkDescriptorPoolCreateInfo createInfo = { .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+												  .maxSets = setCount,
+												  .poolSizeCount = streamTextures ? 2U : 1U,
+												  .pPoolSizes = poolSizes };
+		verifyResult(vkCreateDescriptorPool(m_device.device(), &createInfo, nullptr, &m_textureDescriptorPool));
+
+		std::vector<VkDescriptorSetLayout> setLayouts = std::vector<VkDescriptorSetLayout>(
+			setCount, m_textureDescriptorSetLayout);
+		VkDescriptorSetAllocateInfo setAllocateInfo = { .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+														.descriptorPool = m_textureDescriptorPool,
+														.descriptorSetCount = setCount,
+														.pSetLayouts = setLayouts.data() };
+		verifyResult(vkAllocateDescriptorSets(m_device.device(), &setAllocateInfo, m_textureDescriptorSets));
+
+		setObjectName(m_device.device(), VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT, m_textureDescriptorSetLayout,
+					  "Texture descriptor set layout");
+		setObjectName(m_device.device(), VK_OBJECT_TYPE_DESCRIPTOR_POOL, m_textureDescriptorPool,
+					  "Texture descriptor pool");
+
+		// the images are only in the sampled layout after finishUploads(), which has to happen before rendering
+		std::vector<VkDescriptorImageInfo> textureImageInfos;
 
+		textureImageInfos.reserve(m_textures.size());
+
+		for (auto& texture : m_textures) {
+			textureImageInfos.push_back({ .sampler = texture.sampler,
+										  .imageView = texture.view,
+										  .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL });
+		}
+
+		for (uint32_t i = 0; i < setCount; ++i) {
+			setObjectName(m_device.device(), VK_OBJECT_TYPE_DESCRIPTOR_SET, m_textureDescriptorSets[i],
+						  "Texture descriptor set for frame " + std::to_string(i));
+
+			VkDescriptorBufferInfo requestBufferInfo = { .buffer = m_textureRequestBuffers[i],
+														 .offset = 0,
+														 .range = VK_WHOLE_SIZE };
+			VkWriteDescriptorSet setWrites[2] = { { .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+													.dstSet = m_textureDescriptorSets[i],
+													.dstBinding = 0,
+													.dstArrayElement = 0,
+													.descriptorCount = textureCount,
+													.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+													.pImageInfo = textureImageInfos.data() },
+												  { .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+													.dstSet = m_textureDescriptorSets[i],
+													.dstBinding = 1,
+													.dstArrayElement = 0,
+													.descriptorCount = 1,
+													.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+													.pBufferInfo = &requestBufferInfo } };
+			vkUpdateDescriptorSets(m_device.device(), streamTextures ? 2 : 1, setWrites, 0, nullptr);
+		}
+	}
+}
+
+void ModelLoader::uploadTextures() {
+	auto decodeStartTime = std::chrono::steady_clock::now();
+
+	std::vector<std::future<double>> imageDecodeTimes = std::vector<std::future<double>>(m_imageData.size());
+	std::vector<VkCommandBuffer> uploadCommandBuffers;
+	if (!m_imageUploadChunks.empty()) {
+		uploadCommandBuffers =
+			m_transferDispatcher.allocateOneTimeSubmitBuffers(static_cast<uint32_t>(m_imageUploadChunks.size()));
+	}
+
+	VkCommandBufferBeginInfo beginInfo = { .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+										   .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT };
+	std::vector<VkImageMemoryBarrier> imageBarriers;
+	// while caching, chunks are filled in host memory first, the cache writer can't read them from the staging ring
+	std::vector<std::vector<unsigned char>> cachedChunkTexels;
+	if (m_sceneCacheWriter)
+		cachedChunkTexels.resize(m_imageUploadChunks.size());
+
+	size_t filledChunkCount = 0;
 	size_t copyIndex = 0;
-	for (auto& image : m_textureImages) {
-		vkCmdCopyBufferToImage(commandBuffer, m_imageStagingBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1,
-							   &copies[copyIndex]);
-		++copyIndex;
+	for (size_t chunkIndex = 0; chunkIndex < m_imageUploadChunks.size(); ++chunkIndex) {
+		// start filling every slot that isn't waiting to be copied, a reused slot waits for the copy of its last chunk
+		for (; filledChunkCount < std::min(chunkIndex + m_imageStagingSlotCount, m_imageUploadChunks.size());
+			 ++filledChunkCount) {
+			if (filledChunkCount >= m_imageStagingSlotCount)
+				m_transferDispatcher.waitForFence(uploadCommandBuffers[filledChunkCount - m_imageStagingSlotCount],
+												  UINT64_MAX);
+
+			const ImageUploadChunk& chunk = m_imageUploadChunks[filledChunkCount];
+			unsigned char* slotData =
+				m_imageStagingData + (filledChunkCount % m_imageStagingSlotCount) * m_imageStagingSlotSize;
+			if (m_sceneCacheWriter) {
+				cachedChunkTexels[filledChunkCount].resize(chunk.size);
+				slotData = cachedChunkTexels[filledChunkCount].data();
+			}
+			for (size_t i = chunk.firstImageIndex; i < chunk.firstImageIndex + chunk.imageCount; ++i) {
+				ImageData& image = m_imageData[i];
+				unsigned char* destination = slotData + (image.stagingOffset - chunk.stagingOffset);
+				if (m_isSceneCached) {
+					const unsigned char* source =
+						reinterpret_cast<const unsigned char*>(m_sceneCache.section(SceneCacheSection::TexelData)) +
+						image.stagingOffset;
+					imageDecodeTimes[i] = m_threadPool.enqueue([&image, source, destination]() {
+						auto startTime = std::chrono::steady_clock::now();
+						std::memcpy(destination, source, image.size);
+						return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime)
+							.count();
+					});
+				} else {
+					imageDecodeTimes[i] =
+						m_threadPool.enqueue([&image, destination]() { return decodeImage(image, destination); });
+				}
+			}
+		}
+
+		// the slot must be completely written before submitting its copies
+		const ImageUploadChunk& chunk = m_imageUploadChunks[chunkIndex];
+		size_t slotOffset = (chunkIndex % m_imageStagingSlotCount) * m_imageStagingSlotSize;
+		for (size_t i = chunk.firstImageIndex; i < chunk.firstImageIndex + chunk.imageCount; ++i) {
+			double decodeTime = imageDecodeTimes[i].get();
+			printf("%s image %zu (%dx%d) in %f ms\n", m_isSceneCached ? "Copied cached" : "Decoded", i,
+				   m_imageData[i].width, m_imageData[i].height, decodeTime);
+		}
+		if (m_sceneCacheWriter) {
+			std::memcpy(m_imageStagingData + slotOffset, cachedChunkTexels[chunkIndex].data(), chunk.size);
+			// only a few chunks may wait for the writer, so a slow disk can't pile up every decoded image in memory
+			{
+				std::unique_lock<std::mutex> lock(m_sceneCacheMutex);
+				m_sceneCacheCondition.wait(lock,
+										   [this]() { return m_cachedTexelChunks.size() < imageStagingSlotCount; });
+				m_cachedTexelChunks.push_back(std::move(cachedChunkTexels[chunkIndex]));
+			}
+			m_sceneCacheCondition.notify_all();
+		}
+
+		VkCommandBuffer commandBuffer = uploadCommandBuffers[chunkIndex];
+		verifyResult(vkBeginCommandBuffer(commandBuffer, &beginInfo));
+
+		imageBarriers.clear();
+		for (size_t i = chunk.firstImageIndex; i < chunk.firstImageIndex + chunk.imageCount; ++i) {
+			imageBarriers.push_back({ .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+									  .srcAccessMask = VK_ACCESS_HOST_WRITE_BIT,
+									  .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+									  .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+									  .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+									  .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+									  .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+									  .image = m_blitImages[i].image,
+									  .subresourceRange = {
+										  .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+										  .baseMipLevel = 0,
+										  .levelCount = m_blitImages[i].mipLevels,
+										  .baseArrayLayer = 0,
+										  .layerCount = 1,
+									  } });
+		}
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_HOST_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr,
+							 0, nullptr, static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+
+		for (size_t i = chunk.firstImageIndex; i < chunk.firstImageIndex + chunk.imageCount; ++i) {
+			const BlitImage& blitImage = m_blitImages[i];
+			size_t imageSlotOffset = slotOffset + (m_imageData[i].stagingOffset - chunk.stagingOffset);
+			for (uint32_t level = 0; level < blitImage.stagedLevels; ++level) {
+				m_imageCopies[copyIndex + level].bufferOffset += imageSlotOffset;
+			}
+			vkCmdCopyBufferToImage(commandBuffer, m_imageStagingBuffer, blitImage.image,
+								   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, blitImage.stagedLevels,
+								   &m_imageCopies[copyIndex]);
+			copyIndex += blitImage.stagedLevels;
+		}
+
+		// hand the images over to the main queue, which generates the mip chains in finishUploads()
+		if (m_device.hasDedicatedTransferQueue()) {
+			for (auto& barrier : imageBarriers) {
+				barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+				barrier.dstAccessMask = 0;
+				barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+				barrier.srcQueueFamilyIndex = m_device.transferQueueFamilyIndex();
+				barrier.dstQueueFamilyIndex = m_device.queueFamilyIndex();
+			}
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+								 0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(imageBarriers.size()),
+								 imageBarriers.data());
+		}
+
+		verifyResult(vkEndCommandBuffer(commandBuffer));
+		m_transferDispatcher.submit(commandBuffer, {}, m_uploadSemaphore, m_geometryUploadValue + chunkIndex + 1);
+	}
+	if (!m_imageUploadChunks.empty()) {
+		printf("%s %zu images in %f ms\n", m_isSceneCached ? "Copied cached" : "Decoded", imageDecodeTimes.size(),
+			   std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - decodeStartTime).count());
+	}
+
+	m_transferCommandBuffers.insert(m_transferCommandBuffers.end(), uploadCommandBuffers.begin(),
+									uploadCommandBuffers.end());
+
+	if (m_sceneCacheWriter) {
+		{
+			std::lock_guard<std::mutex> lock(m_sceneCacheMutex);
+			m_hasCachedAllTexelChunks = true;
+		}
+		m_sceneCacheCondition.notify_all();
+	}
+}
+
+void ModelLoader::finishUploads() {
+	if (!m_hasPendingUploads)
+		return;
+	m_hasPendingUploads = false;
+
+	if (m_textureUploadThread.joinable())
+		m_textureUploadThread.join();
+
+	std::vector<VkImageMemoryBarrier> acquireBarriers;
+	std::vector<VkImageMemoryBarrier> layoutSampledTransitionBarriers;
+	acquireBarriers.reserve(m_blitImages.size());
+	layoutSampledTransitionBarriers.reserve(2 * m_blitImages.size());
+	uint32_t maxMipLevels = 1;
+
+	for (auto& blitImage : m_blitImages) {
+		if (blitImage.stagedLevels < blitImage.mipLevels)
+			maxMipLevels = std::max(maxMipLevels, blitImage.mipLevels);
+
+		if (m_device.hasDedicatedTransferQueue()) {
+			acquireBarriers.push_back({ .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+										.srcAccessMask = 0,
+										.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT,
+										.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+										.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+										.srcQueueFamilyIndex = m_device.transferQueueFamilyIndex(),
+										.dstQueueFamilyIndex = m_device.queueFamilyIndex(),
+										.image = blitImage.image,
+										.subresourceRange = {
+											.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+											.baseMipLevel = 0,
+											.levelCount = blitImage.mipLevels,
+											.baseArrayLayer = 0,
+											.layerCount = 1,
+										} });
+		}
+
+		// all levels but the last one were blit sources
+		bool hasBlitLevels = blitImage.stagedLevels < blitImage.mipLevels;
+		if (hasBlitLevels) {
+			layoutSampledTransitionBarriers.push_back({ .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+														.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+														.dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+														.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+														.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+														.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+														.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+														.image = blitImage.image,
+														.subresourceRange = {
+															.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+															.baseMipLevel = 0,
+															.levelCount = blitImage.mipLevels - 1,
+															.baseArrayLayer = 0,
+															.layerCount = 1,
+														} });
+		}
+		layoutSampledTransitionBarriers.push_back({ .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+													.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+													.dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+													.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+													.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+													.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+													.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+													.image = blitImage.image,
+													.subresourceRange = {
+														.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+														.baseMipLevel = hasBlitLevels ? blitImage.mipLevels - 1 : 0,
+														.levelCount = hasBlitLevels ? 1 : blitImage.mipLevels,
+														.baseArrayLayer = 0,
+														.layerCount = 1,
+													} });
+	}
+
+	if (!m_blitImages.empty()) {
+		VkCommandBuffer commandBuffer = m_dispatcher.allocateOneTimeSubmitBuffers(1)[0];
+
+		VkCommandBufferBeginInfo beginInfo = { .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+											   .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT };
+		verifyResult(vkBeginCommandBuffer(commandBuffer, &beginInfo));
+
+		if (!acquireBarriers.empty()) {
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0,
+								 nullptr, 0, nullptr, static_cast<uint32_t>(acquireBarriers.size()),
+								 acquireBarriers.data());
+		}
+
+		// Generate the mip chains level by level, so that all images share one barrier per level. Each level is blit
+		// from the previous one after that was transitioned to TRANSFER_SRC.
+		std::vector<VkImageMemoryBarrier> mipSourceBarriers;
+		mipSourceBarriers.reserve(m_blitImages.size());
+		for (uint32_t level = 1; level < maxMipLevels; ++level) {
+			mipSourceBarriers.clear();
+			for (auto& blitImage : m_blitImages) {
+				if (level < blitImage.stagedLevels || level >= blitImage.mipLevels)
+					continue;
+				mipSourceBarriers.push_back({ .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+											  .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+											  .dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+											  .oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+											  .newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+											  .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+											  .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+											  .image = blitImage.image,
+											  .subresourceRange = {
+												  .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+												  .baseMipLevel = level - 1,
+												  .levelCount = 1,
+												  .baseArrayLayer = 0,
+												  .layerCount = 1,
+											  } });
+			}
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0,
+								 nullptr, 0, nullptr, mipSourceBarriers.size(), mipSourceBarriers.data());
+
+			for (auto& blitImage : m_blitImages) {
+				if (level < blitImage.stagedLevels || level >= blitImage.mipLevels)
+					continue;
+				VkImageBlit blit = {
+					.srcSubresource = { .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+										.mipLevel = level - 1,
+										.baseArrayLayer = 0,
+										.layerCount = 1 },
+					.srcOffsets = { {},
+									{ .x = std::max(blitImage.width >> (level - 1), 1),
+									  .y = std::max(blitImage.height >> (level - 1), 1),
+									  .z = 1 } },
+					.dstSubresource = { .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+										.mipLevel = level,
+										.baseArrayLayer = 0,
+										.layerCount = 1 },
+					.dstOffsets = { {},
+									{ .x = std::max(blitImage.width >> level, 1),
+									  .y = std::max(blitImage.height >> level, 1),
+									  .z = 1 } },
+				};
+				vkCmdBlitImage(commandBuffer, blitImage.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, blitImage.image,
+							   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+			}
+		}
+
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+							 VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, 0, 0, nullptr, 0, nullptr,
+							 static_cast<uint32_t>(layoutSampledTransitionBarriers.size()),
+							 layoutSampledTransitionBarriers.data());
+
+		verifyResult(vkEndCommandBuffer(commandBuffer));
+
+		m_dispatcher.submit(commandBuffer,
+							{ { m_uploadSemaphore, m_textureUploadValue, VK_PIPELINE_STAGE_TRANSFER_BIT } },
+							VK_NULL_HANDLE, 0);
+		m_dispatcher.waitForFence(commandBuffer, UINT64_MAX);
+	}
+	if (streamTextures && !m_textures.empty()) {
+		// the placeholders are all that is sampled until the first requested images are uploaded
+		const unsigned char placeholderTexels[] = { 255, 255, 255, 255, 0, 0, 0, 255, 128, 128, 255, 255 };
+		std::memcpy(m_streamingStagingData, placeholderTexels, sizeof(placeholderTexels));
+
+		VkCommandBuffer commandBuffer = m_dispatcher.allocateOneTimeSubmitBuffers(1)[0];
+
+		VkCommandBufferBeginInfo beginInfo = { .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+											   .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT };
+		verifyResult(vkBeginCommandBuffer(commandBuffer, &beginInfo));
+
+		VkImageMemoryBarrier transferBarriers[static_cast<size_t>(PlaceholderTexture::Count)];
+		VkImageMemoryBarrier sampledBarriers[static_cast<size_t>(PlaceholderTexture::Count)];
+		for (size_t i = 0; i < static_cast<size_t>(PlaceholderTexture::Count); ++i) {
+			transferBarriers[i] = { .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+									.srcAccessMask = 0,
+									.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+									.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+									.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+									.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+									.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+									.image = m_placeholderImages[i],
+									.subresourceRange = {
+										.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+										.baseMipLevel = 0,
+										.levelCount = 1,
+										.baseArrayLayer = 0,
+										.layerCount = 1,
+									} };
+			sampledBarriers[i] = transferBarriers[i];
+			sampledBarriers[i].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			sampledBarriers[i].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			sampledBarriers[i].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			sampledBarriers[i].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		}
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0,
+							 nullptr, 0, nullptr, static_cast<uint32_t>(PlaceholderTexture::Count), transferBarriers);
+
+		for (size_t i = 0; i < static_cast<size_t>(PlaceholderTexture::Count); ++i) {
+			VkBufferImageCopy copy = { .bufferOffset = i * 4,
+									   .bufferRowLength = 0,
+									   .bufferImageHeight = 0,
+									   .imageSubresource = { .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+															 .mipLevel = 0,
+															 .baseArrayLayer = 0,
+															 .layerCount = 1 },
+									   .imageOffset = {},
+									   .imageExtent = { .width = 1, .height = 1, .depth = 1 } };
+			vkCmdCopyBufferToImage(commandBuffer, m_streamingStagingBuffer, m_placeholderImages[i],
+								   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy);
+		}
+
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+							 VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, 0, 0, nullptr, 0, nullptr,
+							 static_cast<uint32_t>(PlaceholderTexture::Count), sampledBarriers);
+
+		verifyResult(vkEndCommandBuffer(commandBuffer));
+
+		m_dispatcher.submit(commandBuffer, {}, VK_NULL_HANDLE, 0);
+		m_dispatcher.waitForFence(commandBuffer, UINT64_MAX);
+	}
+	// the transfers are all done by now, this only releases their fences
+	for (auto& commandBuffer : m_transferCommandBuffers) {
+		m_transferDispatcher.waitForFence(commandBuffer, UINT64_MAX);
+	}
+
+	printf("Loaded scene%s in %f ms\n", m_isSceneCached ? " from cache" : "",
+		   std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_loadStartTime).count());
+
+	// streamed images are decoded from the glTF buffers for as long as the loader exists
+	if constexpr (!streamTextures) {
+		for (auto& data : m_gltfData) {
+			cgltf_free(data);
+		}
+		m_gltfData.clear();
+	}
+
+	vkDestroyBuffer(m_device.device(), m_vertexStagingBuffer, nullptr);
+	vkDestroyBuffer(m_device.device(), m_normalStagingBuffer, nullptr);
+	if (m_tangentStagingBuffer != VK_NULL_HANDLE)
+		vkDestroyBuffer(m_device.device(), m_tangentStagingBuffer, nullptr);
+	if (m_uvStagingBuffer != VK_NULL_HANDLE)
+		vkDestroyBuffer(m_device.device(), m_uvStagingBuffer, nullptr);
+	vkDestroyBuffer(m_device.device(), m_indexStagingBuffer, nullptr);
+	vkDestroyBuffer(m_device.device(), m_materialStagingBuffer, nullptr);
+	vkDestroyBuffer(m_device.device(), m_geometryStagingBuffer, nullptr);
+	if (!m_imageUploadChunks.empty())
+		vkDestroyBuffer(m_device.device(), m_imageStagingBuffer, nullptr);
+}
+
+void ModelLoader::parseScenes(const std::vector<std::string_view>& gltfFilenames, std::vector<cgltf_data*>& gltfData,
+							  MappedFileReader& fileReader) {
+	// parsing and buffer loading of each file is independent, only the merge into the global index spaces isn't
+	std::vector<std::future<cgltf_result>> parseResults;
+	parseResults.reserve(gltfFilenames.size());
+	for (size_t i = 0; i < gltfFilenames.size(); ++i) {
+		parseResults.push_back(m_threadPool.enqueue([&gltfFilenames, &gltfData, &fileReader, i]() {
+			cgltf_options options = {};
+			fileReader.setFileCallbacks(options);
+			cgltf_result result = cgltf_parse_file(&options, gltfFilenames[i].data(), &gltfData[i]);
+			if (result == cgltf_result_success)
+				result = cgltf_load_buffers(&options, gltfData[i], gltfFilenames[i].data());
+			return result;
+		}));
+	}
+
+	size_t totalImageCount = 0;
+
+	// merge in command line order so that all indices match a serial load, later files keep loading meanwhile
+	for (size_t fileIndex = 0; fileIndex < gltfFilenames.size(); ++fileIndex) {
+		checkCGLTFResult(parseResults[fileIndex].get(), gltfFilenames[fileIndex]);
+		cgltf_data* data = gltfData[fileIndex];
+
+		if (data->scene) {
+			addScene(data, data->scene);
+		} else {
+			for (cgltf_size i = 0; i < data->scenes_count; ++i) {
+				addScene(data, data->scenes + i);
+			}
+		}
+
+		m_globalMeshIndexOffset += data->meshes_count;
+		totalImageCount += data->images_count;
+	}
+
+	m_textureImageNormalUsage.resize(totalImageCount);
+	m_textureImageAlbedoUsage.resize(totalImageCount);
+
+	if constexpr (weldVertices) {
+		weldGeometries();
+	}
+	computeGeometryBounds();
+	m_geometryPrimitives.clear();
+}
+
+void ModelLoader::weldGeometries() {
+	auto weldStartTime = std::chrono::steady_clock::now();
+
+	// geometries with the same attribute accessors share one welded mesh, each index accessor becomes one index list
+	std::map<std::array<const cgltf_accessor*, 4>, size_t> meshIndices;
+	std::vector<MeshAttributes> meshAttributes;
+	std::vector<std::vector<const cgltf_accessor*>> meshIndexAccessors;
+	m_weldedGeometries.resize(m_geometries.size(), { .meshIndex = invalidWeldedMesh });
+	for (size_t i = 0; i < m_geometries.size(); ++i) {
+		MeshAttributes attributes = primitiveAttributes(m_geometryPrimitives[i]);
+		if (!attributes.positions)
+			continue;
+
+		auto meshIterator =
+			meshIndices
+				.insert({ { attributes.positions, attributes.normals, attributes.tangents, attributes.texCoords },
+						  meshAttributes.size() })
+				.first;
+		if (meshIterator->second == meshAttributes.size()) {
+			meshAttributes.push_back(attributes);
+			meshIndexAccessors.emplace_back();
+		}
+
+		std::vector<const cgltf_accessor*>& indexAccessors = meshIndexAccessors[meshIterator->second];
+		const cgltf_accessor* indices = m_geometryPrimitives[i]->indices;
+		size_t indexListIndex =
+			std::find(indexAccessors.begin(), indexAccessors.end(), indices) - indexAccessors.begin();
+		if (indexListIndex == indexAccessors.size())
+			indexAccessors.push_back(indices);
+		m_weldedGeometries[i] = { .meshIndex = meshIterator->second, .indexListIndex = indexListIndex };
+	}
+
+	m_weldedMeshes.resize(meshAttributes.size());
+	std::vector<std::future<void>> weldJobs;
+	weldJobs.reserve(meshAttributes.size());
+	for (size_t i = 0; i < meshAttributes.size(); ++i) {
+		weldJobs.push_back(m_threadPool.enqueue([this, &meshAttributes, &meshIndexAccessors, i]() {
+			m_weldedMeshes[i] = weldMesh(meshAttributes[i], meshIndexAccessors[i]);
+		}));
+	}
+	for (auto& job : weldJobs) {
+		job.get();
+	}
+
+	// the stream sizes follow from the welded meshes now instead of the accessors
+	size_t sourceVertexCount = m_totalVertexCount;
+	m_totalVertexCount = m_totalNormalCount = m_totalTangentCount = m_totalUVCount = m_totalIndexCount = 0;
+	m_weldedMeshOffsets.resize(m_weldedMeshes.size());
+	for (size_t i = 0; i < m_weldedMeshes.size(); ++i) {
+		const WeldedMesh& mesh = m_weldedMeshes[i];
+		m_totalVertexCount += mesh.vertexCount;
+		if constexpr (interleavedVertexAttributes) {
+			bool hasShadingRecords = !mesh.normals.empty() || !mesh.tangents.empty() || !mesh.texCoords.empty();
+			m_totalNormalCount += hasShadingRecords ? mesh.vertexCount : 0;
+		} else {
+			m_totalNormalCount += mesh.normals.empty() ? 0 : mesh.vertexCount;
+			m_totalTangentCount += mesh.tangents.empty() ? 0 : mesh.vertexCount;
+			m_totalUVCount += mesh.texCoords.empty() ? 0 : mesh.vertexCount;
+		}
+
+		// welded indices are 32 bit, so they can be narrowed whenever the vertices fit
+		bool hasShortIndices = compactVertexAttributes && mesh.vertexCount <= std::numeric_limits<uint16_t>::max() + 1;
+		for (auto& indices : mesh.indices) {
+			// m_totalIndexCount counts uint32 words, short index ranges are padded to a whole word
+			m_totalIndexCount += hasShortIndices ? (indices.size() + 1) / 2 : indices.size();
+		}
+		m_weldedMeshOffsets[i].indexOffsets.resize(mesh.indices.size(), invalidWeldedMesh);
+	}
+
+	for (size_t i = 0; i < m_geometries.size(); ++i) {
+		if (m_weldedGeometries[i].meshIndex == invalidWeldedMesh) {
+			m_geometries[i].vertexCount = 0;
+			m_geometries[i].indexCount = 0;
+			continue;
+		}
+		const WeldedMesh& mesh = m_weldedMeshes[m_weldedGeometries[i].meshIndex];
+		m_geometries[i].vertexCount = mesh.vertexCount;
+		m_geometries[i].hasShortIndices =
+			compactVertexAttributes && mesh.vertexCount <= std::numeric_limits<uint16_t>::max() + 1;
+	}
+
+	printf("Welded %zu vertices into %zu (%zu meshes) in %f ms\n", sourceVertexCount, m_totalVertexCount,
+		   m_weldedMeshes.size(),
+		   std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - weldStartTime).count());
+}
+
+void ModelLoader::computeGeometryBounds() {
+	auto boundsStartTime = std::chrono::steady_clock::now();
+
+	// transforming every position of every instance is the expensive part, split it into roughly equal jobs
+	size_t totalVertexCount = 0;
+	for (auto& geometry : m_geometries) {
+		totalVertexCount += geometry.vertexCount;
+	}
+	size_t jobVertexCount = std::max(totalVertexCount / (4 * m_threadPool.threadCount()), size_t{ 1 });
+
+	std::vector<std::future<void>> boundsJobs;
+	size_t firstGeometryIndex = 0;
+	while (firstGeometryIndex < m_geometries.size()) {
+		size_t endGeometryIndex = firstGeometryIndex;
+		size_t vertexCount = 0;
+		while (endGeometryIndex < m_geometries.size() && vertexCount < jobVertexCount) {
+			vertexCount += m_geometries[endGeometryIndex++].vertexCount;
+		}
+
+		boundsJobs.push_back(m_threadPool.enqueue([this, firstGeometryIndex, endGeometryIndex]() {
+			std::vector<float> unpackedPositions;
+			for (size_t i = firstGeometryIndex; i < endGeometryIndex; ++i) {
+				m_geometries[i].aabb = {};
+				if (!m_geometries[i].vertexCount)
+					continue;
+
+				const float* positions;
+				if constexpr (weldVertices) {
+					positions = m_weldedMeshes[m_weldedGeometries[i].meshIndex].positions.data();
+				} else {
+					positions = accessorFloats(positionAccessor(m_geometryPrimitives[i]), 3, unpackedPositions);
+				}
+				m_geometries[i].aabb =
+					transformedBounds(positions, m_geometries[i].vertexCount, m_geometries[i].transformMatrix);
+			}
+		}));
+		firstGeometryIndex = endGeometryIndex;
 	}
 
-	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, 0,
-						 0, nullptr, 0, nullptr, layoutSampledTransitionBarriers.size(),
-						 layoutSampledTransitionBarriers.data());
-
-	verifyResult(vkEndCommandBuffer(commandBuffer));
+	for (auto& job : boundsJobs) {
+		job.get();
+	}
 
-	dispatcher.submit(commandBuffer, {});
-	dispatcher.waitForFence(commandBuffer, UINT64_MAX); // bad but �\_()_/�
+	for (auto& geometry : m_geometries) {
+		if (!geometry.vertexCount)
+			continue;
+		m_modelBounds.xmin = std::min(m_modelBounds.xmin, geometry.aabb.xmin);
+		m_modelBounds.ymin = std::min(m_modelBounds.ymin, geometry.aabb.ymin);
+		m_modelBounds.zmin = std::min(m_modelBounds.zmin, geometry.aabb.zmin);
+		m_modelBounds.xmax = std::max(m_modelBounds.xmax, geometry.aabb.xmax);
+		m_modelBounds.ymax = std::max(m_modelBounds.ymax, geometry.aabb.ymax);
+		m_modelBounds.zmax = std::max(m_modelBounds.zmax, geometry.aabb.zmax);
+	}
 
-	VkBufferDeviceAddressInfo addressInfo = { .sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO,
-											  .buffer = m_vertexBuffer };
-	m_vertexBufferDeviceAddress = vkGetBufferDeviceAddress(m_device.device(), &addressInfo);
-	addressInfo.buffer = m_indexBuffer;
-	m_indexBufferDeviceAddress = vkGetBufferDeviceAddress(m_device.device(), &addressInfo);
+	printf("Computed bounds of %zu geometries (%zu vertices) in %f ms\n", m_geometries.size(), totalVertexCount,
+		   std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - boundsStartTime).count());
+}
 
-	if (m_textures.size() > 0) {
-		VkDescriptorSetLayoutBinding binding = { .binding = 0,
-												 .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-												 .descriptorCount = static_cast<uint32_t>(m_textures.size()),
-												 .stageFlags = VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR |
-															   VK_SHADER_STAGE_ANY_HIT_BIT_KHR };
+void ModelLoader::copyScenes(const std::vector<std::string_view>& gltfFilenames,
+							 const std::vector<cgltf_data*>& gltfData) {
+	// the layout, order and number of geometries stays the same, so one can just increment a global counter in
+	// order to get the geometry for a given primitive
+	size_t geometryIndex = 0;
+	size_t gltfDataIndex = 0;
+	size_t sceneIndex = 0;
 
-		VkDescriptorSetLayoutCreateInfo layoutCreateInfo = {
-			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
-			.bindingCount = 1,
-			.pBindings = &binding,
-		};
-		verifyResult(
-			vkCreateDescriptorSetLayout(m_device.device(), &layoutCreateInfo, nullptr, &m_textureDescriptorSetLayout));
+	auto copyStartTime = std::chrono::steady_clock::now();
+	for (auto& gltfFilename : gltfFilenames) {
+		cgltf_data* data = gltfData[gltfDataIndex];
+		size_t sceneCount = data->scene ? 1 : data->scenes_count;
+		for (size_t i = 0; i < sceneCount; ++i) {
+			copySceneGeometries(data, m_sceneNodes[sceneIndex++], geometryIndex);
+		}
 
-		VkDescriptorPoolSize sampledImageSize = { .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-												  .descriptorCount = static_cast<uint32_t>(m_textures.size()) };
-		VkDescriptorPoolCreateInfo createInfo = { .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
-												  .maxSets = 1,
-												  .poolSizeCount = 1,
-												  .pPoolSizes = &sampledImageSize };
-		verifyResult(vkCreateDescriptorPool(m_device.device(), &createInfo, nullptr, &m_textureDescriptorPool));
+		for (cgltf_size i = 0; i < data->images_count; ++i) {
+			addImage(data, data->images + i, gltfFilename);
+		}
+		for (cgltf_size i = 0; i < data->samplers_count; ++i) {
+			addSampler(data, data->samplers + i);
+		}
+		for (cgltf_size i = 0; i < data->textures_count; ++i) {
+			addTexture(data, data->textures + i);
+		}
+		for (cgltf_size i = 0; i < data->materials_count; ++i) {
+			addMaterial(data, data->materials + i);
+		}
 
-		VkDescriptorSetAllocateInfo setAllocateInfo = { .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
-														.descriptorPool = m_textureDescriptorPool,
-														.descriptorSetCount = 1,
-														.pSetLayouts = &m_textureDescriptorSetLayout };
-		verifyResult(vkAllocateDescriptorSets(m_device.device(), &setAllocateInfo, &m_textureDescriptorSet));
+		m_globalMaterialIndexOffset += data->materials_count;
+		m_globalSamplerIndexOffset += data->samplers_count;
+		m_globalImageIndexOffset += data->images_count;
+		m_globalTextureIndexOffset += data->textures_count;
 
-		setObjectName(m_device.device(), VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT, m_textureDescriptorSetLayout,
-					  "Texture descriptor set layout");
-		setObjectName(m_device.device(), VK_OBJECT_TYPE_DESCRIPTOR_POOL, m_textureDescriptorPool,
-					  "Texture descriptor pool");
-		setObjectName(m_device.device(), VK_OBJECT_TYPE_DESCRIPTOR_SET, m_textureDescriptorSet,
-					  "Texture descriptor set");
-	}
-	for (auto& data : gltfData) {
-		cgltf_free(data);
-	}
-	for (auto& data : m_imageData) {
-		stbi_image_free(data.data);
+		++gltfDataIndex;
 	}
 
-	free(m_vertexData);
-	free(m_normalData);
-	free(m_tangentData);
-	free(m_uvData);
-	free(m_indexData);
+	printf("Copied %zu geometries (%zu unique accessors) in %f ms\n", m_geometries.size(), m_copiedAccessors.size(),
+		   std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - copyStartTime).count());
+	if (m_duplicateImageCount) {
+		printf("Merged %zu duplicate images, saving %zu bytes of texture memory\n", m_duplicateImageCount,
+			   m_duplicateImageSize);
+	}
 
-	vkDestroyBuffer(m_device.device(), m_vertexStagingBuffer, nullptr);
-	vkDestroyBuffer(m_device.device(), m_normalStagingBuffer, nullptr);
-	vkDestroyBuffer(m_device.device(), m_tangentStagingBuffer, nullptr);
-	vkDestroyBuffer(m_device.device(), m_uvStagingBuffer, nullptr);
-	vkDestroyBuffer(m_device.device(), m_indexStagingBuffer, nullptr);
-	vkDestroyBuffer(m_device.device(), m_imageStagingBuffer, nullptr);
+	// the welded vertex data is in the staging buffers now
+	m_weldedMeshes = {};
+	m_shadingRecordOffsets.clear();
+	m_sceneNodes = {};
+}
 
-	if (m_textures.size()) {
-		std::vector<VkDescriptorImageInfo> textureImageInfos;
+void ModelLoader::restoreSceneInfo(const SceneCacheReader& cache) {
+	const CachedSceneInfo* sceneInfo =
+		reinterpret_cast<const CachedSceneInfo*>(cache.section(SceneCacheSection::SceneInfo));
+	m_camera = sceneInfo->camera;
+	m_modelBounds = sceneInfo->modelBounds;
+	m_totalVertexCount = sceneInfo->vertexCount;
+	m_totalUVCount = sceneInfo->uvCount;
+	m_totalNormalCount = sceneInfo->normalCount;
+	m_totalTangentCount = sceneInfo->tangentCount;
+	m_totalIndexCount = sceneInfo->indexCount;
+	m_combinedImageSize = sceneInfo->combinedImageSize;
+
+	restoreSection(cache, SceneCacheSection::Geometries, m_geometries);
+	restoreSection(cache, SceneCacheSection::GPUGeometries, m_gpuGeometries);
+	restoreSection(cache, SceneCacheSection::MeshInstances, m_meshInstances);
+	restoreSection(cache, SceneCacheSection::Materials, m_materials);
+	restoreSection(cache, SceneCacheSection::Textures, m_textureSources);
+	restoreSection(cache, SceneCacheSection::Samplers, m_samplerCreateInfos);
+
+	for (auto& samplerCreateInfo : m_samplerCreateInfos) {
+		samplerCreateInfo.pNext = nullptr;
+
+		VkSampler resultSampler;
+		vkCreateSampler(m_device.device(), &samplerCreateInfo, nullptr, &resultSampler);
+		m_textureSamplers.push_back(resultSampler);
+	}
 
-		textureImageInfos.reserve(m_textures.size());
+	std::vector<CachedImage> images;
+	restoreSection(cache, SceneCacheSection::Images, images);
+	for (auto& image : images) {
+		m_imageData.push_back({ .encodedData = nullptr,
+								.encodedSize = 0,
+								.stagingOffset = image.stagingOffset,
+								.size = image.size,
+								.width = image.width,
+								.height = image.height,
+								.mipLevels = image.mipLevels,
+								.format = image.format });
+		m_maxImageSize = std::max(m_maxImageSize, image.size);
+	}
+}
 
-		for (auto& texture : m_textures) {
-			textureImageInfos.push_back({ .sampler = texture.sampler,
-										  .imageView = texture.view,
-										  .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL });
+void ModelLoader::writeSceneCache() {
+	SceneCacheWriter& writer = *m_sceneCacheWriter;
+
+	CachedSceneInfo sceneInfo = { .camera = m_camera,
+								  .modelBounds = m_modelBounds,
+								  .vertexCount = m_totalVertexCount,
+								  .uvCount = m_totalUVCount,
+								  .normalCount = m_totalNormalCount,
+								  .tangentCount = m_totalTangentCount,
+								  .indexCount = m_totalIndexCount,
+								  .combinedImageSize = m_combinedImageSize };
+	writer.writeSection(SceneCacheSection::SceneInfo, &sceneInfo, sizeof(CachedSceneInfo));
+
+	writer.writeSection(SceneCacheSection::Vertices, m_cachedVertices.data(), m_cachedVertices.size() * sizeof(float));
+	writer.writeSection(SceneCacheSection::UVs, m_cachedUVs.data(), m_cachedUVs.size());
+	writer.writeSection(SceneCacheSection::Normals, m_cachedNormals.data(), m_cachedNormals.size());
+	writer.writeSection(SceneCacheSection::Tangents, m_cachedTangents.data(), m_cachedTangents.size());
+	writer.writeSection(SceneCacheSection::Indices, m_cachedIndices.data(),
+						m_cachedIndices.size() * sizeof(uint32_t));
+	m_cachedVertices = {};
+	m_cachedUVs = {};
+	m_cachedNormals = {};
+	m_cachedTangents = {};
+	m_cachedIndices = {};
+
+	writer.writeSection(SceneCacheSection::Geometries, m_geometries.data(), m_geometries.size() * sizeof(Geometry));
+	writer.writeSection(SceneCacheSection::GPUGeometries, m_gpuGeometries.data(),
+						m_gpuGeometries.size() * sizeof(GPUGeometry));
+	writer.writeSection(SceneCacheSection::MeshInstances, m_meshInstances.data(),
+						m_meshInstances.size() * sizeof(MeshInstance));
+	writer.writeSection(SceneCacheSection::Materials, m_materials.data(), m_materials.size() * sizeof(Material));
+	writer.writeSection(SceneCacheSection::Samplers, m_samplerCreateInfos.data(),
+						m_samplerCreateInfos.size() * sizeof(VkSamplerCreateInfo));
+	writer.writeSection(SceneCacheSection::Textures, m_textureSources.data(),
+						m_textureSources.size() * sizeof(TextureSource));
+
+	std::vector<CachedImage> images;
+	images.reserve(m_imageData.size());
+	for (auto& image : m_imageData) {
+		images.push_back({ .stagingOffset = image.stagingOffset,
+						   .size = image.size,
+						   .width = image.width,
+						   .height = image.height,
+						   .mipLevels = image.mipLevels,
+						   .format = image.format });
+	}
+	writer.writeSection(SceneCacheSection::Images, images.data(), images.size() * sizeof(CachedImage));
+
+	writer.beginSection(SceneCacheSection::TexelData);
+	while (true) {
+		std::vector<unsigned char> texels;
+		{
+			std::unique_lock<std::mutex> lock(m_sceneCacheMutex);
+			m_sceneCacheCondition.wait(lock,
+									   [this]() { return !m_cachedTexelChunks.empty() || m_hasCachedAllTexelChunks; });
+			if (m_cachedTexelChunks.empty())
+				break;
+			texels = std::move(m_cachedTexelChunks.front());
+			m_cachedTexelChunks.pop_front();
 		}
+		m_sceneCacheCondition.notify_all();
+		writer.appendToSection(texels.data(), texels.size());
+	}
 
-		VkWriteDescriptorSet setWrite = { .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-										  .dstSet = m_textureDescriptorSet,
-										  .dstBinding = 0,
-										  .dstArrayElement = 0,
-										  .descriptorCount = static_cast<uint32_t>(m_textures.size()),
-										  .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-										  .pImageInfo = textureImageInfos.data() };
-		vkUpdateDescriptorSets(m_device.device(), 1, &setWrite, 0, nullptr);
+	if (writer.finish()) {
+		printf("Wrote scene cache %s\n", writer.path().c_str());
+	} else {
+		printf("Failed to write scene cache %s\n", writer.path().c_str());
 	}
 }
 
 ModelLoader::~ModelLoader() {
+	finishUploads();
+	if (m_sceneCacheThread.joinable())
+		m_sceneCacheThread.join();
+	if (m_textureStreamingThread.joinable()) {
+		{
+			std::lock_guard<std::mutex> lock(m_streamingMutex);
+			m_stopStreaming = true;
+		}
+		m_streamingCondition.notify_one();
+		m_textureStreamingThread.join();
+	}
+	for (auto& data : m_gltfData) {
+		cgltf_free(data);
+	}
+	if (m_uploadSemaphore != VK_NULL_HANDLE)
+		vkDestroySemaphore(m_device.device(), m_uploadSemaphore, nullptr);
+
 	vkDestroyBuffer(m_device.device(), m_vertexBuffer, nullptr);
 	vkDestroyBuffer(m_device.device(), m_normalBuffer, nullptr);
-	vkDestroyBuffer(m_device.device(), m_tangentBuffer, nullptr);
-	vkDestroyBuffer(m_device.device(), m_uvBuffer, nullptr);
+	if (m_tangentBuffer != VK_NULL_HANDLE)
+		vkDestroyBuffer(m_device.device(), m_tangentBuffer, nullptr);
+	if (m_uvBuffer != VK_NULL_HANDLE)
+		vkDestroyBuffer(m_device.device(), m_uvBuffer, nullptr);
 	vkDestroyBuffer(m_device.device(), m_indexBuffer, nullptr);
 
 	for (auto& view : m_textureImageViews) {
 		vkDestroyImageView(m_device.device(), view, nullptr);
 	}
-	for (auto& image : m_textureImages) {
-		vkDestroyImage(m_device.device(), image, nullptr);
+	for (size_t i = 0; i < m_textureImages.size(); ++i) {
+		vkDestroyImage(m_device.device(), m_textureImages[i], nullptr);
+		if (streamTextures && m_textureImages[i] != VK_NULL_HANDLE)
+			m_allocator.freePooledImage(m_textureImageAllocations[i]);
+	}
+	for (auto& image : m_retiredImages) {
+		vkDestroyImageView(m_device.device(), image.view, nullptr);
+		vkDestroyImage(m_device.device(), image.image, nullptr);
+		m_allocator.freePooledImage(image.allocation);
+	}
+	for (size_t i = 0; i < static_cast<size_t>(PlaceholderTexture::Count); ++i) {
+		vkDestroyImageView(m_device.device(), m_placeholderImageViews[i], nullptr);
+		vkDestroyImage(m_device.device(), m_placeholderImages[i], nullptr);
 	}
 	for (auto& sampler : m_textureSamplers) {
 		vkDestroySampler(m_device.device(), sampler, nullptr);
 	}
 	vkDestroySampler(m_device.device(), m_fallbackSampler, nullptr);
 
+	for (auto& buffer : m_textureRequestBuffers) {
+		vkDestroyBuffer(m_device.device(), buffer, nullptr);
+	}
+	for (auto& buffer : m_textureRequestReadbackBuffers) {
+		vkDestroyBuffer(m_device.device(), buffer, nullptr);
+	}
+	vkDestroyBuffer(m_device.device(), m_streamingStagingBuffer, nullptr);
+
 	if (m_textures.size()) {
 		vkDestroyDescriptorPool(m_device.device(), m_textureDescriptorPool, nullptr);
 		vkDestroyDescriptorSetLayout(m_device.device(), m_textureDescriptorSetLayout, nullptr);
@@ -487,83 +1741,41 @@ ModelLoader::~ModelLoader() {
 }
 
 void ModelLoader::addScene(cgltf_data* data, cgltf_scene* scene) {
-	for (cgltf_size i = 0; i < scene->nodes_count; ++i) {
-		glm::vec3 translation = glm::vec3(0.0f);
-		glm::quat rotation = glm::quat(0.0f, 0.0f, 0.0f, 1.0f);
-		glm::vec3 scale = glm::vec3(1.0f);
-		addNode(data, scene->nodes[i], translation, rotation, scale);
+	m_sceneNodes.push_back(flattenSceneNodes(scene, m_threadPool));
+	for (auto& node : m_sceneNodes.back()) {
+		addNode(data, node);
 	}
 }
 
-void ModelLoader::addNode(cgltf_data* data, cgltf_node* node, glm::vec3& translation, glm::quat& rotation,
-						  glm::vec3& scale) {
-	// local -> global transform
-	glm::vec3 localTranslation = translation;
-	glm::quat localRotation = glm::quat(0.0f, 0.0f, 0.0f, 1.0f);
-	glm::quat localRotationFlipped = glm::quat();
-	glm::vec3 localScale = scale;
-
-	// resolve child transforms and make global
-	if (node->has_scale) {
-		for (size_t i = 0; i < 3; ++i) {
-			localScale[i] *= node->scale[i];
-		}
-	}
-	if (node->has_translation) {
-		for (size_t i = 0; i < 3; ++i) {
-			localTranslation[i] += node->translation[i];
-		}
-	}
-	if (node->has_rotation) {
-		// multiply quaternions
-		// https://www.euclideanspace.com/maths/algebra/realNormedAlgebra/quaternions/arithmetic/index.htm
-		localRotation =
-			glm::quat(node->rotation[0], node->rotation[1], node->rotation[2], node->rotation[3]) * rotation;
-	}
+void ModelLoader::addNode(cgltf_data* data, const FlattenedNode& flattenedNode) {
+	const cgltf_node* node = flattenedNode.node;
 
-	glm::quat flipQuat = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+	glm::mat4 worldMatrix;
+	std::memcpy(&worldMatrix[0][0], flattenedNode.worldTransform, 16 * sizeof(float));
 
 	// clang-format off
-	glm::mat4 translationMatrix = glm::mat4( //only translation at first, becomes transform matrix through matrix multiplications
-		1.0f, 0.0f, 0.0f, 0.0f,
-		0.0f, 1.0f, 0.0f, 0.0f,
-		0.0f, 0.0f, 1.0f, 0.0f,
-		localTranslation[0], localTranslation[1], localTranslation[2], 1.0f
-	);
-
-	glm::mat4 scaleMatrix = glm::mat4(
-		localScale[0], 0.0f,		  0.0f,			 0.0f,
-		0.0f,		   localScale[1], 0.0f,		 0.0f,
-		0.0f,		   0.0f,		  localScale[2], 0.0f,
-		0.0f,		   0.0f,		  0.0f,			 1.0f
-	);
 	glm::mat4 coordinateScaleMatrix = glm::mat4(
 		1.0f,  0.0f, 0.0f, 0.0f,
 		0.0f, -1.0f, 0.0f, 0.0f,
 		0.0f,  0.0f, 1.0f, 0.0f,
 		0.0f,  0.0f, 0.0f, 1.0f
 	);
-
-	glm::mat4 noRotationTransformMatrix;
-	glm::mat4 noTranslationTransformMatrix;
-	glm::mat4 transformMatrix = glm::mat4(1.0f);
-	glm::mat4 normalTransformMatrix = coordinateScaleMatrix * glm::mat4(localRotation);
 	// clang-format on
-	noRotationTransformMatrix = coordinateScaleMatrix * (translationMatrix * scaleMatrix);
-	transformMatrix = coordinateScaleMatrix * (translationMatrix * glm::mat4(localRotation) * scaleMatrix);
 
-	if (node->camera && node->camera->type == cgltf_camera_type_perspective) {
-		glm::vec4 baseDirection = glm::vec4(0.0f, 0.0f, -1.0f, 0.0f);
-		baseDirection = glm::mat4(localRotation) * baseDirection;
+	glm::mat4 transformMatrix = coordinateScaleMatrix * worldMatrix;
+	// the inverse transpose keeps normals perpendicular under non-uniform scale
+	glm::mat4 normalTransformMatrix =
+		coordinateScaleMatrix * glm::mat4(glm::transpose(glm::inverse(glm::mat3(worldMatrix))));
 
-		glm::vec4 baseRight = glm::vec4(1.0f, 0.0f, 0.0f, 0.0f);
-		baseRight = glm::mat4(localRotation) * baseRight;
+	if (node->camera && node->camera->type == cgltf_camera_type_perspective) {
+		glm::vec3 baseDirection = glm::normalize(glm::mat3(worldMatrix) * glm::vec3(0.0f, 0.0f, -1.0f));
+		glm::vec3 baseRight = glm::normalize(glm::mat3(worldMatrix) * glm::vec3(1.0f, 0.0f, 0.0f));
 
 		m_camera = { .fov = node->camera->data.perspective.yfov, .znear = node->camera->data.perspective.znear };
 
 		std::memcpy(m_camera.direction, &baseDirection[0], 3 * sizeof(float));
 		std::memcpy(m_camera.right, &baseRight[0], 3 * sizeof(float));
-		std::memcpy(m_camera.position, &localTranslation[0], 3 * sizeof(float));
+		std::memcpy(m_camera.position, &worldMatrix[3][0], 3 * sizeof(float));
 
 		m_camera.position[2] = -m_camera.position[2];
 
@@ -575,7 +1787,10 @@ void ModelLoader::addNode(cgltf_data* data, cgltf_node* node, glm::vec3& transla
 	if (node->mesh) {
 		transformMatrix = glm::transpose(transformMatrix);
 		normalTransformMatrix = glm::transpose(normalTransformMatrix);
-		// TODO: this essentially de-instantiates meshes, so no instancing - maybe later?
+
+		// every node still gets its own geometries (for its transforms), but they all reference the same vertex data
+		// and the acceleration structure builder can share one BLAS between all instances of a mesh
+		size_t firstGeometryIndex = m_geometries.size();
 		for (cgltf_size i = 0; i < node->mesh->primitives_count; ++i) {
 			cgltf_primitive* primitive = node->mesh->primitives + i;
 
@@ -586,89 +1801,312 @@ void ModelLoader::addNode(cgltf_data* data, cgltf_node* node, glm::vec3& transla
 
 			Geometry geometry{};
 
-			glm::vec3 aabbMin, aabbMax;
-
 			for (cgltf_size j = 0; j < primitive->attributes_count; ++j) {
 				cgltf_attribute* attribute = primitive->attributes + j;
 
-				bool hasConsideredVertexAccessor =
-					std::find_if(m_copiedVertexDataAccessors.begin(), m_copiedVertexDataAccessors.end(),
-								 [attribute](const CopiedAccessor& accessor) {
-									 return attribute->data == accessor.accessor;
-								 }) != m_copiedVertexDataAccessors.end();
-
+				// accessors shared between primitives are only copied once, so they must only be counted once too
 				switch (attribute->type) {
 					case cgltf_attribute_type_position:
-						std::memcpy(&aabbMin[0], attribute->data->min, 3 * sizeof(float));
-						std::memcpy(&aabbMax[0], attribute->data->max, 3 * sizeof(float));
-
 						geometry.vertexCount = attribute->data->count;
 
-						if (!hasConsideredVertexAccessor)
+						if (m_countedAccessors.insert(attribute->data, AccessorUsage::Position, 0))
 							m_totalVertexCount += attribute->data->count;
 						break;
+					// interleaved shading records are counted per combination of accessors below
 					case cgltf_attribute_type_normal:
-						if (!hasConsideredVertexAccessor)
+						if (!interleavedVertexAttributes &&
+							m_countedAccessors.insert(attribute->data, AccessorUsage::Normal, 0))
 							m_totalNormalCount += attribute->data->count;
 						break;
 					case cgltf_attribute_type_tangent:
-						if (!hasConsideredVertexAccessor)
+						if (!interleavedVertexAttributes &&
+							m_countedAccessors.insert(attribute->data, AccessorUsage::Tangent, 0))
 							m_totalTangentCount += attribute->data->count;
 						break;
 					case cgltf_attribute_type_texcoord:
-						if (!hasConsideredVertexAccessor)
+						if (!interleavedVertexAttributes &&
+							m_countedAccessors.insert(attribute->data, AccessorUsage::TexCoord, 0))
 							m_totalUVCount += attribute->data->count;
 						break;
 				}
 			}
 
-			bool hasConsideredVertexAccessor =
-				std::find_if(m_copiedIndexDataAccessors.begin(), m_copiedIndexDataAccessors.end(),
-							 [primitive](const CopiedAccessor& accessor) {
-								 return primitive->indices == accessor.accessor;
-							 }) != m_copiedIndexDataAccessors.end();
-			if (!hasConsideredVertexAccessor) {
-				m_totalIndexCount += primitive->indices->count;
+			if constexpr (interleavedVertexAttributes) {
+				std::array<const cgltf_accessor*, 4> sources = shadingRecordSources(primitive);
+				if ((sources[1] || sources[2] || sources[3]) &&
+					m_shadingRecordOffsets.insert({ sources, std::nullopt }).second)
+					m_totalNormalCount += sources[0]->count;
 			}
 
-			geometry.indexCount = primitive->indices->count;
-
-			aabbMin = noRotationTransformMatrix * glm::vec4(aabbMin, 1.0f);
-			aabbMax = noRotationTransformMatrix * glm::vec4(aabbMax, 1.0f);
+			// 16-bit indices can address all vertices if the source already uses them, or if there are few enough
+			// vertices. The decision is stored per accessor so that all geometries sharing it agree on it.
+			bool hasShortIndices = compactVertexAttributes &&
+								   (primitive->indices->component_type != cgltf_component_type_r_32u ||
+									geometry.vertexCount <= std::numeric_limits<uint16_t>::max() + 1);
+			if (m_countedAccessors.insert(primitive->indices, AccessorUsage::Index, hasShortIndices)) {
+				// m_totalIndexCount counts uint32 words, short index ranges are padded to a whole word
+				m_totalIndexCount += hasShortIndices ? (primitive->indices->count + 1) / 2 : primitive->indices->count;
+			}
 
-			m_modelBounds.xmin = std::min(m_modelBounds.xmin, aabbMin[0]);
-			m_modelBounds.ymin = std::min(m_modelBounds.ymin, aabbMin[1]);
-			m_modelBounds.zmin = std::min(m_modelBounds.zmin, aabbMin[2]);
-			m_modelBounds.xmax = std::max(m_modelBounds.xmax, aabbMax[0]);
-			m_modelBounds.ymax = std::max(m_modelBounds.ymax, aabbMax[1]);
-			m_modelBounds.zmax = std::max(m_modelBounds.zmax, aabbMax[2]);
+			geometry.hasShortIndices = *m_countedAccessors.find(primitive->indices, AccessorUsage::Index);
 
-			geometry.aabb = { .xmin = aabbMin[0],
-							  .ymin = aabbMin[1],
-							  .zmin = aabbMin[2],
-							  .xmax = aabbMax[0],
-							  .ymax = aabbMax[1],
-							  .zmax = aabbMax[2] };
+			geometry.indexCount = primitive->indices->count;
 
 			std::memcpy(geometry.transformMatrix, &transformMatrix[0][0], 16 * sizeof(float));
 			std::memcpy(geometry.normalTransformMatrix, &normalTransformMatrix[0][0], 16 * sizeof(float));
 
 			m_geometries.push_back(std::move(geometry));
+			// welding and the bounds need the vertex data, they run once all scenes are parsed
+			m_geometryPrimitives.push_back(primitive);
+		}
+
+		if (m_geometries.size() > firstGeometryIndex) {
+			m_meshInstances.push_back(
+				{ .meshIndex = static_cast<uint32_t>(m_globalMeshIndexOffset + (node->mesh - data->meshes)),
+				  .firstGeometryIndex = static_cast<uint32_t>(firstGeometryIndex),
+				  .geometryCount = static_cast<uint32_t>(m_geometries.size() - firstGeometryIndex) });
+		}
+	}
+
+}
+
+void ModelLoader::copySceneGeometries(cgltf_data* data, const std::vector<FlattenedNode>& nodes,
+									  size_t& geometryIndex) {
+	// same order as addScene, so that every node finds its geometries at geometryIndex
+	for (auto& node : nodes) {
+		copyNodeGeometries(data, node.node, geometryIndex);
+	}
+}
+
+void ModelLoader::copyPrimitiveAccessors(cgltf_primitive* primitive, size_t currentGeometryIndex) {
+	// converted attributes that can't be passed to the compact encoders as they are stored in the glTF buffer
+	std::vector<float> unpackedAttributeData;
+
+	// start reading all streams of the primitive from the mapped files at once, instead of faulting them in
+	// one after another during the copies
+	for (cgltf_size j = 0; j < primitive->attributes_count; ++j) {
+		prefetchAccessor(primitive->attributes[j].data);
+	}
+	prefetchAccessor(primitive->indices);
+
+	for (cgltf_size j = 0; j < primitive->attributes_count; ++j) {
+		cgltf_attribute* attribute = primitive->attributes + j;
+		// the other attributes are written as shading records below
+		if (interleavedVertexAttributes && attribute->type != cgltf_attribute_type_position)
+			continue;
+
+		const size_t* copiedOffset;
+
+		switch (attribute->type) {
+			case cgltf_attribute_type_position:
+				copiedOffset = m_copiedAccessors.find(attribute->data, AccessorUsage::Position);
+				if (!copiedOffset) {
+					unpackAccessorFloats(attribute->data, 3,
+										 m_vertexData + (m_currentVertexDataOffset / sizeof(float)));
+
+					m_geometries[currentGeometryIndex].vertexOffset = m_currentVertexDataOffset;
+					m_copiedAccessors.insert(attribute->data, AccessorUsage::Position, m_currentVertexDataOffset);
+					m_currentVertexDataOffset += attribute->data->count * 3 * sizeof(float);
+				} else {
+					m_geometries[currentGeometryIndex].vertexOffset = *copiedOffset;
+				}
+				break;
+			case cgltf_attribute_type_normal:
+				copiedOffset = m_copiedAccessors.find(attribute->data, AccessorUsage::Normal);
+				if (!copiedOffset) {
+					uint8_t* dstData = m_normalData + m_currentNormalDataOffset;
+					if constexpr (compactVertexAttributes) {
+						const float* srcData = accessorFloats(attribute->data, 3, unpackedAttributeData);
+						encodeOctahedralNormals(srcData, attribute->data->count, reinterpret_cast<uint32_t*>(dstData));
+					} else {
+						unpackAccessorFloats(attribute->data, 3, reinterpret_cast<float*>(dstData));
+					}
+
+					m_geometries[currentGeometryIndex].normalOffset = m_currentNormalDataOffset;
+					m_copiedAccessors.insert(attribute->data, AccessorUsage::Normal, m_currentNormalDataOffset);
+					m_currentNormalDataOffset += attribute->data->count * normalStreamStride;
+				} else {
+					m_geometries[currentGeometryIndex].normalOffset = *copiedOffset;
+				}
+				break;
+			case cgltf_attribute_type_tangent:
+				copiedOffset = m_copiedAccessors.find(attribute->data, AccessorUsage::Tangent);
+				if (!copiedOffset) {
+					uint8_t* dstData = m_tangentData + m_currentTangentDataOffset;
+					if constexpr (compactVertexAttributes) {
+						const float* srcData = accessorFloats(attribute->data, 4, unpackedAttributeData);
+						encodeOctahedralTangents(srcData, attribute->data->count, reinterpret_cast<uint32_t*>(dstData));
+					} else {
+						unpackAccessorFloats(attribute->data, 4, reinterpret_cast<float*>(dstData));
+					}
+
+					m_geometries[currentGeometryIndex].tangentOffset = m_currentTangentDataOffset;
+					m_copiedAccessors.insert(attribute->data, AccessorUsage::Tangent, m_currentTangentDataOffset);
+					m_currentTangentDataOffset += attribute->data->count * tangentStreamStride;
+				} else {
+					m_geometries[currentGeometryIndex].tangentOffset = *copiedOffset;
+				}
+				break;
+			case cgltf_attribute_type_texcoord:
+				copiedOffset = m_copiedAccessors.find(attribute->data, AccessorUsage::TexCoord);
+				if (!copiedOffset) {
+					uint8_t* dstData = m_uvData + m_currentUVDataOffset;
+					if constexpr (compactVertexAttributes) {
+						const float* srcData = accessorFloats(attribute->data, 2, unpackedAttributeData);
+						encodeHalfFloats(srcData, attribute->data->count * 2, reinterpret_cast<uint16_t*>(dstData));
+					} else {
+						unpackAccessorFloats(attribute->data, 2, reinterpret_cast<float*>(dstData));
+					}
+
+					m_geometries[currentGeometryIndex].uvOffset = m_currentUVDataOffset;
+					m_copiedAccessors.insert(attribute->data, AccessorUsage::TexCoord, m_currentUVDataOffset);
+					m_currentUVDataOffset += attribute->data->count * uvStreamStride;
+				} else {
+					m_geometries[currentGeometryIndex].uvOffset = *copiedOffset;
+				}
+				break;
 		}
 	}
 
-	for (cgltf_size i = 0; i < node->children_count; ++i) {
-		addNode(data, node->children[i], localTranslation, localRotation, localScale);
+	if constexpr (interleavedVertexAttributes) {
+		auto recordOffset = m_shadingRecordOffsets.find(shadingRecordSources(primitive));
+		if (recordOffset != m_shadingRecordOffsets.end()) {
+			const std::array<const cgltf_accessor*, 4>& sources = recordOffset->first;
+			if (!recordOffset->second) {
+				std::vector<float> unpackedTangentData, unpackedTexCoordData;
+				const float* normals = sources[1] ? accessorFloats(sources[1], 3, unpackedAttributeData) : nullptr;
+				const float* tangents = sources[2] ? accessorFloats(sources[2], 4, unpackedTangentData) : nullptr;
+				const float* texCoords = sources[3] ? accessorFloats(sources[3], 2, unpackedTexCoordData) : nullptr;
+				encodeShadingRecords(normals, tangents, texCoords, sources[0]->count, compactVertexAttributes,
+									 m_normalData + m_currentNormalDataOffset);
+
+				recordOffset->second = m_currentNormalDataOffset;
+				m_currentNormalDataOffset += sources[0]->count * shadingRecordStride;
+			}
+			Geometry& geometry = m_geometries[currentGeometryIndex];
+			geometry.normalOffset = geometry.tangentOffset = geometry.uvOffset = *recordOffset->second;
+		}
+	}
+
+	const size_t* copiedIndexOffset = m_copiedAccessors.find(primitive->indices, AccessorUsage::Index);
+
+	if (!copiedIndexOffset) {
+		uint8_t* dstData = reinterpret_cast<uint8_t*>(m_indexData) + m_currentIndexDataOffset;
+		size_t wordCount;
+
+		if (m_geometries[currentGeometryIndex].hasShortIndices) {
+			// only chosen if all vertices are addressable with 16 bits
+			uint16_t* dstIndices = reinterpret_cast<uint16_t*>(dstData);
+			unpackAccessorShortIndices(primitive->indices, dstIndices);
+			wordCount = (primitive->indices->count + 1) / 2;
+			if (primitive->indices->count % 2) {
+				dstIndices[primitive->indices->count] = 0;
+			}
+		} else {
+			unpackAccessorIndices(primitive->indices, reinterpret_cast<uint32_t*>(dstData));
+			wordCount = primitive->indices->count;
+		}
+
+		m_geometries[currentGeometryIndex].indexOffset = m_currentIndexDataOffset;
+		m_copiedAccessors.insert(primitive->indices, AccessorUsage::Index, m_currentIndexDataOffset);
+		m_currentIndexDataOffset += wordCount * sizeof(uint32_t);
+	} else {
+		m_geometries[currentGeometryIndex].indexOffset = *copiedIndexOffset;
 	}
 }
 
-void ModelLoader::copySceneGeometries(cgltf_data* data, cgltf_scene* scene, size_t& geometryIndex) {
-	for (cgltf_size i = 0; i < scene->nodes_count; ++i) {
-		copyNodeGeometries(data, scene->nodes[i], geometryIndex);
+void ModelLoader::copyWeldedGeometry(size_t currentGeometryIndex) {
+	Geometry& geometry = m_geometries[currentGeometryIndex];
+	const WeldedGeometry& weldedGeometry = m_weldedGeometries[currentGeometryIndex];
+	if (weldedGeometry.meshIndex == invalidWeldedMesh)
+		return;
+	const WeldedMesh& mesh = m_weldedMeshes[weldedGeometry.meshIndex];
+	WeldedMeshOffsets& offsets = m_weldedMeshOffsets[weldedGeometry.meshIndex];
+
+	// the streams are shared by all geometries using the mesh, only the index lists differ
+	if (!offsets.isCopied) {
+		offsets.vertexOffset = m_currentVertexDataOffset;
+		std::memcpy(m_vertexData + (m_currentVertexDataOffset / sizeof(float)), mesh.positions.data(),
+					mesh.vertexCount * 3 * sizeof(float));
+		m_currentVertexDataOffset += mesh.vertexCount * 3 * sizeof(float);
+
+		if constexpr (interleavedVertexAttributes) {
+			if (!mesh.normals.empty() || !mesh.tangents.empty() || !mesh.texCoords.empty()) {
+				offsets.normalOffset = offsets.tangentOffset = offsets.uvOffset = m_currentNormalDataOffset;
+				encodeShadingRecords(mesh.normals.empty() ? nullptr : mesh.normals.data(),
+									 mesh.tangents.empty() ? nullptr : mesh.tangents.data(),
+									 mesh.texCoords.empty() ? nullptr : mesh.texCoords.data(), mesh.vertexCount,
+									 compactVertexAttributes, m_normalData + m_currentNormalDataOffset);
+				m_currentNormalDataOffset += mesh.vertexCount * shadingRecordStride;
+			}
+		} else {
+			if (!mesh.normals.empty()) {
+				offsets.normalOffset = m_currentNormalDataOffset;
+				uint8_t* dstData = m_normalData + m_currentNormalDataOffset;
+				if constexpr (compactVertexAttributes) {
+					encodeOctahedralNormals(mesh.normals.data(), mesh.vertexCount,
+											reinterpret_cast<uint32_t*>(dstData));
+				} else {
+					std::memcpy(dstData, mesh.normals.data(), mesh.vertexCount * normalStreamStride);
+				}
+				m_currentNormalDataOffset += mesh.vertexCount * normalStreamStride;
+			}
+			if (!mesh.tangents.empty()) {
+				offsets.tangentOffset = m_currentTangentDataOffset;
+				uint8_t* dstData = m_tangentData + m_currentTangentDataOffset;
+				if constexpr (compactVertexAttributes) {
+					encodeOctahedralTangents(mesh.tangents.data(), mesh.vertexCount,
+											 reinterpret_cast<uint32_t*>(dstData));
+				} else {
+					std::memcpy(dstData, mesh.tangents.data(), mesh.vertexCount * tangentStreamStride);
+				}
+				m_currentTangentDataOffset += mesh.vertexCount * tangentStreamStride;
+			}
+			if (!mesh.texCoords.empty()) {
+				offsets.uvOffset = m_currentUVDataOffset;
+				uint8_t* dstData = m_uvData + m_currentUVDataOffset;
+				if constexpr (compactVertexAttributes) {
+					encodeHalfFloats(mesh.texCoords.data(), mesh.vertexCount * 2,
+									 reinterpret_cast<uint16_t*>(dstData));
+				} else {
+					std::memcpy(dstData, mesh.texCoords.data(), mesh.vertexCount * uvStreamStride);
+				}
+				m_currentUVDataOffset += mesh.vertexCount * uvStreamStride;
+			}
+		}
+		offsets.isCopied = true;
+	}
+
+	size_t& indexOffset = offsets.indexOffsets[weldedGeometry.indexListIndex];
+	if (indexOffset == invalidWeldedMesh) {
+		const std::vector<uint32_t>& indices = mesh.indices[weldedGeometry.indexListIndex];
+		uint8_t* dstData = reinterpret_cast<uint8_t*>(m_indexData) + m_currentIndexDataOffset;
+		size_t wordCount;
+		if (geometry.hasShortIndices) {
+			uint16_t* dstIndices = reinterpret_cast<uint16_t*>(dstData);
+			for (size_t i = 0; i < indices.size(); ++i) {
+				dstIndices[i] = static_cast<uint16_t>(indices[i]);
+			}
+			wordCount = (indices.size() + 1) / 2;
+			if (indices.size() % 2) {
+				dstIndices[indices.size()] = 0;
+			}
+		} else {
+			std::memcpy(dstData, indices.data(), indices.size() * sizeof(uint32_t));
+			wordCount = indices.size();
+		}
+		indexOffset = m_currentIndexDataOffset;
+		m_currentIndexDataOffset += wordCount * sizeof(uint32_t);
 	}
+
+	geometry.vertexOffset = offsets.vertexOffset;
+	geometry.normalOffset = offsets.normalOffset;
+	geometry.tangentOffset = offsets.tangentOffset;
+	geometry.uvOffset = offsets.uvOffset;
+	geometry.indexOffset = indexOffset;
 }
 
-void ModelLoader::copyNodeGeometries(cgltf_data* data, cgltf_node* node, size_t& currentGeometryIndex) {
+void ModelLoader::copyNodeGeometries(cgltf_data* data, const cgltf_node* node, size_t& currentGeometryIndex) {
 	if (node->mesh) {
 		for (cgltf_size i = 0; i < node->mesh->primitives_count; ++i) {
 			cgltf_primitive* primitive = node->mesh->primitives + i;
@@ -677,114 +2115,10 @@ void ModelLoader::copyNodeGeometries(cgltf_data* data, cgltf_node* node, size_t&
 				continue;
 			}
 
-			for (cgltf_size j = 0; j < primitive->attributes_count; ++j) {
-				cgltf_attribute* attribute = primitive->attributes + j;
-
-				auto vertexAccessorIterator = std::find_if(
-					m_copiedVertexDataAccessors.begin(), m_copiedVertexDataAccessors.end(),
-					[attribute](const CopiedAccessor& accessor) { return attribute->data == accessor.accessor; });
-				bool hasConsideredVertexAccessor = vertexAccessorIterator != m_copiedVertexDataAccessors.end();
-
-				switch (attribute->type) {
-					case cgltf_attribute_type_position:
-						if (!hasConsideredVertexAccessor) {
-							std::memcpy(m_vertexData + (m_currentVertexDataOffset / sizeof(float)),
-										reinterpret_cast<uint8_t*>(attribute->data->buffer_view->buffer->data) +
-											attribute->data->buffer_view->offset + attribute->data->offset,
-										attribute->data->count * 3 * sizeof(float));
-
-							m_geometries[currentGeometryIndex].vertexOffset = m_currentVertexDataOffset;
-							m_copiedVertexDataAccessors.push_back({ attribute->data, m_currentVertexDataOffset });
-							m_currentVertexDataOffset += attribute->data->count * 3 * sizeof(float);
-						} else {
-							m_geometries[currentGeometryIndex].vertexOffset += vertexAccessorIterator->bufferOffset;
-						}
-						break;
-					case cgltf_attribute_type_normal:
-						if (!hasConsideredVertexAccessor) {
-							std::memcpy(m_normalData + (m_currentNormalDataOffset / sizeof(float)),
-										reinterpret_cast<uint8_t*>(attribute->data->buffer_view->buffer->data) +
-											attribute->data->buffer_view->offset + attribute->data->offset,
-										attribute->data->count * 3 * sizeof(float));
-
-							m_geometries[currentGeometryIndex].normalOffset = m_currentNormalDataOffset;
-							m_copiedVertexDataAccessors.push_back({ attribute->data, m_currentNormalDataOffset });
-							m_currentNormalDataOffset += attribute->data->count * 3 * sizeof(float);
-						} else {
-							m_geometries[currentGeometryIndex].normalOffset += vertexAccessorIterator->bufferOffset;
-						}
-						break;
-					case cgltf_attribute_type_tangent:
-						if (!hasConsideredVertexAccessor) {
-							std::memcpy(m_tangentData + (m_currentTangentDataOffset / sizeof(float)),
-										reinterpret_cast<uint8_t*>(attribute->data->buffer_view->buffer->data) +
-											attribute->data->buffer_view->offset + attribute->data->offset,
-										attribute->data->count * 4 * sizeof(float));
-
-							m_geometries[currentGeometryIndex].tangentOffset = m_currentTangentDataOffset;
-							m_copiedVertexDataAccessors.push_back({ attribute->data, m_currentTangentDataOffset });
-							m_currentTangentDataOffset += attribute->data->count * 4 * sizeof(float);
-						} else {
-							m_geometries[currentGeometryIndex].tangentOffset += vertexAccessorIterator->bufferOffset;
-						}
-						break;
-					case cgltf_attribute_type_texcoord:
-						if (!hasConsideredVertexAccessor) {
-							std::memcpy(m_uvData + (m_currentUVDataOffset / sizeof(float)),
-										reinterpret_cast<uint8_t*>(attribute->data->buffer_view->buffer->data) +
-											attribute->data->buffer_view->offset + attribute->data->offset,
-										attribute->data->count * 2 * sizeof(float));
-
-							m_geometries[currentGeometryIndex].uvOffset = m_currentUVDataOffset;
-							m_copiedVertexDataAccessors.push_back({ attribute->data, m_currentUVDataOffset });
-							m_currentUVDataOffset += attribute->data->count * 2 * sizeof(float);
-						} else {
-							m_geometries[currentGeometryIndex].uvOffset += vertexAccessorIterator->bufferOffset;
-						}
-						break;
-				}
-			}
-
-			auto indexAccessorIterator = std::find_if(
-				m_copiedIndexDataAccessors.begin(), m_copiedIndexDataAccessors.end(),
-				[primitive](const CopiedAccessor& accessor) { return primitive->indices == accessor.accessor; });
-			bool hasConsideredIndexAccessor = indexAccessorIterator != m_copiedIndexDataAccessors.end();
-
-			if (!hasConsideredIndexAccessor) {
-				if (primitive->indices->component_type != cgltf_component_type_r_32u) {
-					uint32_t* dstData =
-						reinterpret_cast<uint32_t*>(m_indexData + (m_currentIndexDataOffset / sizeof(float)));
-					switch (primitive->indices->component_type) {
-						case cgltf_component_type_r_8u: {
-							uint8_t* srcData =
-								reinterpret_cast<uint8_t*>(primitive->indices->buffer_view->buffer->data) +
-								primitive->indices->buffer_view->offset + primitive->indices->offset;
-							for (cgltf_size i = 0; i < primitive->indices->count; ++i) {
-								dstData[i] = srcData[i]; // convert uint8 to uint32
-							}
-						} break;
-						case cgltf_component_type_r_16u: {
-							uint16_t* srcData = reinterpret_cast<uint16_t*>(
-								reinterpret_cast<uint8_t*>(primitive->indices->buffer_view->buffer->data) +
-								primitive->indices->buffer_view->offset +
-								primitive->indices
-									->offset); // convert to uint8*, offset by byte count, then convert to uint16*
-							for (cgltf_size i = 0; i < primitive->indices->count; ++i) {
-								dstData[i] = srcData[i]; // convert uint16 to uint32
-							}
-						} break;
-					}
-				} else
-					std::memcpy(m_indexData + (m_currentIndexDataOffset / sizeof(float)),
-								reinterpret_cast<char*>(primitive->indices->buffer_view->buffer->data) +
-									primitive->indices->buffer_view->offset + primitive->indices->offset,
-								primitive->indices->count * sizeof(uint32_t));
-
-				m_geometries[currentGeometryIndex].indexOffset = m_currentIndexDataOffset;
-				m_copiedIndexDataAccessors.push_back({ primitive->indices, m_currentIndexDataOffset });
-				m_currentIndexDataOffset += primitive->indices->count * sizeof(uint32_t);
+			if constexpr (weldVertices) {
+				copyWeldedGeometry(currentGeometryIndex);
 			} else {
-				m_geometries[currentGeometryIndex].indexOffset = indexAccessorIterator->bufferOffset;
+				copyPrimitiveAccessors(primitive, currentGeometryIndex);
 			}
 
 			if (primitive->material) {
@@ -792,6 +2126,11 @@ void ModelLoader::copyNodeGeometries(cgltf_data* data, cgltf_node* node, size_t&
 					m_textureImageNormalUsage[primitive->material->normal_texture.texture->image - data->images +
 											  m_globalImageIndexOffset] = true;
 				}
+				if (primitive->material->pbr_metallic_roughness.base_color_texture.texture) {
+					m_textureImageAlbedoUsage[primitive->material->pbr_metallic_roughness.base_color_texture.texture
+												  ->image -
+											  data->images + m_globalImageIndexOffset] = true;
+				}
 				m_geometries[currentGeometryIndex].materialIndex =
 					primitive->material - data->materials +
 					m_globalMaterialIndexOffset; // sure hope the material is in that array, otherwise bad stuff ensues
@@ -800,17 +2139,42 @@ void ModelLoader::copyNodeGeometries(cgltf_data* data, cgltf_node* node, size_t&
 					primitive->material->alpha_mode != cgltf_alpha_mode_opaque;
 			}
 
+			auto texelDensityIterator = m_objectTexelDensityLods.find(primitive->indices);
+			if (texelDensityIterator == m_objectTexelDensityLods.end()) {
+				const cgltf_accessor* positions = nullptr;
+				const cgltf_accessor* texCoords = nullptr;
+				for (cgltf_size j = 0; j < primitive->attributes_count; ++j) {
+					if (primitive->attributes[j].type == cgltf_attribute_type_position)
+						positions = primitive->attributes[j].data;
+					else if (primitive->attributes[j].type == cgltf_attribute_type_texcoord && !texCoords)
+						texCoords = primitive->attributes[j].data;
+				}
+				texelDensityIterator =
+					m_objectTexelDensityLods
+						.insert({ primitive->indices, objectTexelDensityLod(positions, texCoords, primitive->indices) })
+						.first;
+			}
+			// world space areas scale with the transform's determinant to the power of 2/3
+			glm::mat4 transformMatrix;
+			std::memcpy(&transformMatrix[0][0], m_geometries[currentGeometryIndex].transformMatrix, 16 * sizeof(float));
+			float transformDeterminant = std::abs(glm::determinant(glm::mat3(transformMatrix)));
+			float texelDensityLod = texelDensityIterator->second;
+			if (transformDeterminant > 0.0f)
+				texelDensityLod -= std::log2(transformDeterminant) / 3.0f;
+
 			m_gpuGeometries.push_back(
 				{ .vertexOffset =
 					  static_cast<uint32_t>(m_geometries[currentGeometryIndex].vertexOffset / (sizeof(float) * 3)),
-				  .uvOffset = static_cast<uint32_t>(m_geometries[currentGeometryIndex].uvOffset / (sizeof(float) * 2)),
+				  .uvOffset = static_cast<uint32_t>(m_geometries[currentGeometryIndex].uvOffset / uvStreamStride),
 				  .normalOffset =
-					  static_cast<uint32_t>(m_geometries[currentGeometryIndex].normalOffset / (sizeof(float) * 3)),
+					  static_cast<uint32_t>(m_geometries[currentGeometryIndex].normalOffset / normalStreamStride),
 				  .tangentOffset =
-					  static_cast<uint32_t>(m_geometries[currentGeometryIndex].tangentOffset / (sizeof(float) * 4)),
+					  static_cast<uint32_t>(m_geometries[currentGeometryIndex].tangentOffset / tangentStreamStride),
 				  .indexOffset =
 					  static_cast<uint32_t>(m_geometries[currentGeometryIndex].indexOffset / sizeof(uint32_t)),
-				  .materialIndex = static_cast<uint32_t>(m_geometries[currentGeometryIndex].materialIndex) });
+				  .materialIndex = static_cast<uint32_t>(m_geometries[currentGeometryIndex].materialIndex),
+				  .hasShortIndices = m_geometries[currentGeometryIndex].hasShortIndices,
+				  .texelDensityLod = texelDensityLod });
 			float normalTransform[9] = { m_geometries[currentGeometryIndex].normalTransformMatrix[0],
 										 m_geometries[currentGeometryIndex].normalTransformMatrix[4],
 										 m_geometries[currentGeometryIndex].normalTransformMatrix[8],
@@ -824,10 +2188,6 @@ void ModelLoader::copyNodeGeometries(cgltf_data* data, cgltf_node* node, size_t&
 			++currentGeometryIndex;
 		}
 	}
-
-	for (cgltf_size i = 0; i < node->children_count; ++i) {
-		copyNodeGeometries(data, node->children[i], currentGeometryIndex);
-	}
 }
 
 void ModelLoader::addMaterial(cgltf_data* data, cgltf_material* material) {
@@ -886,48 +2246,114 @@ void ModelLoader::addMaterial(cgltf_data* data, cgltf_material* material) {
 }
 
 void ModelLoader::addTexture(cgltf_data* data, cgltf_texture* texture) {
-	Texture newTexture;
+	// image views are created after all images are known, the actual textures are created once they exist
+	TextureSource newTexture;
+	newTexture.imageIndex = m_imageIndexRemap[texture->image - data->images + m_globalImageIndexOffset];
 	if (!texture->sampler) {
-		newTexture.sampler = m_fallbackSampler;
+		newTexture.samplerIndex = ~0U;
 	} else {
-		newTexture.sampler = m_textureSamplers[texture->sampler - data->samplers + m_globalSamplerIndexOffset];
+		newTexture.samplerIndex = static_cast<uint32_t>(texture->sampler - data->samplers + m_globalSamplerIndexOffset);
 	}
 
-	newTexture.view = m_textureImageViews[texture->image - data->images + m_globalImageIndexOffset];
-
-	m_textures.push_back(std::move(newTexture));
+	m_textureSources.push_back(newTexture);
 }
 
 void ModelLoader::addImage(cgltf_data* data, cgltf_image* image, const std::string_view& gltfPath) {
-	ImageData imageData;
-	int numChannels = 4;
+	// only the header is read here, decoding happens on the thread pool once all staging slots are known
+	ImageData imageData = {};
+	int numChannels;
+	int infoResult = 0;
 	if (image->buffer_view) {
-		imageData.data = stbi_load_from_memory(
-			reinterpret_cast<stbi_uc*>(image->buffer_view->buffer->data) + image->buffer_view->offset,
-			image->buffer_view->size, &imageData.width, &imageData.height, &numChannels, numChannels);
-		imageData.size = image->buffer_view->size;
-
-	} else {
+		imageData.encodedData =
+			reinterpret_cast<const unsigned char*>(image->buffer_view->buffer->data) + image->buffer_view->offset;
+		imageData.encodedSize = image->buffer_view->size;
+		infoResult = stbi_info_from_memory(imageData.encodedData, static_cast<int>(imageData.encodedSize),
+										   &imageData.width, &imageData.height, &numChannels);
+	} else if (image->uri) {
 		std::filesystem::path path = std::filesystem::path(gltfPath);
 		std::string directoryString = path.parent_path().string();
 		directoryString.push_back(static_cast<char>(std::filesystem::path::preferred_separator));
-		imageData.data = stbi_load((directoryString + image->uri).c_str(), &imageData.width, &imageData.height,
-								   &numChannels, numChannels);
-		imageData.size = imageData.width * imageData.height * 4;
+		imageData.path = directoryString + image->uri;
+		infoResult = stbi_info(imageData.path.c_str(), &imageData.width, &imageData.height, &numChannels);
+	}
+
+	if (!infoResult) {
+		printf("Could not read image %s, using a white 1x1 image instead.\n", image->uri ? image->uri : "<embedded>");
+		imageData.encodedData = nullptr;
+		imageData.path.clear();
+		imageData.width = 1;
+		imageData.height = 1;
+	}
+
+	// addImage is called for every glTF image in order, so this is the global index of the glTF image
+	size_t gltfImageIndex = m_imageIndexRemap.size();
+	imageData.mipLevels = mipLevelCount(imageData.width, imageData.height);
+	if (!m_compressTextures) {
+		imageData.format =
+			m_textureImageNormalUsage[gltfImageIndex] ? VK_FORMAT_R8G8B8A8_UNORM : VK_FORMAT_R8G8B8A8_SRGB;
+	} else if (m_textureImageNormalUsage[gltfImageIndex]) {
+		imageData.format = VK_FORMAT_BC5_UNORM_BLOCK;
+	} else if (m_textureImageAlbedoUsage[gltfImageIndex]) {
+		imageData.format = VK_FORMAT_BC7_SRGB_BLOCK;
+	} else {
+		imageData.format = VK_FORMAT_BC1_RGB_SRGB_BLOCK;
+	}
+
+	// uncompressed images only stage the base level, their mip chains are blit on the GPU
+	if (isBlockCompressed(imageData.format)) {
+		imageData.size = 0;
+		for (uint32_t level = 0; level < imageData.mipLevels; ++level) {
+			imageData.size += imageLevelSize(imageData.format, std::max(imageData.width >> level, 1),
+											 std::max(imageData.height >> level, 1));
+		}
+	} else {
+		imageData.size = imageLevelSize(imageData.format, imageData.width, imageData.height);
+	}
+
+	// Images with identical encoded sources are only loaded once, as long as they end up in the same format. Sources
+	// that can't be hashed are never merged, failed images all share one white fallback per format.
+	bool isHashed = true;
+	uint64_t sourceHash = 0;
+	if (imageData.encodedData) {
+		sourceHash = hashData(imageData.encodedData, imageData.encodedSize);
+	} else if (!imageData.path.empty()) {
+		MappedFile sourceFile;
+		isHashed = sourceFile.open(imageData.path.c_str());
+		if (isHashed)
+			sourceHash = hashData(sourceFile.data(), sourceFile.size());
+	}
+	sourceHash = hashCombine(sourceHash, imageData.format);
+
+	if (isHashed) {
+		auto existingImage = m_imageIndicesBySource.find(sourceHash);
+		if (existingImage != m_imageIndicesBySource.end()) {
+			m_imageIndexRemap.push_back(existingImage->second);
+			++m_duplicateImageCount;
+			m_duplicateImageSize += imageData.size;
+			return;
+		}
+		m_imageIndicesBySource.insert({ sourceHash, static_cast<uint32_t>(m_imageData.size()) });
 	}
-	m_combinedImageSize += imageData.size;
+	m_imageIndexRemap.push_back(static_cast<uint32_t>(m_imageData.size()));
+
+	imageData.stagingOffset = (m_combinedImageSize + imageStagingAlignment - 1) & ~(imageStagingAlignment - 1);
+
+	m_combinedImageSize = imageData.stagingOffset + imageData.size;
 	m_maxImageSize = std::max(m_maxImageSize, imageData.size);
-	m_imageData.push_back(imageData);
+	m_imageData.push_back(std::move(imageData));
+}
+
+void ModelLoader::createImage(size_t imageIndex, uint32_t baseLevel) {
+	const ImageData& imageData = m_imageData[imageIndex];
 
 	VkImageCreateInfo imageCreateInfo = {
 		.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
 		.imageType = VK_IMAGE_TYPE_2D,
-		.format = m_textureImageNormalUsage[image - data->images + m_globalImageIndexOffset] ? VK_FORMAT_R8G8B8A8_UNORM
-																							 : VK_FORMAT_R8G8B8A8_SRGB,
-		.extent = { .width = static_cast<uint32_t>(imageData.width),
-					.height = static_cast<uint32_t>(imageData.height),
+		.format = imageData.format,
+		.extent = { .width = static_cast<uint32_t>(std::max(imageData.width >> baseLevel, 1)),
+					.height = static_cast<uint32_t>(std::max(imageData.height >> baseLevel, 1)),
 					.depth = 1 },
-		.mipLevels = 1,
+		.mipLevels = imageData.mipLevels - baseLevel,
 		.arrayLayers = 1,
 		.samples = VK_SAMPLE_COUNT_1_BIT,
 		.tiling = VK_IMAGE_TILING_OPTIMAL,
@@ -936,16 +2362,18 @@ void ModelLoader::addImage(cgltf_data* data, cgltf_image* image, const std::stri
 	};
 	VkImage createdImage;
 	verifyResult(vkCreateImage(m_device.device(), &imageCreateInfo, nullptr, &createdImage));
-	m_allocator.bindDeviceImage(createdImage, 0);
-	m_textureImages.push_back(createdImage);
+	if constexpr (streamTextures) {
+		m_textureImageAllocations[imageIndex] = m_allocator.bindPooledImage(createdImage);
+	} else {
+		m_allocator.bindDeviceImage(createdImage, 0);
+	}
+	m_textureImages[imageIndex] = createdImage;
 
 	VkImageViewCreateInfo
 		viewCreateInfo = { .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
 						   .image = createdImage,
 						   .viewType = VK_IMAGE_VIEW_TYPE_2D,
-						   .format = m_textureImageNormalUsage[image - data->images + m_globalImageIndexOffset]
-										 ? VK_FORMAT_R8G8B8A8_UNORM
-										 : VK_FORMAT_R8G8B8A8_SRGB,
+						   .format = imageData.format,
 						   .components = { .r = VK_COMPONENT_SWIZZLE_IDENTITY,
 										   .g = VK_COMPONENT_SWIZZLE_IDENTITY,
 										   .b = VK_COMPONENT_SWIZZLE_IDENTITY,
@@ -953,17 +2381,309 @@ void ModelLoader::addImage(cgltf_data* data, cgltf_image* image, const std::stri
 						   .subresourceRange = {
 							   .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
 							   .baseMipLevel = 0,
-							   .levelCount = 1,
+							   .levelCount = imageCreateInfo.mipLevels,
 							   .baseArrayLayer = 0,
 							   .layerCount = 1,
 						   } };
 	VkImageView createdImageView;
 	verifyResult(vkCreateImageView(m_device.device(), &viewCreateInfo, nullptr, &createdImageView));
-	m_textureImageViews.push_back(createdImageView);
+	m_textureImageViews[imageIndex] = createdImageView;
+}
+
+void ModelLoader::retireImage(size_t imageIndex) {
+	// the image stays alive until no frame in flight can sample it anymore
+	m_retiredImages.push_back({ .image = m_textureImages[imageIndex],
+								.view = m_textureImageViews[imageIndex],
+								.allocation = m_textureImageAllocations[imageIndex],
+								.destroyFrame = m_streamingFrameCount + frameInFlightCount });
+	m_textureImages[imageIndex] = VK_NULL_HANDLE;
+	m_textureImageViews[imageIndex] = VK_NULL_HANDLE;
+}
+
+void ModelLoader::createPlaceholderImages() {
+	const char* names[] = { "White placeholder image", "Black placeholder image", "Flat normal placeholder image" };
+	for (size_t i = 0; i < static_cast<size_t>(PlaceholderTexture::Count); ++i) {
+		VkImageCreateInfo imageCreateInfo = { .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+											  .imageType = VK_IMAGE_TYPE_2D,
+											  .format = VK_FORMAT_R8G8B8A8_UNORM,
+											  .extent = { .width = 1, .height = 1, .depth = 1 },
+											  .mipLevels = 1,
+											  .arrayLayers = 1,
+											  .samples = VK_SAMPLE_COUNT_1_BIT,
+											  .tiling = VK_IMAGE_TILING_OPTIMAL,
+											  .usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+											  .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED };
+		verifyResult(vkCreateImage(m_device.device(), &imageCreateInfo, nullptr, &m_placeholderImages[i]));
+		m_allocator.bindDeviceImage(m_placeholderImages[i], 0);
+		setObjectName(m_device.device(), VK_OBJECT_TYPE_IMAGE, m_placeholderImages[i], names[i]);
+
+		VkImageViewCreateInfo viewCreateInfo = { .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+												 .image = m_placeholderImages[i],
+												 .viewType = VK_IMAGE_VIEW_TYPE_2D,
+												 .format = VK_FORMAT_R8G8B8A8_UNORM,
+												 .subresourceRange = {
+													 .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+													 .baseMipLevel = 0,
+													 .levelCount = 1,
+													 .baseArrayLayer = 0,
+													 .layerCount = 1,
+												 } };
+		verifyResult(vkCreateImageView(m_device.device(), &viewCreateInfo, nullptr, &m_placeholderImageViews[i]));
+	}
+}
+
+void ModelLoader::decodeStreamedTextures() {
+	std::vector<StreamingRequest> requests;
+	std::vector<std::future<std::vector<unsigned char>>> decodedTexels;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(m_streamingMutex);
+			m_streamingCondition.wait(lock, [this] { return m_stopStreaming || !m_streamingRequests.empty(); });
+			if (m_stopStreaming)
+				return;
+			requests = std::move(m_streamingRequests);
+			m_streamingRequests.clear();
+		}
+
+		decodedTexels.clear();
+		for (auto& request : requests) {
+			const ImageData& image = m_imageData[request.imageIndex];
+			const unsigned char* cachedTexels = nullptr;
+			if (m_isSceneCached) {
+				const void* texelData = m_sceneCache.section(SceneCacheSection::TexelData);
+				cachedTexels = reinterpret_cast<const unsigned char*>(texelData) + image.stagingOffset;
+			}
+			decodedTexels.push_back(m_threadPool.enqueue([&image, request, cachedTexels] {
+				return decodeStreamedImage(image, request.baseLevel, cachedTexels);
+			}));
+		}
+
+		for (size_t i = 0; i < requests.size(); ++i) {
+			std::vector<unsigned char> texels = decodedTexels[i].get();
+			std::lock_guard<std::mutex> lock(m_streamingMutex);
+			m_decodedImages.push_back({ .imageIndex = requests[i].imageIndex,
+										.baseLevel = requests[i].baseLevel,
+										.texels = std::move(texels) });
+		}
+	}
+}
+
+bool ModelLoader::updateStreamedTextures(VkCommandBuffer commandBuffer, uint32_t frameIndex, bool tracedRays) {
+	if (!streamTextures || m_textures.empty())
+		return false;
+
+	++m_streamingFrameCount;
+	std::erase_if(m_retiredImages, [this](const RetiredImage& image) {
+		if (image.destroyFrame > m_streamingFrameCount)
+			return false;
+		vkDestroyImageView(m_device.device(), image.view, nullptr);
+		vkDestroyImage(m_device.device(), image.image, nullptr);
+		m_allocator.freePooledImage(image.allocation);
+		return true;
+	});
+
+	// this frame's set still points to images that were replaced while it was in flight
+	std::vector<uint32_t> updatedImages = std::move(m_pendingImageUpdates[frameIndex]);
+	m_pendingImageUpdates[frameIndex].clear();
+
+	// The frame's fence was waited on, so its requests are complete. The finest level any texture of an image asked
+	// for is the level whose texels are about one pixel in size at the closest hit.
+	std::vector<StreamingRequest> newRequests;
+	const uint32_t* requests = m_textureRequestData[frameIndex];
+	for (size_t i = 0; i < m_textures.size(); ++i) {
+		if (requests[i] == noTextureRequest)
+			continue;
+		uint32_t imageIndex = m_textureSources[i].imageIndex;
+		const ImageData& image = m_imageData[imageIndex];
+		float lod = static_cast<float>(requests[i]) / textureRequestLodScale - textureRequestLodOffset +
+					0.5f * std::log2(static_cast<float>(image.width) * static_cast<float>(image.height));
+		uint32_t level = static_cast<uint32_t>(
+			std::clamp(std::floor(lod), 0.0f, static_cast<float>(image.mipLevels - 1)));
+		if (m_textureResidency.request(imageIndex, level)) {
+			newRequests.push_back({ .imageIndex = imageIndex, .baseLevel = level });
+		}
+	}
+	// the readback buffer is overwritten by this frame's copy, only the shaders' buffer needs to start out empty
+	vkCmdFillBuffer(commandBuffer, m_textureRequestBuffers[frameIndex], 0, VK_WHOLE_SIZE, noTextureRequest);
+	VkMemoryBarrier requestClearBarrier = { .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+											.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+											.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT };
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR,
+						 0, 1, &requestClearBarrier, 0, nullptr, 0, nullptr);
+
+	if (!newRequests.empty()) {
+		std::lock_guard<std::mutex> lock(m_streamingMutex);
+		m_streamingRequests.insert(m_streamingRequests.end(), newRequests.begin(), newRequests.end());
+		m_streamingCondition.notify_one();
+	}
+
+	// images none of whose textures were requested in a while go back to their placeholder
+	std::vector<uint32_t> changedImages;
+	for (uint32_t i : m_textureResidency.endFrame(tracedRays)) {
+		if (m_textureImages[i] == VK_NULL_HANDLE)
+			continue;
+		retireImage(i);
+		m_residentImageLevels[i] = m_imageData[i].mipLevels;
+		changedImages.push_back(i);
+	}
+
+	// take as many decoded images as fit into this frame's staging slot
+	std::vector<StreamedImageData> uploadImages;
+	{
+		std::lock_guard<std::mutex> lock(m_streamingMutex);
+		size_t stagingSize = 0;
+		auto decodedImageIterator = m_decodedImages.begin();
+		for (; decodedImageIterator != m_decodedImages.end(); ++decodedImageIterator) {
+			if (stagingSize + decodedImageIterator->texels.size() > m_streamingStagingSlotSize)
+				break;
+			stagingSize += (decodedImageIterator->texels.size() + imageStagingAlignment - 1) &
+						   ~(imageStagingAlignment - 1);
+			uploadImages.push_back(std::move(*decodedImageIterator));
+		}
+		m_decodedImages.erase(m_decodedImages.begin(), decodedImageIterator);
+	}
+	// a finer level of the same image may have been decoded before, or the image was evicted while decoding
+	std::erase_if(uploadImages, [this](const StreamedImageData& data) {
+		return data.baseLevel >= m_residentImageLevels[data.imageIndex] ||
+			   !m_textureResidency.isRequested(data.imageIndex);
+	});
+
+	if (!uploadImages.empty()) {
+		std::vector<VkImageMemoryBarrier> transferBarriers;
+		std::vector<VkImageMemoryBarrier> sampledBarriers;
+		for (auto& data : uploadImages) {
+			if (m_textureImages[data.imageIndex] != VK_NULL_HANDLE)
+				retireImage(data.imageIndex);
+			createImage(data.imageIndex, data.baseLevel);
+			m_residentImageLevels[data.imageIndex] = data.baseLevel;
+
+			VkImageSubresourceRange subresourceRange = { .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+														 .baseMipLevel = 0,
+														 .levelCount = m_imageData[data.imageIndex].mipLevels -
+																	   data.baseLevel,
+														 .baseArrayLayer = 0,
+														 .layerCount = 1 };
+			transferBarriers.push_back({ .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+										 .srcAccessMask = 0,
+										 .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+										 .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+										 .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+										 .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+										 .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+										 .image = m_textureImages[data.imageIndex],
+										 .subresourceRange = subresourceRange });
+			sampledBarriers.push_back({ .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+										.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+										.dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+										.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+										.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+										.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+										.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+										.image = m_textureImages[data.imageIndex],
+										.subresourceRange = subresourceRange });
+		}
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0,
+							 nullptr, 0, nullptr, static_cast<uint32_t>(transferBarriers.size()),
+							 transferBarriers.data());
+
+		size_t stagingOffset = frameIndex * m_streamingStagingSlotSize;
+		std::vector<VkBufferImageCopy> copies;
+		for (auto& data : uploadImages) {
+			const ImageData& image = m_imageData[data.imageIndex];
+			std::memcpy(m_streamingStagingData + stagingOffset, data.texels.data(), data.texels.size());
+
+			copies.clear();
+			size_t levelOffset = stagingOffset;
+			for (uint32_t level = data.baseLevel; level < image.mipLevels; ++level) {
+				uint32_t levelWidth = static_cast<uint32_t>(std::max(image.width >> level, 1));
+				uint32_t levelHeight = static_cast<uint32_t>(std::max(image.height >> level, 1));
+				copies.push_back({ .bufferOffset = levelOffset,
+								   .bufferRowLength = 0,
+								   .bufferImageHeight = 0,
+								   .imageSubresource = { .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+														 .mipLevel = level - data.baseLevel,
+														 .baseArrayLayer = 0,
+														 .layerCount = 1 },
+								   .imageOffset = {},
+								   .imageExtent = { .width = levelWidth, .height = levelHeight, .depth = 1 } });
+				levelOffset += imageLevelSize(image.format, levelWidth, levelHeight);
+			}
+			vkCmdCopyBufferToImage(commandBuffer, m_streamingStagingBuffer, m_textureImages[data.imageIndex],
+								   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(copies.size()),
+								   copies.data());
+			stagingOffset += (data.texels.size() + imageStagingAlignment - 1) & ~(imageStagingAlignment - 1);
+		}
+
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+							 VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, 0, 0, nullptr, 0, nullptr,
+							 static_cast<uint32_t>(sampledBarriers.size()), sampledBarriers.data());
+
+		for (auto& data : uploadImages) {
+			changedImages.push_back(data.imageIndex);
+		}
+	}
+
+	if (!changedImages.empty()) {
+		// textures of images that aren't resident (anymore) use their placeholder view
+		for (size_t i = 0; i < m_textures.size(); ++i) {
+			VkImageView view = m_textureImageViews[m_textureSources[i].imageIndex];
+			m_textures[i].view =
+				view != VK_NULL_HANDLE ? view : m_placeholderImageViews[static_cast<size_t>(m_texturePlaceholders[i])];
+		}
+		for (auto& imageIndex : changedImages) {
+			updatedImages.push_back(imageIndex);
+			for (uint32_t i = 0; i < frameInFlightCount; ++i) {
+				if (i != frameIndex)
+					m_pendingImageUpdates[i].push_back(imageIndex);
+			}
+		}
+	}
+
+	if (updatedImages.empty())
+		return false;
+	writeStreamedTextureDescriptors(frameIndex, updatedImages);
+	return true;
+}
+
+void ModelLoader::copyTextureRequests(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
+	if (!streamTextures || m_textures.empty())
+		return;
+
+	VkMemoryBarrier requestBarrier = { .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+									   .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+									   .dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT };
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, VK_PIPELINE_STAGE_TRANSFER_BIT,
+						 0, 1, &requestBarrier, 0, nullptr, 0, nullptr);
+
+	VkBufferCopy copy = { .srcOffset = 0, .dstOffset = 0, .size = m_textures.size() * sizeof(uint32_t) };
+	vkCmdCopyBuffer(commandBuffer, m_textureRequestBuffers[frameIndex], m_textureRequestReadbackBuffers[frameIndex],
+					1, &copy);
+}
+
+void ModelLoader::writeStreamedTextureDescriptors(uint32_t frameIndex, const std::vector<uint32_t>& imageIndices) {
+	std::vector<VkDescriptorImageInfo> imageInfos;
+	std::vector<VkWriteDescriptorSet> setWrites;
+	imageInfos.reserve(m_textures.size());
+	for (size_t i = 0; i < m_textures.size(); ++i) {
+		if (std::find(imageIndices.begin(), imageIndices.end(), m_textureSources[i].imageIndex) == imageIndices.end())
+			continue;
+		imageInfos.push_back({ .sampler = m_textures[i].sampler,
+							   .imageView = m_textures[i].view,
+							   .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL });
+		setWrites.push_back({ .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+							  .dstSet = m_textureDescriptorSets[frameIndex],
+							  .dstBinding = 0,
+							  .dstArrayElement = static_cast<uint32_t>(i),
+							  .descriptorCount = 1,
+							  .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+							  .pImageInfo = &imageInfos.back() });
+	}
+	vkUpdateDescriptorSets(m_device.device(), static_cast<uint32_t>(setWrites.size()), setWrites.data(), 0, nullptr);
 }
 
 void ModelLoader::addSampler(cgltf_data* data, cgltf_sampler* sampler) {
-	VkSamplerCreateInfo samplerCreateInfo = { .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO };
+	VkSamplerCreateInfo samplerCreateInfo = { .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+											  .maxLod = VK_LOD_CLAMP_NONE };
 
 	switch (sampler->wrap_s) {
 		case 0x2901:
@@ -991,12 +2711,12 @@ void ModelLoader::addSampler(cgltf_data* data, cgltf_sampler* sampler) {
 		case 0x2600:
 		case 0x2700:
 		case 0x2702:
-			samplerCreateInfo.minFilter = VK_FILTER_NEAREST;
+			samplerCreateInfo.magFilter = VK_FILTER_NEAREST;
 			break;
 		case 0x2601:
 		case 0x2701:
 		case 0x2703:
-			samplerCreateInfo.minFilter = VK_FILTER_LINEAR;
+			samplerCreateInfo.magFilter = VK_FILTER_LINEAR;
 			break;
 	}
 	switch (sampler->min_filter) {
@@ -1012,6 +2732,11 @@ void ModelLoader::addSampler(cgltf_data* data, cgltf_sampler* sampler) {
 			break;
 	}
 	switch (sampler->min_filter) {
+		// NEAREST and LINEAR without a mipmap mode only ever sample the base level
+		case 0x2600:
+		case 0x2601:
+			samplerCreateInfo.maxLod = 0.0f;
+			break;
 		case 0x2700:
 		case 0x2701:
 			samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
@@ -1023,4 +2748,5 @@ void ModelLoader::addSampler(cgltf_data* data, cgltf_sampler* sampler) {
 	VkSampler resultSampler;
 	vkCreateSampler(m_device.device(), &samplerCreateInfo, nullptr, &resultSampler);
 	m_textureSamplers.push_back(resultSampler);
+	m_samplerCreateInfos.push_back(samplerCreateInfo);
 }
@@ -0,0 +1,104 @@
+#include <algorithm>
+#include <future>
+#include <util/NodeHierarchy.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define NODE_HIERARCHY_SSE2
+#include <emmintrin.h>
+#endif
+
+// result = lhs * rhs for column-major 4x4 matrices, result must not alias either operand
+static void multiplyMatrices(const float* lhs, const float* rhs, float* result) {
+#ifdef NODE_HIERARCHY_SSE2
+	__m128 lhsColumns[4] = { _mm_loadu_ps(lhs), _mm_loadu_ps(lhs + 4), _mm_loadu_ps(lhs + 8),
+							 _mm_loadu_ps(lhs + 12) };
+	for (size_t column = 0; column < 4; ++column) {
+		const float* rhsColumn = rhs + column * 4;
+		__m128 resultColumn = _mm_mul_ps(lhsColumns[0], _mm_set1_ps(rhsColumn[0]));
+		resultColumn = _mm_add_ps(resultColumn, _mm_mul_ps(lhsColumns[1], _mm_set1_ps(rhsColumn[1])));
+		resultColumn = _mm_add_ps(resultColumn, _mm_mul_ps(lhsColumns[2], _mm_set1_ps(rhsColumn[2])));
+		resultColumn = _mm_add_ps(resultColumn, _mm_mul_ps(lhsColumns[3], _mm_set1_ps(rhsColumn[3])));
+		_mm_storeu_ps(result + column * 4, resultColumn);
+	}
+#else
+	for (size_t column = 0; column < 4; ++column) {
+		for (size_t row = 0; row < 4; ++row) {
+			result[column * 4 + row] = lhs[row] * rhs[column * 4] + lhs[4 + row] * rhs[column * 4 + 1] +
+									   lhs[8 + row] * rhs[column * 4 + 2] + lhs[12 + row] * rhs[column * 4 + 3];
+		}
+	}
+#endif
+}
+
+static void computeWorldTransform(std::vector<FlattenedNode>& nodes, size_t index) {
+	FlattenedNode& node = nodes[index];
+	if (node.parentIndex == noParentNode) {
+		cgltf_node_transform_local(node.node, node.worldTransform);
+	} else {
+		float localTransform[16];
+		cgltf_node_transform_local(node.node, localTransform);
+		multiplyMatrices(nodes[node.parentIndex].worldTransform, localTransform, node.worldTransform);
+	}
+}
+
+std::vector<FlattenedNode> flattenSceneNodes(const cgltf_scene* scene, ThreadPool& threadPool) {
+	std::vector<FlattenedNode> nodes;
+	// children are pushed in reverse so that they are popped in order
+	std::vector<std::pair<const cgltf_node*, uint32_t>> stack;
+	for (cgltf_size i = scene->nodes_count; i-- > 0;) {
+		stack.push_back({ scene->nodes[i], noParentNode });
+	}
+	while (!stack.empty()) {
+		auto [node, parentIndex] = stack.back();
+		stack.pop_back();
+
+		uint32_t index = static_cast<uint32_t>(nodes.size());
+		nodes.push_back({ .node = node, .parentIndex = parentIndex, .subtreeSize = 1 });
+		for (cgltf_size i = node->children_count; i-- > 0;) {
+			stack.push_back({ node->children[i], index });
+		}
+	}
+
+	// children come after their parents, so every subtree is complete once its root is reached going backwards
+	for (size_t i = nodes.size(); i-- > 0;) {
+		if (nodes[i].parentIndex != noParentNode)
+			nodes[nodes[i].parentIndex].subtreeSize += nodes[i].subtreeSize;
+	}
+
+	// Nodes with subtrees larger than a job are transformed up front, which only are the few ancestors of the large
+	// subtrees. Everything below them forms subtrees small enough for one job, whose nodes only depend on nodes
+	// either transformed up front or earlier in the same subtree.
+	size_t jobNodeCount = std::max(nodes.size() / (4 * threadPool.threadCount()), size_t{ 256 });
+	for (size_t i = 0; i < nodes.size(); ++i) {
+		if (nodes[i].subtreeSize > jobNodeCount)
+			computeWorldTransform(nodes, i);
+	}
+
+	std::vector<std::future<void>> transformJobs;
+	size_t jobBegin = 0;
+	while (jobBegin < nodes.size()) {
+		// only split between whole subtrees
+		size_t jobEnd = jobBegin;
+		while (jobEnd < nodes.size() && jobEnd - jobBegin < jobNodeCount) {
+			jobEnd += nodes[jobEnd].subtreeSize > jobNodeCount ? 1 : nodes[jobEnd].subtreeSize;
+		}
+
+		auto transformRange = [&nodes, jobBegin, jobEnd, jobNodeCount]() {
+			for (size_t i = jobBegin; i < jobEnd; ++i) {
+				if (nodes[i].subtreeSize <= jobNodeCount)
+					computeWorldTransform(nodes, i);
+			}
+		};
+		// small hierarchies aren't worth the round trip through the pool
+		if (jobBegin == 0 && jobEnd == nodes.size())
+			transformRange();
+		else
+			transformJobs.push_back(threadPool.enqueue(transformRange));
+		jobBegin = jobEnd;
+	}
+
+	for (auto& job : transformJobs) {
+		job.get();
+	}
+	return nodes;
+}
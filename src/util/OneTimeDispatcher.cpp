@@ -3,9 +3,11 @@
 #include <ErrorHelper.hpp>
 #include <algorithm>
 
-OneTimeDispatcher::OneTimeDispatcher(RayTracingDevice& device) : m_device(device) {
+OneTimeDispatcher::OneTimeDispatcher(RayTracingDevice& device, bool useTransferQueue)
+	: m_device(device), m_queue(useTransferQueue ? device.transferQueue() : device.queue()),
+	  m_queueFamilyIndex(useTransferQueue ? device.transferQueueFamilyIndex() : device.queueFamilyIndex()) {
 	VkCommandPoolCreateInfo poolCreateInfo = { .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
-											   .queueFamilyIndex = m_device.queueFamilyIndex() };
+											   .queueFamilyIndex = m_queueFamilyIndex };
 	verifyResult(vkCreateCommandPool(m_device.device(), &poolCreateInfo, nullptr, &m_commandPool));
 }
 
@@ -22,16 +24,54 @@ std::vector<VkCommandBuffer> OneTimeDispatcher::allocateOneTimeSubmitBuffers(uin
 }
 
 void OneTimeDispatcher::submit(VkCommandBuffer submitCommandBuffer, const std::vector<VkSemaphore>& signalSemaphores) {
-	VkFence fence;
-	VkFenceCreateInfo fenceCreateInfo = { .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO };
-	vkCreateFence(m_device.device(), &fenceCreateInfo, nullptr, &fence);
-
 	VkSubmitInfo submitInfo = { .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
 								.commandBufferCount = 1,
 								.pCommandBuffers = &submitCommandBuffer,
 								.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size()),
 								.pSignalSemaphores = signalSemaphores.data() };
-	verifyResult(vkQueueSubmit(m_device.queue(), 1, &submitInfo, fence));
+	queueSubmit(submitCommandBuffer, submitInfo);
+}
+
+void OneTimeDispatcher::submit(VkCommandBuffer submitCommandBuffer,
+							   const std::vector<TimelineSemaphoreWait>& waitSemaphores, VkSemaphore signalSemaphore,
+							   uint64_t signalValue) {
+	std::vector<VkSemaphore> semaphores;
+	std::vector<uint64_t> values;
+	std::vector<VkPipelineStageFlags> stageMasks;
+	semaphores.reserve(waitSemaphores.size());
+	values.reserve(waitSemaphores.size());
+	stageMasks.reserve(waitSemaphores.size());
+	for (auto& wait : waitSemaphores) {
+		semaphores.push_back(wait.semaphore);
+		values.push_back(wait.value);
+		stageMasks.push_back(wait.stageMask);
+	}
+
+	uint32_t signalSemaphoreCount = signalSemaphore != VK_NULL_HANDLE ? 1 : 0;
+	VkTimelineSemaphoreSubmitInfo timelineSubmitInfo = { .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+														 .waitSemaphoreValueCount =
+															 static_cast<uint32_t>(values.size()),
+														 .pWaitSemaphoreValues = values.data(),
+														 .signalSemaphoreValueCount = signalSemaphoreCount,
+														 .pSignalSemaphoreValues = &signalValue };
+	VkSubmitInfo submitInfo = { .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+								.pNext = &timelineSubmitInfo,
+								.waitSemaphoreCount = static_cast<uint32_t>(semaphores.size()),
+								.pWaitSemaphores = semaphores.data(),
+								.pWaitDstStageMask = stageMasks.data(),
+								.commandBufferCount = 1,
+								.pCommandBuffers = &submitCommandBuffer,
+								.signalSemaphoreCount = signalSemaphoreCount,
+								.pSignalSemaphores = &signalSemaphore };
+	queueSubmit(submitCommandBuffer, submitInfo);
+}
+
+void OneTimeDispatcher::queueSubmit(VkCommandBuffer submitCommandBuffer, const VkSubmitInfo& submitInfo) {
+	VkFence fence;
+	VkFenceCreateInfo fenceCreateInfo = { .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO };
+	vkCreateFence(m_device.device(), &fenceCreateInfo, nullptr, &fence);
+
+	verifyResult(vkQueueSubmit(m_queue, 1, &submitInfo, fence));
 
 	m_submittedCommandBuffers.push_back({ submitCommandBuffer, fence });
 }
@@ -0,0 +1,190 @@
+#include <Config.hpp>
+#include <cgltf.h>
+#include <cstring>
+#include <filesystem>
+#include <util/Hash.hpp>
+#include <util/SceneCache.hpp>
+
+static constexpr uint32_t sceneCacheMagic = 0x43524B56; // "VKRC"
+static constexpr uint64_t sceneCacheSectionAlignment = 64;
+
+static bool hashFile(const std::string& path, uint64_t& hash) {
+	MappedFile file;
+	if (!file.open(path.c_str()))
+		return false;
+	hash = hashCombine(hash, hashData(file.data(), file.size()));
+	return true;
+}
+
+static bool hashGltfInputs(const std::string_view& gltfFilename, uint64_t& hash) {
+	MappedFile gltfFile;
+	if (!gltfFile.open(gltfFilename.data()))
+		return false;
+	hash = hashData(gltfFile.data(), gltfFile.size());
+
+	// only the JSON is parsed to find the referenced files, for .glb files the binary chunk is hashed above already
+	cgltf_options options = {};
+	cgltf_data* data;
+	if (cgltf_parse(&options, gltfFile.data(), gltfFile.size(), &data) != cgltf_result_success)
+		return false;
+
+	std::string directoryString = std::filesystem::path(gltfFilename).parent_path().string();
+	directoryString.push_back(static_cast<char>(std::filesystem::path::preferred_separator));
+
+	bool success = true;
+	for (cgltf_size i = 0; i < data->buffers_count && success; ++i) {
+		const char* uri = data->buffers[i].uri;
+		if (!uri || std::strncmp(uri, "data:", 5) == 0)
+			continue;
+		// same as cgltf_load_buffers
+		std::string decodedURI = uri;
+		decodedURI.resize(cgltf_decode_uri(decodedURI.data()));
+		success = hashFile(directoryString + decodedURI, hash);
+	}
+	for (cgltf_size i = 0; i < data->images_count && success; ++i) {
+		const char* uri = data->images[i].uri;
+		if (data->images[i].buffer_view || !uri || std::strncmp(uri, "data:", 5) == 0)
+			continue;
+		// images that can't be read are replaced by a fallback image, that doesn't prevent caching
+		if (!hashFile(directoryString + uri, hash))
+			hash = hashCombine(hash, 0);
+	}
+
+	cgltf_free(data);
+	return success;
+}
+
+bool hashSceneInputs(const std::vector<std::string_view>& gltfFilenames, ThreadPool& threadPool, uint64_t& hash) {
+	std::vector<std::future<bool>> hashResults;
+	std::vector<uint64_t> fileHashes = std::vector<uint64_t>(gltfFilenames.size());
+	hashResults.reserve(gltfFilenames.size());
+
+	for (size_t i = 0; i < gltfFilenames.size(); ++i) {
+		hashResults.push_back(threadPool.enqueue(
+			[&gltfFilenames, &fileHashes, i]() { return hashGltfInputs(gltfFilenames[i], fileHashes[i]); }));
+	}
+
+	bool success = true;
+	for (auto& result : hashResults) {
+		success &= result.get();
+	}
+
+	// the stored vertex format depends on the build configuration
+	uint64_t seed = sceneCacheVersion * 4 + (compactVertexAttributes ? 1 : 0) + (interleavedVertexAttributes ? 2 : 0);
+	hash = hashData(fileHashes.data(), fileHashes.size() * sizeof(uint64_t), seed);
+	return success;
+}
+
+std::string sceneCachePath(uint64_t sceneHash) {
+	char filename[32];
+	snprintf(filename, sizeof(filename), "%016llx.bin", static_cast<unsigned long long>(sceneHash));
+	return (std::filesystem::path(sceneCacheDirectory) / filename).string();
+}
+
+SceneCacheWriter::SceneCacheWriter(const std::string& path, uint64_t sceneHash)
+	: m_path(path), m_temporaryPath(path + ".tmp") {
+	std::error_code error;
+	std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+
+	m_file = fopen(m_temporaryPath.c_str(), "wb");
+	m_failed = !m_file;
+
+	m_header.magic = sceneCacheMagic;
+	m_header.version = sceneCacheVersion;
+	m_header.sceneHash = sceneHash;
+
+	// the header is rewritten with the final section offsets at the end
+	m_currentOffset = sizeof(SceneCacheHeader);
+	if (m_file)
+		m_failed |= fwrite(&m_header, sizeof(SceneCacheHeader), 1, m_file) != 1;
+}
+
+SceneCacheWriter::~SceneCacheWriter() {
+	if (m_file) {
+		fclose(m_file);
+		std::remove(m_temporaryPath.c_str());
+	}
+}
+
+void SceneCacheWriter::writeSection(SceneCacheSection section, const void* data, size_t size) {
+	beginSection(section);
+	appendToSection(data, size);
+}
+
+void SceneCacheWriter::beginSection(SceneCacheSection section) {
+	m_currentSection = section;
+	if (m_failed)
+		return;
+
+	static constexpr uint8_t padding[sceneCacheSectionAlignment] = {};
+	uint64_t paddingSize = (sceneCacheSectionAlignment - m_currentOffset % sceneCacheSectionAlignment) %
+						   sceneCacheSectionAlignment;
+	if (paddingSize)
+		m_failed |= fwrite(padding, paddingSize, 1, m_file) != 1;
+	m_currentOffset += paddingSize;
+
+	m_header.sectionOffsets[static_cast<size_t>(section)] = m_currentOffset;
+	m_header.sectionSizes[static_cast<size_t>(section)] = 0;
+}
+
+void SceneCacheWriter::appendToSection(const void* data, size_t size) {
+	if (m_failed)
+		return;
+
+	if (size)
+		m_failed |= fwrite(data, size, 1, m_file) != 1;
+	m_header.sectionSizes[static_cast<size_t>(m_currentSection)] += size;
+	m_currentOffset += size;
+}
+
+bool SceneCacheWriter::finish() {
+	if (!m_file)
+		return false;
+
+	if (!m_failed) {
+		m_failed |= fseek(m_file, 0, SEEK_SET) != 0;
+		m_failed |= fwrite(&m_header, sizeof(SceneCacheHeader), 1, m_file) != 1;
+	}
+	m_failed |= fclose(m_file) != 0;
+	m_file = nullptr;
+
+	if (!m_failed) {
+		std::error_code error;
+		std::filesystem::rename(m_temporaryPath, m_path, error);
+		m_failed = static_cast<bool>(error);
+	}
+	if (m_failed)
+		std::remove(m_temporaryPath.c_str());
+	return !m_failed;
+}
+
+bool SceneCacheReader::open(const std::string& path, uint64_t sceneHash) {
+	if (!m_file.open(path.c_str()) || m_file.size() < sizeof(SceneCacheHeader))
+		return false;
+
+	m_header = reinterpret_cast<const SceneCacheHeader*>(m_file.data());
+	if (m_header->magic != sceneCacheMagic || m_header->version != sceneCacheVersion ||
+		m_header->sceneHash != sceneHash) {
+		m_file.close();
+		m_header = nullptr;
+		return false;
+	}
+
+	for (size_t i = 0; i < static_cast<size_t>(SceneCacheSection::Count); ++i) {
+		if (m_header->sectionOffsets[i] > m_file.size() ||
+			m_header->sectionSizes[i] > m_file.size() - m_header->sectionOffsets[i]) {
+			m_file.close();
+			m_header = nullptr;
+			return false;
+		}
+	}
+	return true;
+}
+
+const void* SceneCacheReader::section(SceneCacheSection section) const {
+	return m_file.data() + m_header->sectionOffsets[static_cast<size_t>(section)];
+}
+
+size_t SceneCacheReader::sectionSize(SceneCacheSection section) const {
+	return m_header->sectionSizes[static_cast<size_t>(section)];
+}
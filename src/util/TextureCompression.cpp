@@ -0,0 +1,430 @@
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <util/TextureCompression.hpp>
+#if defined(__SSE2__) || defined(_M_X64)
+#define TEXTURE_COMPRESSION_SSE2
+#include <emmintrin.h>
+#endif
+
+size_t blockCompressedSize(uint32_t width, uint32_t height, size_t blockSize) {
+	return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * blockSize;
+}
+
+// gathers the 4x4 block at (blockX, blockY) as 16 consecutive RGBA texels
+static void loadBlock(const uint8_t* texels, uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY,
+					  uint8_t* block) {
+	if (blockX * 4 + 4 <= width && blockY * 4 + 4 <= height) {
+		for (uint32_t y = 0; y < 4; ++y) {
+			std::memcpy(block + y * 16, texels + ((blockY * 4 + y) * static_cast<size_t>(width) + blockX * 4) * 4, 16);
+		}
+		return;
+	}
+
+	for (uint32_t y = 0; y < 4; ++y) {
+		uint32_t sourceY = std::min(blockY * 4 + y, height - 1);
+		for (uint32_t x = 0; x < 4; ++x) {
+			uint32_t sourceX = std::min(blockX * 4 + x, width - 1);
+			std::memcpy(block + (y * 4 + x) * 4, texels + (sourceY * static_cast<size_t>(width) + sourceX) * 4, 4);
+		}
+	}
+}
+
+// per-channel minimum and maximum of a block
+static void blockBounds(const uint8_t* block, uint8_t* minimum, uint8_t* maximum) {
+#ifdef TEXTURE_COMPRESSION_SSE2
+	__m128i rows[4];
+	for (int i = 0; i < 4; ++i) {
+		rows[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i * 16));
+	}
+	__m128i minimumTexels = _mm_min_epu8(_mm_min_epu8(rows[0], rows[1]), _mm_min_epu8(rows[2], rows[3]));
+	__m128i maximumTexels = _mm_max_epu8(_mm_max_epu8(rows[0], rows[1]), _mm_max_epu8(rows[2], rows[3]));
+	// reduce the four texels left in each register to one
+	minimumTexels = _mm_min_epu8(minimumTexels, _mm_srli_si128(minimumTexels, 8));
+	minimumTexels = _mm_min_epu8(minimumTexels, _mm_srli_si128(minimumTexels, 4));
+	maximumTexels = _mm_max_epu8(maximumTexels, _mm_srli_si128(maximumTexels, 8));
+	maximumTexels = _mm_max_epu8(maximumTexels, _mm_srli_si128(maximumTexels, 4));
+
+	int32_t minimumBits = _mm_cvtsi128_si32(minimumTexels);
+	int32_t maximumBits = _mm_cvtsi128_si32(maximumTexels);
+	std::memcpy(minimum, &minimumBits, 4);
+	std::memcpy(maximum, &maximumBits, 4);
+#else
+	std::memcpy(minimum, block, 4);
+	std::memcpy(maximum, block, 4);
+	for (int i = 1; i < 16; ++i) {
+		for (int channel = 0; channel < 4; ++channel) {
+			minimum[channel] = std::min(minimum[channel], block[i * 4 + channel]);
+			maximum[channel] = std::max(maximum[channel], block[i * 4 + channel]);
+		}
+	}
+#endif
+}
+
+// Turns the bounding box into a line segment between two endpoints. The box diagonal is flipped in every channel
+// that decreases while the channel with the largest range increases, and both ends are inset by 1/16 of the range to
+// account for the interpolated palette entries.
+static void blockEndpoints(const uint8_t* block, int channelCount, float* start, float* end) {
+	uint8_t minimum[4], maximum[4];
+	blockBounds(block, minimum, maximum);
+
+	int referenceChannel = 0;
+	float mean[4] = {};
+	for (int channel = 0; channel < channelCount; ++channel) {
+		if (maximum[channel] - minimum[channel] > maximum[referenceChannel] - minimum[referenceChannel])
+			referenceChannel = channel;
+		for (int i = 0; i < 16; ++i) {
+			mean[channel] += block[i * 4 + channel];
+		}
+		mean[channel] /= 16.0f;
+	}
+
+	for (int channel = 0; channel < channelCount; ++channel) {
+		float covariance = 0.0f;
+		for (int i = 0; i < 16; ++i) {
+			covariance += (block[i * 4 + channel] - mean[channel]) *
+						  (block[i * 4 + referenceChannel] - mean[referenceChannel]);
+		}
+
+		float inset = (maximum[channel] - minimum[channel]) / 16.0f;
+		start[channel] = minimum[channel] + inset;
+		end[channel] = maximum[channel] - inset;
+		if (covariance < 0.0f)
+			std::swap(start[channel], end[channel]);
+	}
+}
+
+static int squaredDistance(const uint8_t* texel, const int* color, int channelCount) {
+	int distance = 0;
+	for (int channel = 0; channel < channelCount; ++channel) {
+		int difference = texel[channel] - color[channel];
+		distance += difference * difference;
+	}
+	return distance;
+}
+
+static uint16_t packColor565(const float* color) {
+	uint32_t red = static_cast<uint32_t>(std::lround(std::clamp(color[0], 0.0f, 255.0f) * 31.0f / 255.0f));
+	uint32_t green = static_cast<uint32_t>(std::lround(std::clamp(color[1], 0.0f, 255.0f) * 63.0f / 255.0f));
+	uint32_t blue = static_cast<uint32_t>(std::lround(std::clamp(color[2], 0.0f, 255.0f) * 31.0f / 255.0f));
+	return static_cast<uint16_t>((red << 11) | (green << 5) | blue);
+}
+
+static void unpackColor565(uint16_t packedColor, int* color) {
+	int red = (packedColor >> 11) & 31;
+	int green = (packedColor >> 5) & 63;
+	int blue = packedColor & 31;
+	color[0] = (red << 3) | (red >> 2);
+	color[1] = (green << 2) | (green >> 4);
+	color[2] = (blue << 3) | (blue >> 2);
+}
+
+static void compressBC1Block(const uint8_t* block, uint8_t* dst) {
+	float start[3], end[3];
+	blockEndpoints(block, 3, start, end);
+
+	uint16_t color0 = packColor565(end);
+	uint16_t color1 = packColor565(start);
+	// color0 > color1 selects the four color mode without transparency
+	if (color0 < color1)
+		std::swap(color0, color1);
+
+	uint32_t indices = 0;
+	if (color0 != color1) {
+		int palette[4][3];
+		unpackColor565(color0, palette[0]);
+		unpackColor565(color1, palette[1]);
+		for (int channel = 0; channel < 3; ++channel) {
+			palette[2][channel] = (2 * palette[0][channel] + palette[1][channel]) / 3;
+			palette[3][channel] = (palette[0][channel] + 2 * palette[1][channel]) / 3;
+		}
+
+		for (int i = 0; i < 16; ++i) {
+			uint32_t bestIndex = 0;
+			int bestDistance = INT_MAX;
+			for (uint32_t index = 0; index < 4; ++index) {
+				int distance = squaredDistance(block + i * 4, palette[index], 3);
+				if (distance < bestDistance) {
+					bestDistance = distance;
+					bestIndex = index;
+				}
+			}
+			indices |= bestIndex << (2 * i);
+		}
+	}
+
+	std::memcpy(dst, &color0, sizeof(uint16_t));
+	std::memcpy(dst + 2, &color1, sizeof(uint16_t));
+	std::memcpy(dst + 4, &indices, sizeof(uint32_t));
+}
+
+static void compressBC4Block(const uint8_t* block, int channel, uint8_t* dst) {
+	uint8_t minimum = 255, maximum = 0;
+	for (int i = 0; i < 16; ++i) {
+		minimum = std::min(minimum, block[i * 4 + channel]);
+		maximum = std::max(maximum, block[i * 4 + channel]);
+	}
+
+	// with red0 > red1, index 0 and 1 are the endpoints and 2-7 interpolate from red0 towards red1
+	uint64_t indices = 0;
+	if (maximum > minimum) {
+		int range = maximum - minimum;
+		for (int i = 0; i < 16; ++i) {
+			int position = ((block[i * 4 + channel] - minimum) * 14 + range) / (2 * range);
+			uint64_t index = position == 7 ? 0 : position == 0 ? 1 : 8 - position;
+			indices |= index << (3 * i);
+		}
+	}
+
+	dst[0] = maximum;
+	dst[1] = minimum;
+	for (int i = 0; i < 6; ++i) {
+		dst[2 + i] = static_cast<uint8_t>(indices >> (8 * i));
+	}
+}
+
+static void compressBC5Block(const uint8_t* block, uint8_t* dst) {
+	compressBC4Block(block, 0, dst);
+	compressBC4Block(block, 1, dst + 8);
+}
+
+// packs fields LSB first, as BC7 expects
+struct BC7BlockWriter {
+	uint64_t bits[2] = {};
+	int position = 0;
+
+	void write(uint32_t value, int count) {
+		if (position < 64) {
+			bits[0] |= static_cast<uint64_t>(value) << position;
+			if (position + count > 64)
+				bits[1] |= static_cast<uint64_t>(value) >> (64 - position);
+		} else {
+			bits[1] |= static_cast<uint64_t>(value) << (position - 64);
+		}
+		position += count;
+	}
+};
+
+// least squares fit of the endpoints, given the interpolation weight of every texel
+static bool fitEndpoints(const uint8_t* block, int channelCount, const float* weights, float* start, float* end) {
+	float startWeightSum = 0.0f, mixedWeightSum = 0.0f, endWeightSum = 0.0f;
+	float startTexelSum[4] = {}, endTexelSum[4] = {};
+	for (int i = 0; i < 16; ++i) {
+		float endWeight = weights[i];
+		float startWeight = 1.0f - endWeight;
+		startWeightSum += startWeight * startWeight;
+		mixedWeightSum += startWeight * endWeight;
+		endWeightSum += endWeight * endWeight;
+		for (int channel = 0; channel < channelCount; ++channel) {
+			startTexelSum[channel] += startWeight * block[i * 4 + channel];
+			endTexelSum[channel] += endWeight * block[i * 4 + channel];
+		}
+	}
+
+	float determinant = startWeightSum * endWeightSum - mixedWeightSum * mixedWeightSum;
+	// all texels use the same weight
+	if (std::fabs(determinant) < 1e-6f)
+		return false;
+	for (int channel = 0; channel < channelCount; ++channel) {
+		start[channel] = (endWeightSum * startTexelSum[channel] - mixedWeightSum * endTexelSum[channel]) / determinant;
+		end[channel] = (startWeightSum * endTexelSum[channel] - mixedWeightSum * startTexelSum[channel]) / determinant;
+	}
+	return true;
+}
+
+static constexpr int bc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+static int quantizeBC7Endpoint(float value, int pBit) {
+	return std::clamp(static_cast<int>(std::lround((value - pBit) / 2.0f)), 0, 127) * 2 + pBit;
+}
+
+// quantizes the endpoints with the best p-bits and picks the indices, returns the squared error
+static int encodeBC7Endpoints(const uint8_t* block, const float* start, const float* end, int (&bestEndpoints)[2][4],
+							  uint32_t (&bestIndices)[16]) {
+	int bestError = INT_MAX;
+
+	// every endpoint has one p-bit shared by all of its channels, try all combinations
+	for (int pBits = 0; pBits < 4; ++pBits) {
+		int endpoints[2][4];
+		for (int channel = 0; channel < 4; ++channel) {
+			endpoints[0][channel] = quantizeBC7Endpoint(start[channel], pBits & 1);
+			endpoints[1][channel] = quantizeBC7Endpoint(end[channel], pBits >> 1);
+		}
+
+		int palette[16][4];
+		for (int index = 0; index < 16; ++index) {
+			for (int channel = 0; channel < 4; ++channel) {
+				palette[index][channel] = (endpoints[0][channel] * (64 - bc7Weights[index]) +
+										   endpoints[1][channel] * bc7Weights[index] + 32) >>
+										  6;
+			}
+		}
+
+		int axis[4];
+		int axisLengthSquared = 0;
+		for (int channel = 0; channel < 4; ++channel) {
+			axis[channel] = endpoints[1][channel] - endpoints[0][channel];
+			axisLengthSquared += axis[channel] * axis[channel];
+		}
+
+		// the weights are close to uniform, so projecting onto the axis finds the best index up to one step
+		int error = 0;
+		uint32_t indices[16];
+		for (int i = 0; i < 16; ++i) {
+			const uint8_t* texel = block + i * 4;
+			int guess = 0;
+			if (axisLengthSquared > 0) {
+				int projection = 0;
+				for (int channel = 0; channel < 4; ++channel) {
+					projection += (texel[channel] - endpoints[0][channel]) * axis[channel];
+				}
+				guess = std::clamp((projection * 15 + axisLengthSquared / 2) / axisLengthSquared, 0, 15);
+			}
+
+			int bestTexelError = INT_MAX;
+			for (int index = std::max(guess - 1, 0); index <= std::min(guess + 1, 15); ++index) {
+				int texelError = squaredDistance(texel, palette[index], 4);
+				if (texelError < bestTexelError) {
+					bestTexelError = texelError;
+					indices[i] = static_cast<uint32_t>(index);
+				}
+			}
+			error += bestTexelError;
+		}
+
+		if (error < bestError) {
+			bestError = error;
+			std::memcpy(bestEndpoints, endpoints, sizeof(endpoints));
+			std::memcpy(bestIndices, indices, sizeof(indices));
+		}
+	}
+	return bestError;
+}
+
+static void compressBC7Block(const uint8_t* block, uint8_t* dst) {
+	float start[4], end[4];
+	blockEndpoints(block, 4, start, end);
+
+	int bestEndpoints[2][4];
+	uint32_t bestIndices[16];
+	int bestError = encodeBC7Endpoints(block, start, end, bestEndpoints, bestIndices);
+
+	// refit the endpoints to the chosen indices, that usually moves them past the inset bounding box
+	float weights[16];
+	for (int i = 0; i < 16; ++i) {
+		weights[i] = bc7Weights[bestIndices[i]] / 64.0f;
+	}
+	if (bestError > 0 && fitEndpoints(block, 4, weights, start, end)) {
+		int refinedEndpoints[2][4];
+		uint32_t refinedIndices[16];
+		if (encodeBC7Endpoints(block, start, end, refinedEndpoints, refinedIndices) < bestError) {
+			std::memcpy(bestEndpoints, refinedEndpoints, sizeof(refinedEndpoints));
+			std::memcpy(bestIndices, refinedIndices, sizeof(refinedIndices));
+		}
+	}
+
+	// the index of the first texel is stored without its top bit, the weights are symmetric so swapping the
+	// endpoints and mirroring the indices describes the same block
+	if (bestIndices[0] & 8) {
+		for (int channel = 0; channel < 4; ++channel) {
+			std::swap(bestEndpoints[0][channel], bestEndpoints[1][channel]);
+		}
+		for (auto& index : bestIndices) {
+			index = 15 - index;
+		}
+	}
+
+	BC7BlockWriter writer;
+	writer.write(1U << 6, 7);
+	for (int channel = 0; channel < 4; ++channel) {
+		writer.write(static_cast<uint32_t>(bestEndpoints[0][channel] >> 1), 7);
+		writer.write(static_cast<uint32_t>(bestEndpoints[1][channel] >> 1), 7);
+	}
+	writer.write(static_cast<uint32_t>(bestEndpoints[0][0] & 1), 1);
+	writer.write(static_cast<uint32_t>(bestEndpoints[1][0] & 1), 1);
+	writer.write(bestIndices[0], 3);
+	for (int i = 1; i < 16; ++i) {
+		writer.write(bestIndices[i], 4);
+	}
+	std::memcpy(dst, writer.bits, sizeof(writer.bits));
+}
+
+template <size_t BlockSize, typename BlockCompressor>
+static void compressBlocks(const uint8_t* texels, uint32_t width, uint32_t height, uint8_t* dst,
+						   BlockCompressor&& compressBlock) {
+	uint8_t block[64];
+	for (uint32_t blockY = 0; blockY < (height + 3) / 4; ++blockY) {
+		for (uint32_t blockX = 0; blockX < (width + 3) / 4; ++blockX) {
+			loadBlock(texels, width, height, blockX, blockY, block);
+			compressBlock(block, dst);
+			dst += BlockSize;
+		}
+	}
+}
+
+void compressBC1(const uint8_t* texels, uint32_t width, uint32_t height, uint8_t* dst) {
+	compressBlocks<8>(texels, width, height, dst, compressBC1Block);
+}
+
+void compressBC5(const uint8_t* texels, uint32_t width, uint32_t height, uint8_t* dst) {
+	compressBlocks<16>(texels, width, height, dst, compressBC5Block);
+}
+
+void compressBC7(const uint8_t* texels, uint32_t width, uint32_t height, uint8_t* dst) {
+	compressBlocks<16>(texels, width, height, dst, compressBC7Block);
+}
+
+static float srgbToLinear(uint8_t value) {
+	static const std::array<float, 256> table = []() {
+		std::array<float, 256> result;
+		for (size_t i = 0; i < result.size(); ++i) {
+			float normalized = i / 255.0f;
+			result[i] = normalized <= 0.04045f ? normalized / 12.92f : std::pow((normalized + 0.055f) / 1.055f, 2.4f);
+		}
+		return result;
+	}();
+	return table[value];
+}
+
+static uint8_t linearToSrgb(float value) {
+	static const std::array<uint8_t, 4096> table = []() {
+		std::array<uint8_t, 4096> result;
+		for (size_t i = 0; i < result.size(); ++i) {
+			float linear = i / 4095.0f;
+			float srgb = linear <= 0.0031308f ? linear * 12.92f : 1.055f * std::pow(linear, 1.0f / 2.4f) - 0.055f;
+			result[i] = static_cast<uint8_t>(std::lround(srgb * 255.0f));
+		}
+		return result;
+	}();
+	return table[std::clamp(static_cast<int>(std::lround(value * 4095.0f)), 0, 4095)];
+}
+
+void downsampleImage(const uint8_t* texels, uint32_t width, uint32_t height, uint8_t* dst, bool isSRGB) {
+	uint32_t dstWidth = std::max(width / 2, 1U);
+	uint32_t dstHeight = std::max(height / 2, 1U);
+
+	for (uint32_t y = 0; y < dstHeight; ++y) {
+		const uint8_t* row0 = texels + std::min(2 * y, height - 1) * static_cast<size_t>(width) * 4;
+		const uint8_t* row1 = texels + std::min(2 * y + 1, height - 1) * static_cast<size_t>(width) * 4;
+		for (uint32_t x = 0; x < dstWidth; ++x) {
+			size_t column0 = std::min(2 * x, width - 1) * 4;
+			size_t column1 = std::min(2 * x + 1, width - 1) * 4;
+			uint8_t* dstTexel = dst + (y * static_cast<size_t>(dstWidth) + x) * 4;
+
+			for (size_t channel = 0; channel < 4; ++channel) {
+				// alpha is always linear
+				if (isSRGB && channel < 3) {
+					float sum = srgbToLinear(row0[column0 + channel]) + srgbToLinear(row0[column1 + channel]) +
+								srgbToLinear(row1[column0 + channel]) + srgbToLinear(row1[column1 + channel]);
+					dstTexel[channel] = linearToSrgb(sum * 0.25f);
+				} else {
+					uint32_t sum = row0[column0 + channel] + row0[column1 + channel] + row1[column0 + channel] +
+								   row1[column1 + channel];
+					dstTexel[channel] = static_cast<uint8_t>((sum + 2) / 4);
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,34 @@
+#include <util/TextureResidency.hpp>
+#include <utility>
+
+TextureResidency::TextureResidency(std::vector<uint32_t> mipLevels, uint64_t evictionFrameCount)
+	: m_mipLevels(std::move(mipLevels)), m_evictionFrameCount(evictionFrameCount) {
+	m_requestedLevels = m_mipLevels;
+	m_lastRequestFrames.resize(m_mipLevels.size());
+}
+
+bool TextureResidency::request(uint32_t imageIndex, uint32_t level) {
+	m_hasFrameRequests = true;
+	m_lastRequestFrames[imageIndex] = m_frameCount;
+	if (level >= m_requestedLevels[imageIndex])
+		return false;
+	m_requestedLevels[imageIndex] = level;
+	return true;
+}
+
+std::vector<uint32_t> TextureResidency::endFrame(bool tracedRays) {
+	bool countsTowardsEviction = tracedRays && m_hasFrameRequests;
+	m_hasFrameRequests = false;
+	if (!countsTowardsEviction)
+		return {};
+
+	++m_frameCount;
+	std::vector<uint32_t> evictedImages;
+	for (uint32_t i = 0; i < m_mipLevels.size(); ++i) {
+		if (!isRequested(i) || m_frameCount - m_lastRequestFrames[i] <= m_evictionFrameCount)
+			continue;
+		m_requestedLevels[i] = m_mipLevels[i];
+		evictedImages.push_back(i);
+	}
+	return evictedImages;
+}
@@ -0,0 +1,43 @@
+#include <algorithm>
+#include <util/ThreadPool.hpp>
+
+ThreadPool::ThreadPool(size_t threadCount) {
+	if (!threadCount) {
+		threadCount = std::max(std::thread::hardware_concurrency(), 1U);
+	}
+
+	m_workers.reserve(threadCount);
+	for (size_t i = 0; i < threadCount; ++i) {
+		m_workers.emplace_back(&ThreadPool::workerLoop, this);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::scoped_lock lock(m_jobMutex);
+		m_shouldExit = true;
+	}
+	m_jobCondition.notify_all();
+
+	for (auto& worker : m_workers) {
+		worker.join();
+	}
+}
+
+void ThreadPool::workerLoop() {
+	while (true) {
+		std::function<void()> job;
+		{
+			std::unique_lock lock(m_jobMutex);
+			m_jobCondition.wait(lock, [this]() { return m_shouldExit || !m_jobs.empty(); });
+
+			// drain the queue before exiting so that no future is left without a value
+			if (m_jobs.empty())
+				return;
+
+			job = std::move(m_jobs.front());
+			m_jobs.pop();
+		}
+		job();
+	}
+}
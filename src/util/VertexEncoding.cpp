@@ -0,0 +1,210 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <util/VertexEncoding.hpp>
+#if defined(__SSE2__) || defined(_M_X64)
+#define VERTEX_ENCODING_SSE2
+#include <emmintrin.h>
+#endif
+#ifdef __F16C__
+#include <immintrin.h>
+#endif
+
+static void encodeOctahedral(float x, float y, float z, float& octX, float& octY) {
+	float inverseL1Norm = 1.0f / std::max(std::fabs(x) + std::fabs(y) + std::fabs(z), 1e-20f);
+	octX = x * inverseL1Norm;
+	octY = y * inverseL1Norm;
+	// fold the lower hemisphere over the diagonals
+	if (z < 0.0f) {
+		float foldedX = (1.0f - std::fabs(octY)) * (octX >= 0.0f ? 1.0f : -1.0f);
+		float foldedY = (1.0f - std::fabs(octX)) * (octY >= 0.0f ? 1.0f : -1.0f);
+		octX = foldedX;
+		octY = foldedY;
+	}
+}
+
+static int32_t quantizeSnorm(float value, float scale) {
+	return static_cast<int32_t>(std::nearbyint(std::clamp(value, -1.0f, 1.0f) * scale));
+}
+
+static uint32_t encodeNormal(const float* normal) {
+	float octX, octY;
+	encodeOctahedral(normal[0], normal[1], normal[2], octX, octY);
+	return (static_cast<uint32_t>(quantizeSnorm(octX, 32767.0f)) & 0xFFFFU) |
+		   (static_cast<uint32_t>(quantizeSnorm(octY, 32767.0f)) << 16);
+}
+
+static uint32_t encodeTangent(const float* tangent) {
+	float octX, octY;
+	encodeOctahedral(tangent[0], tangent[1], tangent[2], octX, octY);
+	return (static_cast<uint32_t>(quantizeSnorm(octX, 32767.0f)) & 0xFFFFU) |
+		   ((static_cast<uint32_t>(quantizeSnorm(octY, 16383.0f)) & 0x7FFFU) << 16) |
+		   (tangent[3] < 0.0f ? 0x80000000U : 0U);
+}
+
+// see https://gist.github.com/rygorous/2156668 (float_to_half_fast3_rtne)
+static uint16_t encodeHalfFloat(float value) {
+	constexpr uint32_t float32Infinity = 255U << 23;
+	constexpr uint32_t float16Max = (127U + 16U) << 23;
+	constexpr uint32_t denormalMagicBits = ((127U - 15U) + (23U - 10U) + 1U) << 23;
+
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(float));
+	uint32_t sign = bits & 0x80000000U;
+	bits ^= sign;
+
+	uint32_t result;
+	if (bits >= float16Max) {
+		// overflow to infinity, NaNs stay (quiet) NaNs
+		result = bits > float32Infinity ? 0x7E00U : 0x7C00U;
+	} else if (bits < (113U << 23)) {
+		// denormal or zero, let the FPU do the rounding by adding a number that aligns the mantissa
+		float denormalMagic, rounded;
+		std::memcpy(&denormalMagic, &denormalMagicBits, sizeof(float));
+		std::memcpy(&rounded, &bits, sizeof(float));
+		rounded += denormalMagic;
+		std::memcpy(&result, &rounded, sizeof(float));
+		result -= denormalMagicBits;
+	} else {
+		uint32_t mantissaOdd = (bits >> 13) & 1U;
+		// rebias the exponent and round to nearest even
+		bits += (static_cast<uint32_t>(15 - 127) << 23) + 0xFFFU + mantissaOdd;
+		result = bits >> 13;
+	}
+	return static_cast<uint16_t>(result | (sign >> 16));
+}
+
+#ifdef VERTEX_ENCODING_SSE2
+static __m128 signNotZero(__m128 value) {
+	__m128 negativeMask = _mm_cmplt_ps(value, _mm_setzero_ps());
+	return _mm_or_ps(_mm_and_ps(negativeMask, _mm_set1_ps(-1.0f)), _mm_andnot_ps(negativeMask, _mm_set1_ps(1.0f)));
+}
+
+static void encodeOctahedral(__m128 x, __m128 y, __m128 z, __m128& octX, __m128& octY) {
+	__m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+	__m128 l1Norm = _mm_add_ps(_mm_add_ps(_mm_and_ps(x, absMask), _mm_and_ps(y, absMask)), _mm_and_ps(z, absMask));
+	__m128 inverseL1Norm = _mm_div_ps(_mm_set1_ps(1.0f), _mm_max_ps(l1Norm, _mm_set1_ps(1e-20f)));
+	octX = _mm_mul_ps(x, inverseL1Norm);
+	octY = _mm_mul_ps(y, inverseL1Norm);
+
+	__m128 foldedX = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(1.0f), _mm_and_ps(octY, absMask)), signNotZero(octX));
+	__m128 foldedY = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(1.0f), _mm_and_ps(octX, absMask)), signNotZero(octY));
+	__m128 lowerHemisphereMask = _mm_cmplt_ps(z, _mm_setzero_ps());
+	octX = _mm_or_ps(_mm_and_ps(lowerHemisphereMask, foldedX), _mm_andnot_ps(lowerHemisphereMask, octX));
+	octY = _mm_or_ps(_mm_and_ps(lowerHemisphereMask, foldedY), _mm_andnot_ps(lowerHemisphereMask, octY));
+}
+
+static __m128i quantizeSnorm(__m128 value, float scale) {
+	value = _mm_min_ps(_mm_max_ps(value, _mm_set1_ps(-1.0f)), _mm_set1_ps(1.0f));
+	// rounds to nearest even with the default rounding mode, like std::nearbyint
+	return _mm_cvtps_epi32(_mm_mul_ps(value, _mm_set1_ps(scale)));
+}
+#endif
+
+void encodeOctahedralNormals(const float* normals, size_t count, uint32_t* dst) {
+	size_t i = 0;
+#ifdef VERTEX_ENCODING_SSE2
+	for (; i + 4 <= count; i += 4) {
+		// deinterleave x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3
+		__m128 a = _mm_loadu_ps(normals + i * 3);
+		__m128 b = _mm_loadu_ps(normals + i * 3 + 4);
+		__m128 c = _mm_loadu_ps(normals + i * 3 + 8);
+		__m128 x = _mm_shuffle_ps(a, _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 3, 0));
+		__m128 y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)),
+								  _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+		__m128 z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)),
+								  _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+
+		__m128 octX, octY;
+		encodeOctahedral(x, y, z, octX, octY);
+
+		__m128i encoded = _mm_or_si128(_mm_and_si128(quantizeSnorm(octX, 32767.0f), _mm_set1_epi32(0xFFFF)),
+									   _mm_slli_epi32(quantizeSnorm(octY, 32767.0f), 16));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), encoded);
+	}
+#endif
+	for (; i < count; ++i) {
+		dst[i] = encodeNormal(normals + i * 3);
+	}
+}
+
+void encodeOctahedralTangents(const float* tangents, size_t count, uint32_t* dst) {
+	size_t i = 0;
+#ifdef VERTEX_ENCODING_SSE2
+	for (; i + 4 <= count; i += 4) {
+		__m128 x = _mm_loadu_ps(tangents + i * 4);
+		__m128 y = _mm_loadu_ps(tangents + i * 4 + 4);
+		__m128 z = _mm_loadu_ps(tangents + i * 4 + 8);
+		__m128 w = _mm_loadu_ps(tangents + i * 4 + 12);
+		_MM_TRANSPOSE4_PS(x, y, z, w);
+
+		__m128 octX, octY;
+		encodeOctahedral(x, y, z, octX, octY);
+
+		__m128i encoded = _mm_or_si128(_mm_and_si128(quantizeSnorm(octX, 32767.0f), _mm_set1_epi32(0xFFFF)),
+									   _mm_slli_epi32(_mm_and_si128(quantizeSnorm(octY, 16383.0f),
+																	_mm_set1_epi32(0x7FFF)),
+													  16));
+		__m128i sign = _mm_and_si128(_mm_castps_si128(_mm_cmplt_ps(w, _mm_setzero_ps())),
+									 _mm_set1_epi32(static_cast<int>(0x80000000U)));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_or_si128(encoded, sign));
+	}
+#endif
+	for (; i < count; ++i) {
+		dst[i] = encodeTangent(tangents + i * 4);
+	}
+}
+
+void encodeHalfFloats(const float* values, size_t count, uint16_t* dst) {
+	size_t i = 0;
+#ifdef __F16C__
+	for (; i + 8 <= count; i += 8) {
+		__m128i halves = _mm256_cvtps_ph(_mm256_loadu_ps(values + i), _MM_FROUND_TO_NEAREST_INT);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), halves);
+	}
+#endif
+	for (; i < count; ++i) {
+		dst[i] = encodeHalfFloat(values[i]);
+	}
+}
+
+void encodeShadingRecords(const float* normals, const float* tangents, const float* texCoords, size_t count,
+						  bool compact, uint8_t* dst) {
+	size_t recordSize = shadingRecordSize(compact);
+	// encoded in batches with the stream encoders, then interleaved
+	constexpr size_t batchSize = 256;
+	uint32_t encodedNormals[batchSize] = {};
+	uint32_t encodedTangents[batchSize] = {};
+	uint16_t encodedTexCoords[batchSize * 2] = {};
+
+	for (size_t batchStart = 0; batchStart < count; batchStart += batchSize) {
+		size_t batchCount = std::min(count - batchStart, batchSize);
+		if (compact) {
+			if (normals)
+				encodeOctahedralNormals(normals + batchStart * 3, batchCount, encodedNormals);
+			if (tangents)
+				encodeOctahedralTangents(tangents + batchStart * 4, batchCount, encodedTangents);
+			if (texCoords)
+				encodeHalfFloats(texCoords + batchStart * 2, batchCount * 2, encodedTexCoords);
+		}
+
+		for (size_t i = 0; i < batchCount; ++i) {
+			size_t vertexIndex = batchStart + i;
+			// assembled on the stack so that dst, which may be write-combined, is written in one go
+			uint32_t record[9] = {};
+			if (compact) {
+				record[0] = encodedNormals[i];
+				record[1] = encodedTangents[i];
+				std::memcpy(&record[2], encodedTexCoords + i * 2, 2 * sizeof(uint16_t));
+			} else {
+				if (normals)
+					std::memcpy(&record[0], normals + vertexIndex * 3, 3 * sizeof(float));
+				if (tangents)
+					std::memcpy(&record[3], tangents + vertexIndex * 4, 4 * sizeof(float));
+				if (texCoords)
+					std::memcpy(&record[7], texCoords + vertexIndex * 2, 2 * sizeof(float));
+			}
+			std::memcpy(dst + vertexIndex * recordSize, record, recordSize);
+		}
+	}
+}
@@ -0,0 +1,150 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <util/AccessorOffsetMap.hpp>
+#include <vector>
+
+// Synthetic glTF scene data: every primitive has its own index accessor, groups of four primitives share their
+// position, normal and texcoord accessors (like the primitives of one mesh with several materials).
+struct SyntheticScene {
+	std::vector<cgltf_accessor> accessors;
+	std::vector<cgltf_attribute> attributes;
+	std::vector<cgltf_primitive> primitives;
+};
+
+static SyntheticScene createScene(size_t primitiveCount) {
+	constexpr size_t primitivesPerVertexSet = 4;
+	size_t vertexSetCount = (primitiveCount + primitivesPerVertexSet - 1) / primitivesPerVertexSet;
+
+	SyntheticScene scene;
+	scene.accessors.resize(3 * vertexSetCount + primitiveCount);
+	scene.attributes.resize(3 * primitiveCount);
+	scene.primitives.resize(primitiveCount);
+	for (size_t i = 0; i < scene.accessors.size(); ++i) {
+		scene.accessors[i].count = 24 + i % 16;
+	}
+	for (size_t i = 0; i < primitiveCount; ++i) {
+		cgltf_accessor* vertexAccessors = scene.accessors.data() + 3 * (i / primitivesPerVertexSet);
+		cgltf_attribute* attributes = scene.attributes.data() + 3 * i;
+		attributes[0].type = cgltf_attribute_type_position;
+		attributes[0].data = vertexAccessors;
+		attributes[1].type = cgltf_attribute_type_normal;
+		attributes[1].data = vertexAccessors + 1;
+		attributes[2].type = cgltf_attribute_type_texcoord;
+		attributes[2].data = vertexAccessors + 2;
+
+		scene.primitives[i].type = cgltf_primitive_type_triangles;
+		scene.primitives[i].indices = scene.accessors.data() + 3 * vertexSetCount + i;
+		scene.primitives[i].attributes = attributes;
+		scene.primitives[i].attributes_count = 3;
+	}
+	return scene;
+}
+
+static AccessorUsage attributeUsage(cgltf_attribute_type type) {
+	switch (type) {
+		case cgltf_attribute_type_position:
+			return AccessorUsage::Position;
+		case cgltf_attribute_type_normal:
+			return AccessorUsage::Normal;
+		case cgltf_attribute_type_tangent:
+			return AccessorUsage::Tangent;
+		default:
+			return AccessorUsage::TexCoord;
+	}
+}
+
+// what the loader did before AccessorOffsetMap: a find_if over everything copied so far for every accessor use
+struct CopiedAccessor {
+	const cgltf_accessor* accessor;
+	size_t bufferOffset;
+};
+
+static size_t copyWithLinearScans(const SyntheticScene& scene) {
+	std::vector<CopiedAccessor> copiedVertexDataAccessors;
+	std::vector<CopiedAccessor> copiedIndexDataAccessors;
+	size_t vertexDataOffset = 0;
+	size_t indexDataOffset = 0;
+	size_t offsetSum = 0;
+	for (auto& primitive : scene.primitives) {
+		for (size_t i = 0; i < primitive.attributes_count; ++i) {
+			const cgltf_accessor* data = primitive.attributes[i].data;
+			auto iterator = std::find_if(copiedVertexDataAccessors.begin(), copiedVertexDataAccessors.end(),
+										 [data](const CopiedAccessor& accessor) { return accessor.accessor == data; });
+			if (iterator == copiedVertexDataAccessors.end()) {
+				copiedVertexDataAccessors.push_back({ data, vertexDataOffset });
+				offsetSum += vertexDataOffset;
+				vertexDataOffset += data->count;
+			} else {
+				offsetSum += iterator->bufferOffset;
+			}
+		}
+		const cgltf_accessor* indices = primitive.indices;
+		auto iterator =
+			std::find_if(copiedIndexDataAccessors.begin(), copiedIndexDataAccessors.end(),
+						 [indices](const CopiedAccessor& accessor) { return accessor.accessor == indices; });
+		if (iterator == copiedIndexDataAccessors.end()) {
+			copiedIndexDataAccessors.push_back({ indices, indexDataOffset });
+			offsetSum += indexDataOffset;
+			indexDataOffset += indices->count;
+		} else {
+			offsetSum += iterator->bufferOffset;
+		}
+	}
+	return offsetSum;
+}
+
+static size_t copyWithOffsetMap(const SyntheticScene& scene) {
+	AccessorOffsetMap copiedAccessors;
+	size_t vertexDataOffset = 0;
+	size_t indexDataOffset = 0;
+	size_t offsetSum = 0;
+	for (auto& primitive : scene.primitives) {
+		for (size_t i = 0; i < primitive.attributes_count; ++i) {
+			const cgltf_attribute& attribute = primitive.attributes[i];
+			AccessorUsage usage = attributeUsage(attribute.type);
+			if (const size_t* offset = copiedAccessors.find(attribute.data, usage)) {
+				offsetSum += *offset;
+			} else {
+				copiedAccessors.insert(attribute.data, usage, vertexDataOffset);
+				offsetSum += vertexDataOffset;
+				vertexDataOffset += attribute.data->count;
+			}
+		}
+		if (const size_t* offset = copiedAccessors.find(primitive.indices, AccessorUsage::Index)) {
+			offsetSum += *offset;
+		} else {
+			copiedAccessors.insert(primitive.indices, AccessorUsage::Index, indexDataOffset);
+			offsetSum += indexDataOffset;
+			indexDataOffset += primitive.indices->count;
+		}
+	}
+	return offsetSum;
+}
+
+template <typename Function> static double measure(Function function, size_t& result) {
+	auto startTime = std::chrono::steady_clock::now();
+	result = function();
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+// Resolves the stream offset of every accessor use like the loader's copy pass, with the old linear scans and with
+// AccessorOffsetMap, for growing primitive counts. The scans grow quadratically with the scene, the map linearly.
+int main() {
+	bool passed = true;
+	for (size_t primitiveCount : { 1000, 10000, 100000 }) {
+		SyntheticScene scene = createScene(primitiveCount);
+
+		size_t linearResult, mapResult;
+		double linearTime = measure([&scene]() { return copyWithLinearScans(scene); }, linearResult);
+		double mapTime = measure([&scene]() { return copyWithOffsetMap(scene); }, mapResult);
+
+		printf("%zu primitives (%zu accessors): find_if %f ms, AccessorOffsetMap %f ms\n", primitiveCount,
+			   scene.accessors.size(), linearTime, mapTime);
+		if (linearResult != mapResult) {
+			printf("FAILED: the offsets resolved with AccessorOffsetMap differ from the linear scans\n");
+			passed = false;
+		}
+	}
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <util/AccessorUnpacking.hpp>
+#include <vector>
+
+// the index conversion loops the loader used before unpackAccessorIndices/unpackAccessorShortIndices
+static void convertIndicesScalar(const cgltf_accessor* accessor, uint32_t* dst) {
+	const uint8_t* srcData = reinterpret_cast<const uint8_t*>(accessor->buffer_view->buffer->data) +
+							 accessor->buffer_view->offset + accessor->offset;
+	switch (accessor->component_type) {
+		case cgltf_component_type_r_8u:
+			for (cgltf_size i = 0; i < accessor->count; ++i) {
+				dst[i] = srcData[i];
+			}
+			break;
+		case cgltf_component_type_r_16u: {
+			const uint16_t* srcIndices = reinterpret_cast<const uint16_t*>(srcData);
+			for (cgltf_size i = 0; i < accessor->count; ++i) {
+				dst[i] = srcIndices[i];
+			}
+		} break;
+		case cgltf_component_type_r_32u:
+			std::memcpy(dst, srcData, accessor->count * sizeof(uint32_t));
+			break;
+		default:
+			break;
+	}
+}
+
+static void convertShortIndicesScalar(const cgltf_accessor* accessor, uint16_t* dst) {
+	const uint8_t* srcData = reinterpret_cast<const uint8_t*>(accessor->buffer_view->buffer->data) +
+							 accessor->buffer_view->offset + accessor->offset;
+	switch (accessor->component_type) {
+		case cgltf_component_type_r_8u:
+			for (cgltf_size i = 0; i < accessor->count; ++i) {
+				dst[i] = srcData[i];
+			}
+			break;
+		case cgltf_component_type_r_16u:
+			std::memcpy(dst, srcData, accessor->count * sizeof(uint16_t));
+			break;
+		case cgltf_component_type_r_32u: {
+			const uint32_t* srcIndices = reinterpret_cast<const uint32_t*>(srcData);
+			for (cgltf_size i = 0; i < accessor->count; ++i) {
+				dst[i] = static_cast<uint16_t>(srcIndices[i]);
+			}
+		} break;
+		default:
+			break;
+	}
+}
+
+struct IndexAccessor {
+	std::vector<uint8_t> data;
+	cgltf_buffer buffer = {};
+	cgltf_buffer_view bufferView = {};
+	cgltf_accessor accessor = {};
+};
+
+// indices below 65536 so that they can be narrowed, written as the accessor's component type
+static void initIndexAccessor(IndexAccessor& indices, cgltf_component_type type, size_t componentSize, size_t count) {
+	indices.data.resize(count * componentSize);
+	uint32_t state = 0x12345678;
+	for (size_t i = 0; i < count; ++i) {
+		state = state * 1664525 + 1013904223;
+		uint32_t index = (state >> 8) & (componentSize == 1 ? 0xFF : 0xFFFF);
+		std::memcpy(indices.data.data() + i * componentSize, &index, componentSize);
+	}
+
+	indices.buffer.data = indices.data.data();
+	indices.buffer.size = indices.data.size();
+	indices.bufferView.buffer = &indices.buffer;
+	indices.bufferView.size = indices.data.size();
+	indices.accessor.component_type = type;
+	indices.accessor.type = cgltf_type_scalar;
+	indices.accessor.count = count;
+	indices.accessor.stride = componentSize;
+	indices.accessor.buffer_view = &indices.bufferView;
+}
+
+// best of a few runs, the first one also faults the destination pages in
+template <typename Function> static double measure(Function function) {
+	double bestTime = 1e30;
+	for (int run = 0; run < 5; ++run) {
+		auto startTime = std::chrono::steady_clock::now();
+		function();
+		bestTime = std::min(
+			bestTime, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count());
+	}
+	return bestTime;
+}
+
+template <typename Dst>
+static bool compareConversion(const char* name, const IndexAccessor& indices,
+							  void (*convert)(const cgltf_accessor*, Dst*),
+							  void (*convertScalar)(const cgltf_accessor*, Dst*)) {
+	// the odd count leaves a tail after the last full SIMD iteration
+	std::vector<Dst> result(indices.accessor.count);
+	std::vector<Dst> scalarResult(indices.accessor.count);
+	double time = measure([&]() { convert(&indices.accessor, result.data()); });
+	double scalarTime = measure([&]() { convertScalar(&indices.accessor, scalarResult.data()); });
+
+	bool matches = result == scalarResult;
+	printf("%s, %zu indices: unpacked %f ms, scalar loop %f ms%s\n", name, indices.accessor.count, time, scalarTime,
+		   matches ? "" : ", RESULTS DIFFER");
+	return matches;
+}
+
+// Compares the SIMD index conversion against the loader's previous scalar loops (compiled with the same flags, so
+// they may be auto-vectorized), the results must match exactly.
+int main() {
+	constexpr size_t indexCount = (1 << 24) + 7;
+
+	IndexAccessor byteIndices, shortIndices, intIndices;
+	initIndexAccessor(byteIndices, cgltf_component_type_r_8u, 1, indexCount);
+	initIndexAccessor(shortIndices, cgltf_component_type_r_16u, 2, indexCount);
+	initIndexAccessor(intIndices, cgltf_component_type_r_32u, 4, indexCount);
+
+	bool passed = true;
+	passed &= compareConversion<uint32_t>("8 -> 32 bit", byteIndices, unpackAccessorIndices, convertIndicesScalar);
+	passed &= compareConversion<uint32_t>("16 -> 32 bit", shortIndices, unpackAccessorIndices, convertIndicesScalar);
+	passed &= compareConversion<uint32_t>("32 -> 32 bit", intIndices, unpackAccessorIndices, convertIndicesScalar);
+	passed &= compareConversion<uint16_t>("8 -> 16 bit", byteIndices, unpackAccessorShortIndices,
+										  convertShortIndicesScalar);
+	passed &= compareConversion<uint16_t>("16 -> 16 bit", shortIndices, unpackAccessorShortIndices,
+										  convertShortIndicesScalar);
+	passed &= compareConversion<uint16_t>("32 -> 16 bit", intIndices, unpackAccessorShortIndices,
+										  convertShortIndicesScalar);
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,51 @@
+#include <cstdio>
+#include <util/TextureResidency.hpp>
+
+static bool check(bool condition, const char* description) {
+	if (!condition)
+		printf("FAILED: %s\n", description);
+	return condition;
+}
+
+int main() {
+	constexpr uint64_t evictionFrameCount = 256;
+	bool passed = true;
+
+	// Accumulation until convergence with two images in view, then a converged, static view for much longer than
+	// the eviction delay. The converged frames don't trace, so nothing may be evicted and the view stays stable.
+	TextureResidency residency = TextureResidency({ 8, 8 }, evictionFrameCount);
+	passed &= check(residency.request(0, 2) && residency.request(1, 3), "first requests start streaming");
+	passed &= check(residency.endFrame(true).empty(), "nothing is evicted while images are requested");
+	for (uint32_t frame = 0; frame < 1024; ++frame) {
+		passed &= check(!residency.request(0, 2) && !residency.request(1, 3), "repeated requests don't restream");
+		passed &= check(residency.endFrame(true).empty(), "nothing is evicted while images are requested");
+	}
+	for (uint64_t frame = 0; frame < 100 * evictionFrameCount; ++frame) {
+		if (!check(residency.endFrame(false).empty(), "converged frames don't evict")) {
+			passed = false;
+			break;
+		}
+	}
+	passed &= check(residency.isRequested(0) && residency.isRequested(1), "converged view keeps its images");
+
+	// traced frames that didn't request anything (e.g. looking at the sky) don't age images either
+	for (uint64_t frame = 0; frame < 2 * evictionFrameCount; ++frame) {
+		passed &= check(residency.endFrame(true).empty(), "frames without requests don't evict");
+	}
+
+	// only the image that stops being requested is evicted, after exactly evictionFrameCount traced frames
+	std::vector<uint32_t> evictedImages;
+	uint64_t evictionFrame = 0;
+	for (uint64_t frame = 0; frame < 2 * evictionFrameCount && evictedImages.empty(); ++frame) {
+		residency.request(1, 3);
+		evictedImages = residency.endFrame(true);
+		evictionFrame = frame;
+	}
+	passed &= check(evictedImages.size() == 1 && evictedImages[0] == 0, "the unrequested image is evicted");
+	passed &= check(evictionFrame == evictionFrameCount - 1, "eviction happens after evictionFrameCount frames");
+	passed &= check(!residency.isRequested(0) && residency.isRequested(1), "only the evicted image is reset");
+	passed &= check(residency.request(0, 5), "an evicted image is streamed again once it is requested");
+
+	printf("%s\n", passed ? "Texture residency tests passed" : "Texture residency tests failed");
+	return passed ? 0 : 1;
+}